@@ -0,0 +1,133 @@
+#include "../Engine.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        AsyncExecutor::AsyncExecutor(int MaxThreadsCount, double IdleTimeout, int MaxQueuedCount)
+            : MaxThreadsCount(MaxThreadsCount > 0 ? MaxThreadsCount :
+                              std::max(16, 4 * (int)std::thread::hardware_concurrency())),
+              MaxQueuedCount(MaxQueuedCount > 0 ? MaxQueuedCount : 4 * this->MaxThreadsCount),
+              IdleTimeout(IdleTimeout), ThreadsCount(0), IdleThreadsCount(0), WakeupsCount(0), StartupsCount(0),
+              ShouldTerminate(false)
+        {
+            if (!(IdleTimeout >= 0))
+                throw std::domain_error("IdleTimeout must not be negative.");
+        }
+
+        AsyncExecutor::~AsyncExecutor()
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            ShouldTerminate = true;
+            WorkCondition.notify_all();
+            ExitCondition.wait(guard, [this]() { return ThreadsCount == 0; });
+        }
+
+        bool AsyncExecutor::Execute(std::function<void()> Task)
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            if (IdleThreadsCount > 0)
+            {
+                // Reuse an idle thread
+                IdleThreadsCount--;
+                WakeupsCount++;
+                Tasks.Push(std::move(Task));
+                WorkCondition.notify_one();
+                return true;
+            }
+
+            bool is_started = false;
+            if (ThreadsCount < MaxThreadsCount)
+            {
+                try
+                {
+                    // Starts working after the task is pushed, as the mutex is locked meanwhile
+                    std::thread([this]() { WorkerProcess(); }).detach();
+                    ThreadsCount++;
+                    StartupsCount++;
+                    is_started = true;
+                }
+                catch (std::system_error&)
+                {
+                    // Out of threads, leave the task to the busy ones if any
+                    if (ThreadsCount == 0)
+                        throw;
+                }
+            }
+            // All the threads are busy, the task would wait for them
+            if (!is_started && Tasks.GetCount() - WakeupsCount - StartupsCount >= MaxQueuedCount)
+            {
+                guard.unlock();
+                Task = nullptr; // Destroy the captures outside the lock
+                return false;
+            }
+            Tasks.Push(std::move(Task));
+            return true;
+        }
+
+        int AsyncExecutor::GetMaxThreadsCount()
+        {
+            return MaxThreadsCount;
+        }
+
+        int AsyncExecutor::GetMaxQueuedCount()
+        {
+            return MaxQueuedCount;
+        }
+
+        int AsyncExecutor::GetThreadsCount()
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            return ThreadsCount;
+        }
+
+        int AsyncExecutor::GetIdleThreadsCount()
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            return IdleThreadsCount;
+        }
+
+        void AsyncExecutor::WorkerProcess()
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            StartupsCount--;
+            while (true)
+            {
+                std::function<void()> task;
+                if (Tasks.Pop(task))
+                {
+                    guard.unlock();
+                    try
+                    {
+                        task();
+                    }
+                    catch (...) {} // ignore
+                    task = nullptr; // Destroy the captures outside the lock
+                    guard.lock();
+                    continue;
+                }
+
+                // All the pushed tasks are done before terminating
+                if (ShouldTerminate)
+                    break;
+
+                IdleThreadsCount++;
+                bool woken = WorkCondition.wait_for(guard, IdleTimeout, [this]() {
+                    return WakeupsCount > 0 || ShouldTerminate;
+                });
+                if (WakeupsCount > 0)
+                    WakeupsCount--; // Claimed by Execute, which has also decreased IdleThreadsCount
+                else
+                {
+                    IdleThreadsCount--;
+                    if (!woken)
+                        break; // Idle for too long
+                }
+            }
+
+            ThreadsCount--;
+            // Notified under the lock, the executor may be destroyed right after
+            ExitCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/Collections/Queue.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class AsyncExecutor final
+        {
+        public:
+            /// @param MaxThreadsCount The maximum number of threads.
+            ///        MaxThreadsCount <= 0 results in 4 * std::thread::hardware_concurrency(), at least 16.
+            /// @param IdleTimeout The seconds that an idle thread waits for a task before exiting.
+            /// @param MaxQueuedCount The maximum number of tasks that wait for a thread once MaxThreadsCount is reached.
+            ///        MaxQueuedCount <= 0 results in 4 * MaxThreadsCount.
+            AsyncExecutor(int MaxThreadsCount = 0, double IdleTimeout = 10, int MaxQueuedCount = 0);
+            /// Waits for all the pushed tasks to be done.
+            ~AsyncExecutor();
+
+            AsyncExecutor(const AsyncExecutor&) = delete;
+            AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+            /// @brief Executes a task on an idle thread, or on a new thread if all are busy.
+            ///
+            /// The task waits for a thread to become idle if MaxThreadsCount is reached,
+            /// and is rejected if MaxQueuedCount tasks are already waiting.
+            /// Exceptions thrown by the task are ignored.
+            /// Can be called by any thread.
+            ///
+            /// @return Whether the task is accepted, a rejected task is destroyed without being called.
+            bool Execute(std::function<void()> Task);
+
+            /// @brief Gets the maximum number of threads.
+            int GetMaxThreadsCount();
+            /// @brief Gets the maximum number of tasks that wait for a thread.
+            int GetMaxQueuedCount();
+            /// @brief Gets the current number of threads, busy or idle.
+            int GetThreadsCount();
+            /// @brief Gets the number of threads that are waiting for tasks.
+            int GetIdleThreadsCount();
+        private:
+            const int MaxThreadsCount;
+            const int MaxQueuedCount;
+            const std::chrono::duration<double> IdleTimeout;
+
+            std::mutex Mutex;
+            /// Notified when a task is pushed or on termination.
+            std::condition_variable WorkCondition;
+            /// Notified when a thread exits.
+            std::condition_variable ExitCondition;
+
+            /// All the following are guarded by Mutex.
+            Utilities::Collections::Queue<std::function<void()>, false> Tasks;
+            int ThreadsCount;
+            int IdleThreadsCount;
+            /// Number of the idle threads that are woken for pushed tasks but not awake yet.
+            int WakeupsCount;
+            /// Number of the threads that are created for pushed tasks but not started yet.
+            int StartupsCount;
+            bool ShouldTerminate;
+
+            void WorkerProcess();
+        };
+    }
+}
@@ -0,0 +1,193 @@
+#include "../Engine.h"
+
+#ifdef ENGINE_COROUTINES
+
+namespace Engine
+{
+    namespace Core
+    {
+        void * CoroutineFramePool::Allocate(std::size_t Size)
+        {
+            if (Size == 0 || Size > ClassSize * ClassesCount)
+                return ::operator new(Size);
+            int index = (int)((Size - 1) / ClassSize);
+            SizeClass& size_class = GetClasses()[index];
+            {
+                std::unique_lock<std::mutex> guard(size_class.Mutex);
+                if (size_class.Frames != nullptr)
+                {
+                    FreeFrame * frame = size_class.Frames;
+                    size_class.Frames = frame->Next;
+                    size_class.Count--;
+                    return frame;
+                }
+            }
+            return ::operator new((index + 1) * ClassSize);
+        }
+
+        void CoroutineFramePool::Free(void * Frame, std::size_t Size)
+        {
+            if (Size == 0 || Size > ClassSize * ClassesCount)
+            {
+                ::operator delete(Frame);
+                return;
+            }
+            SizeClass& size_class = GetClasses()[(Size - 1) / ClassSize];
+            {
+                std::unique_lock<std::mutex> guard(size_class.Mutex);
+                if (size_class.Count < MaxFramesCount)
+                {
+                    size_class.Frames = new (Frame) FreeFrame { size_class.Frames };
+                    size_class.Count++;
+                    return;
+                }
+            }
+            ::operator delete(Frame);
+        }
+
+        CoroutineFramePool::SizeClass * CoroutineFramePool::GetClasses()
+        {
+            static SizeClass * classes = new SizeClass[ClassesCount];
+            return classes;
+        }
+
+        CoroutinePromise::CoroutinePromise() : Self(nullptr), Exception(nullptr), Continuation(nullptr),
+                                               Parent(nullptr), IsSpawned(false) {}
+
+        void * CoroutinePromise::operator new(std::size_t Size)
+        {
+            return CoroutineFramePool::Allocate(Size);
+        }
+
+        void CoroutinePromise::operator delete(void * Frame, std::size_t Size)
+        {
+            CoroutineFramePool::Free(Frame, Size);
+        }
+
+        std::suspend_always CoroutinePromise::initial_suspend() noexcept
+        {
+            return std::suspend_always();
+        }
+
+        CoroutinePromise::FinalAwaiter CoroutinePromise::final_suspend() noexcept
+        {
+            return FinalAwaiter { this };
+        }
+
+        void CoroutinePromise::unhandled_exception() noexcept
+        {
+            Exception = std::current_exception();
+        }
+
+        void CoroutinePromise::Drop(CoroutinePromise * Promise)
+        {
+            while (Promise->Parent != nullptr)
+                Promise = Promise->Parent;
+            // Else it's owned by a Coroutine object
+            if (Promise->IsSpawned)
+                Promise->Self.destroy();
+        }
+
+        bool CoroutinePromise::FinalAwaiter::await_ready() noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> CoroutinePromise::FinalAwaiter::await_suspend(std::coroutine_handle<>) noexcept
+        {
+            if (Promise->Continuation)
+                return Promise->Continuation;
+            if (Promise->IsSpawned)
+            {
+                if (Promise->Exception != nullptr && Promise->ExceptionHandler != nullptr) try
+                {
+                    try
+                    {
+                        std::rethrow_exception(Promise->Exception);
+                    }
+                    catch (std::exception& e)
+                    {
+                        Promise->ExceptionHandler(e);
+                    }
+                    catch (...)
+                    {
+                        std::runtime_error e("Unknown exception (not derived from std::exception)");
+                        Promise->ExceptionHandler(e);
+                    }
+                }
+                catch (...) {} // ignore
+                Promise->Self.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void CoroutinePromise::FinalAwaiter::await_resume() noexcept {}
+
+        void CoroutineResult<void>::return_void() {}
+
+        void CoroutineResult<void>::GetResult()
+        {
+            if (Exception != nullptr)
+                std::rethrow_exception(Exception);
+        }
+
+        DelayAwaiter::DelayAwaiter(Loop * Owner, double Time) : Owner(Owner), Time(Time) {}
+
+        bool DelayAwaiter::await_ready() noexcept
+        {
+            return false;
+        }
+
+        void DelayAwaiter::await_resume() noexcept {}
+
+        void DelayAwaiter::Suspend(std::coroutine_handle<> Handle, CoroutinePromise * Promise)
+        {
+            // The coroutine is dropped by the Resumer if the schedule is never called,
+            // this awaiter may be destroyed right after scheduling
+            Owner->Schedule(Time, ExecutionType::BoundedAsync, Resumer(Handle, Promise));
+        }
+
+        DelayAwaiter::Resumer::Resumer(std::coroutine_handle<> Handle, CoroutinePromise * Promise) noexcept
+            : Handle(Handle), Promise(Promise) {}
+
+        DelayAwaiter::Resumer::Resumer(Resumer&& Op) noexcept : Handle(Op.Handle), Promise(Op.Promise)
+        {
+            Op.Handle = nullptr;
+        }
+
+        DelayAwaiter::Resumer::~Resumer()
+        {
+            if (Handle)
+                CoroutinePromise::Drop(Promise);
+        }
+
+        void DelayAwaiter::Resumer::operator()()
+        {
+            std::coroutine_handle<> handle = Handle;
+            Handle = nullptr;
+            handle.resume();
+        }
+
+        ChunkAwaiter::ChunkAwaiter(Loop * Owner, int ExecutionChunk)
+            : Owner(Owner), Chunk(ExecutionChunk), Handle(nullptr), Promise(nullptr) {}
+
+        bool ChunkAwaiter::await_ready() noexcept
+        {
+            return false;
+        }
+
+        void ChunkAwaiter::await_resume() noexcept {}
+
+        void ChunkAwaiter::Resume()
+        {
+            Handle.resume();
+        }
+
+        void ChunkAwaiter::Drop()
+        {
+            CoroutinePromise::Drop(Promise);
+        }
+    }
+}
+
+#endif
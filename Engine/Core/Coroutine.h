@@ -0,0 +1,332 @@
+#pragma once
+
+#include "../Engine.dec.h"
+
+#ifdef ENGINE_COROUTINES
+
+#include "../Utilities/InlineFunction.h"
+#include "Loop.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class CoroutineFramePool final
+        {
+        public:
+            /// @brief Gets a frame of at least Size bytes, reusing a freed one of its size class if any.
+            ///
+            /// Can be called by any thread.
+            static void * Allocate(std::size_t Size);
+            /// @brief Keeps a frame for reuse, or frees it if there are enough frames of its size class.
+            ///
+            /// @param Size The size that the frame is allocated with.
+            static void Free(void * Frame, std::size_t Size);
+        private:
+            static constexpr std::size_t ClassSize = 64;
+            static constexpr int ClassesCount = 16;
+            static constexpr int MaxFramesCount = 1024;
+
+            struct FreeFrame
+            {
+                FreeFrame * Next;
+            };
+            struct SizeClass
+            {
+                std::mutex Mutex;
+                FreeFrame * Frames = nullptr;
+                int Count = 0;
+            };
+
+            /// @brief Is never freed, so the frames can be freed at exit in any order.
+            static SizeClass * GetClasses();
+        };
+
+        class CoroutinePromise
+        {
+            template <typename T> friend class Coroutine;
+            friend Loop;
+            friend DelayAwaiter;
+            friend ChunkAwaiter;
+        public:
+            /// @brief Suspends or destroys a coroutine when it's done.
+            class FinalAwaiter final
+            {
+            public:
+                CoroutinePromise * Promise;
+
+                bool await_ready() noexcept;
+                /// @brief Resumes the awaiting coroutine, or reports the exception of a spawned one and destroys it.
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept;
+                void await_resume() noexcept;
+            };
+
+            CoroutinePromise();
+
+            static void * operator new(std::size_t Size);
+            static void operator delete(void * Frame, std::size_t Size);
+
+            /// @brief Is started when spawned or awaited.
+            std::suspend_always initial_suspend() noexcept;
+            FinalAwaiter final_suspend() noexcept;
+            void unhandled_exception() noexcept;
+        protected:
+            std::coroutine_handle<> Self;
+            std::exception_ptr Exception;
+        private:
+            /// The coroutine that awaits this one, resumed when this one is done.
+            std::coroutine_handle<> Continuation;
+            CoroutinePromise * Parent;
+            bool IsSpawned;
+            Utilities::InlineFunction<void(std::exception&)> ExceptionHandler;
+
+            /// @brief Destroys the spawned coroutine that a suspended coroutine is awaited by, with the whole chain.
+            ///
+            /// Is called when the coroutine can't be resumed.
+            static void Drop(CoroutinePromise * Promise);
+        };
+
+        /// @brief Keeps the result of a coroutine.
+        template <typename T>
+        class CoroutineResult : public CoroutinePromise
+        {
+        public:
+            void return_value(T Value);
+            /// @brief Gets the result, or rethrows the exception of the coroutine.
+            T GetResult();
+        private:
+            std::optional<T> Value;
+        };
+
+        template <>
+        class CoroutineResult<void> : public CoroutinePromise
+        {
+        public:
+            void return_void();
+            void GetResult();
+        };
+
+        /// A coroutine that is started when spawned in a Loop or awaited by another coroutine.
+        ///
+        /// Owns the coroutine, which is destroyed with this object unless it's spawned.
+        /// The frames are allocated from CoroutineFramePool.
+        template <typename T>
+        class Coroutine final
+        {
+            friend Loop;
+        public:
+            class promise_type final : public CoroutineResult<T>
+            {
+            public:
+                Coroutine get_return_object();
+            };
+
+            /// @brief Runs the coroutine until it's done, then gets its result.
+            class Awaiter final
+            {
+            public:
+                std::coroutine_handle<promise_type> Handle;
+
+                bool await_ready() noexcept;
+                template <typename PromiseType>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> Caller) noexcept;
+                /// @brief Throws std::logic_error if the coroutine is invalid.
+                T await_resume();
+            };
+
+            /// @brief Creates an invalid coroutine.
+            Coroutine() noexcept;
+            Coroutine(Coroutine&&) noexcept;
+            ~Coroutine();
+
+            Coroutine(const Coroutine&) = delete;
+            Coroutine& operator=(const Coroutine&) = delete;
+
+            Coroutine& operator=(Coroutine&&) noexcept;
+
+            bool IsValid();
+            bool IsDone();
+
+            Awaiter operator co_await() noexcept;
+        private:
+            std::coroutine_handle<promise_type> Handle;
+
+            explicit Coroutine(std::coroutine_handle<promise_type> Handle) noexcept;
+        };
+
+        class DelayAwaiter final
+        {
+        public:
+            DelayAwaiter(Loop * Owner, double Time);
+
+            bool await_ready() noexcept;
+            template <typename PromiseType>
+            void await_suspend(std::coroutine_handle<PromiseType> Handle);
+            void await_resume() noexcept;
+        private:
+            /// @brief The task of the schedule, drops the coroutine if it's cancelled before resuming it.
+            class Resumer final
+            {
+            public:
+                Resumer(std::coroutine_handle<> Handle, CoroutinePromise * Promise) noexcept;
+                Resumer(Resumer&&) noexcept;
+                ~Resumer();
+
+                Resumer(const Resumer&) = delete;
+                Resumer& operator=(const Resumer&) = delete;
+                Resumer& operator=(Resumer&&) = delete;
+
+                void operator()();
+            private:
+                std::coroutine_handle<> Handle;
+                CoroutinePromise * Promise;
+            };
+
+            Loop * Owner;
+            double Time;
+
+            void Suspend(std::coroutine_handle<> Handle, CoroutinePromise * Promise);
+        };
+
+        class ChunkAwaiter final : public Loop::ChunkWaiter
+        {
+        public:
+            ChunkAwaiter(Loop * Owner, int ExecutionChunk);
+
+            bool await_ready() noexcept;
+            template <typename PromiseType>
+            void await_suspend(std::coroutine_handle<PromiseType> Handle);
+            void await_resume() noexcept;
+
+            void Resume() override;
+            void Drop() override;
+        private:
+            Loop * Owner;
+            int Chunk;
+            std::coroutine_handle<> Handle;
+            CoroutinePromise * Promise;
+        };
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+namespace Engine
+{
+    namespace Core
+    {
+        template <typename T>
+        void CoroutineResult<T>::return_value(T Value)
+        {
+            this->Value.emplace(std::move(Value));
+        }
+
+        template <typename T>
+        T CoroutineResult<T>::GetResult()
+        {
+            if (Exception != nullptr)
+                std::rethrow_exception(Exception);
+            return std::move(*Value);
+        }
+
+        template <typename T>
+        Coroutine<T> Coroutine<T>::promise_type::get_return_object()
+        {
+            std::coroutine_handle<promise_type> handle = std::coroutine_handle<promise_type>::from_promise(*this);
+            this->Self = handle;
+            return Coroutine(handle);
+        }
+
+        template <typename T>
+        bool Coroutine<T>::Awaiter::await_ready() noexcept
+        {
+            return !Handle || Handle.done();
+        }
+
+        template <typename T>
+        template <typename PromiseType>
+        std::coroutine_handle<> Coroutine<T>::Awaiter::await_suspend(std::coroutine_handle<PromiseType> Caller) noexcept
+        {
+            static_assert(std::is_base_of<CoroutinePromise, PromiseType>::value, "Only a Coroutine can await a Coroutine.");
+            Handle.promise().Continuation = Caller;
+            Handle.promise().Parent = &Caller.promise();
+            return Handle;
+        }
+
+        template <typename T>
+        T Coroutine<T>::Awaiter::await_resume()
+        {
+            if (!Handle)
+                throw std::logic_error("The coroutine is invalid.");
+            return Handle.promise().GetResult();
+        }
+
+        template <typename T>
+        Coroutine<T>::Coroutine() noexcept : Handle(nullptr) {}
+
+        template <typename T>
+        Coroutine<T>::Coroutine(std::coroutine_handle<promise_type> Handle) noexcept : Handle(Handle) {}
+
+        template <typename T>
+        Coroutine<T>::Coroutine(Coroutine&& Op) noexcept : Handle(Op.Handle)
+        {
+            Op.Handle = nullptr;
+        }
+
+        template <typename T>
+        Coroutine<T>::~Coroutine()
+        {
+            if (Handle)
+                Handle.destroy();
+        }
+
+        template <typename T>
+        Coroutine<T>& Coroutine<T>::operator=(Coroutine&& Op) noexcept
+        {
+            if (this == &Op)
+                return *this;
+            if (Handle)
+                Handle.destroy();
+            Handle = Op.Handle;
+            Op.Handle = nullptr;
+            return *this;
+        }
+
+        template <typename T>
+        bool Coroutine<T>::IsValid()
+        {
+            return (bool)Handle;
+        }
+
+        template <typename T>
+        bool Coroutine<T>::IsDone()
+        {
+            return Handle && Handle.done();
+        }
+
+        template <typename T>
+        typename Coroutine<T>::Awaiter Coroutine<T>::operator co_await() noexcept
+        {
+            return Awaiter { Handle };
+        }
+
+        template <typename PromiseType>
+        void DelayAwaiter::await_suspend(std::coroutine_handle<PromiseType> Handle)
+        {
+            static_assert(std::is_base_of<CoroutinePromise, PromiseType>::value, "Only a Coroutine can await a delay.");
+            Suspend(Handle, &Handle.promise());
+        }
+
+        template <typename PromiseType>
+        void ChunkAwaiter::await_suspend(std::coroutine_handle<PromiseType> Handle)
+        {
+            static_assert(std::is_base_of<CoroutinePromise, PromiseType>::value, "Only a Coroutine can await a chunk.");
+            this->Handle = Handle;
+            Promise = &Handle.promise();
+            // May be resumed or destroyed right away, this awaiter is not used after
+            Owner->ResumeInChunk(this, Chunk);
+        }
+    }
+}
+
+#endif
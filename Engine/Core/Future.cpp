@@ -0,0 +1,104 @@
+#include "../Engine.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        FutureState::FutureState(Loop * Owner)
+            : Owner(Owner), References(1), isReady(false), Exception(nullptr), Callbacks(nullptr) {}
+
+        FutureState::~FutureState()
+        {
+            // The callbacks of a state that is never ready are dropped
+            while (Callbacks != nullptr)
+            {
+                Callback * next = Callbacks->Next;
+                delete Callbacks;
+                Callbacks = next;
+            }
+        }
+
+        void FutureState::Acquire()
+        {
+            References.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void FutureState::Release()
+        {
+            if (References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        bool FutureState::IsReady()
+        {
+            return isReady.load(std::memory_order_acquire);
+        }
+
+        std::exception_ptr FutureState::GetException()
+        {
+            return Exception;
+        }
+
+        void FutureState::OnReady(Utilities::InlineFunction<void()> Function, bool IsScheduled)
+        {
+            if (!isReady.load(std::memory_order_acquire))
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                if (!isReady.load(std::memory_order_relaxed))
+                {
+                    Callbacks = new Callback { std::move(Function), IsScheduled, Callbacks };
+                    return;
+                }
+            }
+            Run(Function, IsScheduled);
+        }
+
+        void FutureState::SetReady(std::exception_ptr Exception)
+        {
+            // Keeps the state while calling the callbacks
+            Acquire();
+            Callback * callbacks;
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                if (isReady.load(std::memory_order_relaxed))
+                {
+                    Release();
+                    throw std::logic_error("The result is already set.");
+                }
+                this->Exception = Exception;
+                isReady.store(true, std::memory_order_release);
+                callbacks = Callbacks;
+                Callbacks = nullptr;
+            }
+            // Reversed to the order of adding
+            Callback * first = nullptr;
+            while (callbacks != nullptr)
+            {
+                Callback * next = callbacks->Next;
+                callbacks->Next = first;
+                first = callbacks;
+                callbacks = next;
+            }
+            while (first != nullptr)
+            {
+                Callback * next = first->Next;
+                try
+                {
+                    Run(first->Function, first->IsScheduled);
+                }
+                catch (...) {} // ignore
+                delete first;
+                first = next;
+            }
+            Release();
+        }
+
+        void FutureState::Run(Utilities::InlineFunction<void()>& Function, bool IsScheduled)
+        {
+            if (IsScheduled && Owner != nullptr)
+                Owner->Schedule(0, ExecutionType::BoundedAsync, std::move(Function));
+            else
+                Function();
+        }
+    }
+}
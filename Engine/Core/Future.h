@@ -0,0 +1,490 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/InlineFunction.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class FutureState
+        {
+        public:
+            /// The loop that the continuations are scheduled in, may be null.
+            Loop * const Owner;
+
+            /// @brief Starts with the reference of the creator.
+            FutureState(Loop * Owner);
+            virtual ~FutureState();
+
+            FutureState(const FutureState&) = delete;
+            FutureState& operator=(const FutureState&) = delete;
+
+            void Acquire();
+            /// @brief Deletes the state when the last reference is released.
+            void Release();
+
+            bool IsReady();
+            /// @brief Gets the exception of a ready state, null if it has a value.
+            std::exception_ptr GetException();
+            /// @brief Calls a function once the state is ready, or right away if it's ready.
+            ///
+            /// @param IsScheduled If true, the function is scheduled in the owner loop as a BoundedAsync task.
+            ///        Else, it's called by the thread that makes the state ready, which must be quick.
+            void OnReady(Utilities::InlineFunction<void()> Callback, bool IsScheduled);
+            /// @brief Makes the state ready and calls the callbacks.
+            ///
+            /// The value must be set before, if there is no exception.
+            void SetReady(std::exception_ptr Exception);
+        private:
+            struct Callback
+            {
+                Utilities::InlineFunction<void()> Function;
+                bool IsScheduled;
+                Callback * Next;
+            };
+
+            std::atomic<int> References;
+            std::atomic<bool> isReady;
+            /// Guards the callbacks until the state is ready.
+            std::mutex Mutex;
+            std::exception_ptr Exception;
+            /// In the reverse order of adding.
+            Callback * Callbacks;
+
+            void Run(Utilities::InlineFunction<void()>& Function, bool IsScheduled);
+        };
+
+        /// @brief The future of a result, which is the result itself if it's a future.
+        template <typename ResultType>
+        struct FutureOf
+        {
+            typedef Future<ResultType> Type;
+        };
+        template <typename T>
+        struct FutureOf<Future<T>>
+        {
+            typedef Future<T> Type;
+        };
+
+        /// @brief The type of the future that Future<T>::Then returns for a continuation.
+        template <typename T, typename FunctionType>
+        struct FutureContinuation
+        {
+            typedef typename std::invoke_result<FunctionType&, const T&>::type ResultType;
+            typedef typename FutureOf<ResultType>::Type FutureType;
+        };
+        template <typename FunctionType>
+        struct FutureContinuation<void, FunctionType>
+        {
+            typedef typename std::invoke_result<FunctionType&>::type ResultType;
+            typedef typename FutureOf<ResultType>::Type FutureType;
+        };
+
+        template <typename T>
+        class Future final
+        {
+            template <typename> friend class Future;
+            template <typename> friend class Promise;
+            template <typename ItemsType> friend Future<void> WhenAll(Future<ItemsType>*, int);
+            template <typename ItemsType> friend Future<int> WhenAny(Future<ItemsType>*, int);
+        public:
+            typedef T ValueType;
+
+            /// @brief Creates a future that refers to no result.
+            Future();
+            Future(const Future&);
+            Future(Future&&) noexcept;
+            ~Future();
+
+            Future& operator=(Future) noexcept;
+
+            /// @brief Checks whether the future refers to a result.
+            bool IsValid();
+            /// @brief Checks whether the result is set.
+            ///
+            /// Can be called by any thread, without locking.
+            bool IsReady();
+            /// @brief Gets the result without waiting for it.
+            ///
+            /// Throws std::logic_error if not ready, or rethrows the exception of the result.
+            T Get();
+            /// @brief Calls a function with the value once it's ready, and gets the future of its result.
+            ///
+            /// The function is scheduled in the loop as a BoundedAsync task, it doesn't block any thread meanwhile.
+            /// If the result is an exception, the function is not called and the exception is passed on.
+            /// A function that returns a future results in that future, so that the stages can be chained.
+            /// The returned future gets an exception if the loop is stopped before the function is called.
+            ///
+            /// @param Continuation The function that takes the value, or nothing for Future<void>.
+            template <typename FunctionType>
+            typename FutureContinuation<T, FunctionType>::FutureType Then(FunctionType Continuation);
+        private:
+            typedef typename std::conditional<std::is_void<T>::value, bool, T>::type StoredType;
+
+            class State final : public FutureState
+            {
+            public:
+                /// Is set once before the state is ready.
+                std::optional<StoredType> Value;
+                State(Loop * Owner);
+            };
+
+            State * state;
+
+            /// @brief Refers to a state, taking a reference to it.
+            explicit Future(State*);
+        };
+
+        template <typename T>
+        class Promise final
+        {
+            template <typename> friend class Future;
+            friend Loop;
+        public:
+            /// @param Owner The loop that the continuations of the future are scheduled in.
+            ///        If null, they are called by the thread that sets the result.
+            Promise(Loop * Owner);
+            Promise(Promise&&) noexcept;
+            /// The future gets an exception if the result is not set.
+            ~Promise();
+
+            Promise(const Promise&) = delete;
+            Promise& operator=(const Promise&) = delete;
+
+            Promise& operator=(Promise&&) noexcept;
+
+            /// @brief Gets the future of the result, can be called many times.
+            Future<T> GetFuture();
+            /// @brief Sets the value of the result, without arguments for Promise<void>.
+            ///
+            /// Can only be called once, the promise refers to no result after that.
+            template <typename... ArgumentTypes>
+            void SetValue(ArgumentTypes&&... Value);
+            /// @brief Sets an exception as the result.
+            ///
+            /// Can only be called once, the promise refers to no result after that.
+            void SetException(std::exception_ptr Exception);
+        private:
+            typename Future<T>::State * state;
+
+            /// @brief Sets the result of calling a function, the value or the exception that it throws.
+            template <typename FunctionType, typename... ArgumentTypes>
+            void SetResultOf(FunctionType& Function, ArgumentTypes&&... Arguments);
+            /// @brief Sets the result of another future once it's ready.
+            void SetResultOf(Future<T> Other);
+        };
+
+        /// @brief Gets a future that is ready when all the futures are ready.
+        ///
+        /// Its exception is the exception of the first future that fails, if any.
+        /// The continuations are scheduled in the loop of the first future.
+        template <typename T>
+        Future<void> WhenAll(Future<T> * Futures, int Count);
+        /// @brief Gets a future of the index of the first future that is ready.
+        ///
+        /// The continuations are scheduled in the loop of the first future.
+        template <typename T>
+        Future<int> WhenAny(Future<T> * Futures, int Count);
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+namespace Engine
+{
+    namespace Core
+    {
+        template <typename T>
+        Future<T>::State::State(Loop * Owner) : FutureState(Owner) {}
+
+        template <typename T>
+        Future<T>::Future() : state(nullptr) {}
+
+        template <typename T>
+        Future<T>::Future(State * state) : state(state)
+        {
+            state->Acquire();
+        }
+
+        template <typename T>
+        Future<T>::Future(const Future& Op) : state(Op.state)
+        {
+            if (state != nullptr)
+                state->Acquire();
+        }
+
+        template <typename T>
+        Future<T>::Future(Future&& Op) noexcept : state(Op.state)
+        {
+            Op.state = nullptr;
+        }
+
+        template <typename T>
+        Future<T>::~Future()
+        {
+            if (state != nullptr)
+                state->Release();
+        }
+
+        template <typename T>
+        Future<T>& Future<T>::operator=(Future Op) noexcept
+        {
+            std::swap(state, Op.state);
+            return *this;
+        }
+
+        template <typename T>
+        bool Future<T>::IsValid()
+        {
+            return state != nullptr;
+        }
+
+        template <typename T>
+        bool Future<T>::IsReady()
+        {
+            return state != nullptr && state->IsReady();
+        }
+
+        template <typename T>
+        T Future<T>::Get()
+        {
+            if (!IsReady())
+                throw std::logic_error("The future is not ready.");
+            if (std::exception_ptr exception = state->GetException())
+                std::rethrow_exception(exception);
+            if constexpr (!std::is_void<T>::value)
+                return *state->Value;
+        }
+
+        template <typename T>
+        template <typename FunctionType>
+        typename FutureContinuation<T, FunctionType>::FutureType Future<T>::Then(FunctionType Continuation)
+        {
+            typedef typename FutureContinuation<T, FunctionType>::ResultType ResultType;
+            typedef typename FutureContinuation<T, FunctionType>::FutureType FutureType;
+            if (state == nullptr)
+                throw std::logic_error("The future refers to no result.");
+            if constexpr (std::is_same<ResultType, FutureType>::value)
+            {
+                // Chained, the result is the result of the returned future
+                Promise<typename FutureType::ValueType> promise(state->Owner);
+                FutureType result = promise.GetFuture();
+                Future<T> source = *this;
+                state->OnReady([source, promise = std::move(promise), function = std::move(Continuation)]() mutable {
+                    if (std::exception_ptr exception = source.state->GetException())
+                    {
+                        promise.SetException(exception);
+                        return;
+                    }
+                    try
+                    {
+                        if constexpr (std::is_void<T>::value)
+                            promise.SetResultOf(function());
+                        else
+                            promise.SetResultOf(function(std::as_const(*source.state->Value)));
+                    }
+                    catch (...)
+                    {
+                        if (promise.state != nullptr)
+                            promise.SetException(std::current_exception());
+                    }
+                }, true);
+                return result;
+            }
+            else
+            {
+                Promise<ResultType> promise(state->Owner);
+                Future<ResultType> result = promise.GetFuture();
+                Future<T> source = *this;
+                state->OnReady([source, promise = std::move(promise), function = std::move(Continuation)]() mutable {
+                    if (std::exception_ptr exception = source.state->GetException())
+                        promise.SetException(exception);
+                    else if constexpr (std::is_void<T>::value)
+                        promise.SetResultOf(function);
+                    else
+                        promise.SetResultOf(function, std::as_const(*source.state->Value));
+                }, true);
+                return result;
+            }
+        }
+
+        template <typename T>
+        Promise<T>::Promise(Loop * Owner) : state(new typename Future<T>::State(Owner)) {}
+
+        template <typename T>
+        Promise<T>::Promise(Promise&& Op) noexcept : state(Op.state)
+        {
+            Op.state = nullptr;
+        }
+
+        template <typename T>
+        Promise<T>::~Promise()
+        {
+            if (state != nullptr)
+                SetException(std::make_exception_ptr(std::runtime_error("The promise is dropped without a result.")));
+        }
+
+        template <typename T>
+        Promise<T>& Promise<T>::operator=(Promise&& Op) noexcept
+        {
+            if (this == &Op)
+                return *this;
+            if (state != nullptr)
+                SetException(std::make_exception_ptr(std::runtime_error("The promise is dropped without a result.")));
+            state = Op.state;
+            Op.state = nullptr;
+            return *this;
+        }
+
+        template <typename T>
+        Future<T> Promise<T>::GetFuture()
+        {
+            if (state == nullptr)
+                throw std::logic_error("The promise refers to no result.");
+            return Future<T>(state);
+        }
+
+        template <typename T>
+        template <typename... ArgumentTypes>
+        void Promise<T>::SetValue(ArgumentTypes&&... Value)
+        {
+            if (state == nullptr)
+                throw std::logic_error("The promise refers to no result.");
+            typename Future<T>::State * state = this->state;
+            this->state = nullptr;
+            if constexpr (std::is_void<T>::value)
+            {
+                static_assert(sizeof...(ArgumentTypes) == 0, "Promise<void> takes no value.");
+                state->Value.emplace(true);
+            }
+            else
+                state->Value.emplace(std::forward<ArgumentTypes>(Value)...);
+            state->SetReady(nullptr);
+            state->Release();
+        }
+
+        template <typename T>
+        void Promise<T>::SetException(std::exception_ptr Exception)
+        {
+            if (state == nullptr)
+                throw std::logic_error("The promise refers to no result.");
+            typename Future<T>::State * state = this->state;
+            this->state = nullptr;
+            state->SetReady(Exception);
+            state->Release();
+        }
+
+        template <typename T>
+        template <typename FunctionType, typename... ArgumentTypes>
+        void Promise<T>::SetResultOf(FunctionType& Function, ArgumentTypes&&... Arguments)
+        {
+            try
+            {
+                if constexpr (std::is_void<T>::value)
+                {
+                    std::invoke(Function, std::forward<ArgumentTypes>(Arguments)...);
+                    SetValue();
+                }
+                else
+                    SetValue(std::invoke(Function, std::forward<ArgumentTypes>(Arguments)...));
+            }
+            catch (...)
+            {
+                if (state != nullptr)
+                    SetException(std::current_exception());
+            }
+        }
+
+        template <typename T>
+        void Promise<T>::SetResultOf(Future<T> Other)
+        {
+            if (Other.state == nullptr)
+            {
+                SetException(std::make_exception_ptr(std::logic_error("The future refers to no result.")));
+                return;
+            }
+            typename Future<T>::State * other = Other.state;
+            other->OnReady([Other = std::move(Other), promise = std::move(*this)]() mutable {
+                if (std::exception_ptr exception = Other.state->GetException())
+                    promise.SetException(exception);
+                else if constexpr (std::is_void<T>::value)
+                    promise.SetValue();
+                else
+                    promise.SetValue(*Other.state->Value);
+            }, false);
+        }
+
+        template <typename T>
+        Future<void> WhenAll(Future<T> * Futures, int Count)
+        {
+            if (Count <= 0)
+                throw std::invalid_argument("WhenAll needs at least one future.");
+            for (int i = 0; i < Count; i++)
+                if (Futures[i].state == nullptr)
+                    throw std::invalid_argument("WhenAll needs valid futures.");
+            struct Join
+            {
+                std::atomic<int> Left;
+                std::mutex Mutex;
+                /// The first exception, guarded by Mutex.
+                std::exception_ptr Exception;
+                Promise<void> Result;
+                Join(int Count, Loop * Owner) : Left(Count), Result(Owner) {}
+            };
+            Join * join = new Join(Count, Futures[0].state->Owner);
+            Future<void> result = join->Result.GetFuture();
+            for (int i = 0; i < Count; i++)
+            {
+                FutureState * state = Futures[i].state;
+                state->OnReady([join, state]() {
+                    if (std::exception_ptr exception = state->GetException())
+                    {
+                        std::unique_lock<std::mutex> guard(join->Mutex);
+                        if (join->Exception == nullptr)
+                            join->Exception = exception;
+                    }
+                    if (join->Left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        if (join->Exception != nullptr)
+                            join->Result.SetException(join->Exception);
+                        else
+                            join->Result.SetValue();
+                        delete join;
+                    }
+                }, false);
+            }
+            return result;
+        }
+
+        template <typename T>
+        Future<int> WhenAny(Future<T> * Futures, int Count)
+        {
+            if (Count <= 0)
+                throw std::invalid_argument("WhenAny needs at least one future.");
+            for (int i = 0; i < Count; i++)
+                if (Futures[i].state == nullptr)
+                    throw std::invalid_argument("WhenAny needs valid futures.");
+            struct Join
+            {
+                std::atomic<int> Left;
+                std::atomic<bool> IsSet;
+                Promise<int> Result;
+                Join(int Count, Loop * Owner) : Left(Count), IsSet(false), Result(Owner) {}
+            };
+            Join * join = new Join(Count, Futures[0].state->Owner);
+            Future<int> result = join->Result.GetFuture();
+            for (int i = 0; i < Count; i++)
+            {
+                FutureState * state = Futures[i].state;
+                state->OnReady([join, i]() {
+                    if (!join->IsSet.exchange(true, std::memory_order_acq_rel))
+                        join->Result.SetValue(i);
+                    if (join->Left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        delete join;
+                }, false);
+            }
+            return result;
+        }
+    }
+}
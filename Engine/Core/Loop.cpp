@@ -1,22 +1,20 @@
 #include "../Engine.h"
 #include <chrono>
+#ifdef __linux__
+    #include <time.h>
+#endif
 
 namespace Engine
 {
     namespace Core
     {
-        Loop::Loop() : Chunk0ModulesStartIndex(0), Chunk0ModulesEndIndex(0),
-                                 isRunning(false),
-                                 StartTime(std::chrono::time_point<std::chrono::steady_clock>()),
-                                 Time(0), TimeDiff(0), TimeAsFloat(0), TimeDiffAsFloat(0),
-                                 ShouldStop(false),
-                                 Modules(
+        Loop::Loop() : Modules(
 
                 // OnAdd
                 [this](Utilities::Collections::List<Module*> * Parent, Module *& Item, int& Index)
                 {
                     // Don't add a module if it already exists in the list
-                    if (Parent->Contains(Item))
+                    if (ListedModules.Contains(Item))
                         throw std::invalid_argument("The module is already added to the list.");
 
                     // Decide where to place the module in the list
@@ -72,9 +70,9 @@ namespace Engine
 
                     // Add the module
                     Parent->Add(Item, Index);
+                    ListedModules.Add(Item);
                     if (isRunning)
-                        // This kind of std::tuple construction requires C++17
-                        ToEditModules.Push(std::tuple(Add, Index, Item));
+                        PublishModules(Add, Index, Item);
                 },
 
                 // OnSetItem
@@ -85,9 +83,14 @@ namespace Engine
                         if ((Index == 0 || Parent->GetItem(Index - 1)->GetExecutionChunk() <= Value->GetExecutionChunk())
                             && (Index == Parent->GetCount() - 1 || Value->GetExecutionChunk() <= Parent->GetItem(Index + 1)->GetExecutionChunk()))
                         {
+                            Module * previous = Parent->GetItem(Index);
+                            if (Value != previous && ListedModules.Contains(Value))
+                                throw std::invalid_argument("The module is already added to the list.");
                             Parent->SetItem(Index, Value);
+                            ListedModules.Remove(previous);
+                            ListedModules.Add(Value);
                             if (isRunning)
-                                ToEditModules.Push(std::tuple(Replace, Index, Value));
+                                PublishModules(Replace, Index, Value);
                         }
                         else throw std::invalid_argument("Module's ExecutionChunk doesn't match the index.");
                     }
@@ -99,11 +102,13 @@ namespace Engine
                 {
                     try
                     {
-                        int ExecutionChunk = Parent->GetItem(Index)->GetExecutionChunk();
+                        Module * item = Parent->GetItem(Index);
+                        int ExecutionChunk = item->GetExecutionChunk();
 
                         Parent->RemoveByIndex(Index);
+                        ListedModules.Remove(item);
                         if (isRunning)
-                            ToEditModules.Push(std::tuple(Remove, Index, nullptr));
+                            PublishModules(Remove, Index, nullptr);
 
                         if (ExecutionChunk <= 0)
                             Chunk0ModulesEndIndex--;
@@ -117,398 +122,728 @@ namespace Engine
                 [this](Utilities::Collections::List<Module*> * Parent)
                 {
                     Parent->Clear();
+                    ListedModules.Clear();
+                    if (isRunning)
+                        PublishModules(Clear, -1, nullptr);
+                    Chunk0ModulesStartIndex = 0;
+                    Chunk0ModulesEndIndex = 0;
+                },
+
+                // OnAssign
+                [this](Utilities::Collections::List<Module*> * Parent, Module * const * Items, int& Count)
+                {
+                    if (Count < 0)
+                        throw std::domain_error("Count is less than zero.");
+                    // Checks everything before changing the list
+                    ModulesSet assigned;
+                    for (int i = 0; i < Count; i++)
+                        if (Items[i] == nullptr)
+                            throw std::invalid_argument("The module is null.");
+                        else if (assigned.Contains(Items[i]))
+                            throw std::invalid_argument("The module is already added to the list.");
+                        else if (i > 0 && Items[i - 1]->GetExecutionChunk() > Items[i]->GetExecutionChunk())
+                            throw std::invalid_argument("The modules are not sorted by ExecutionChunk.");
+                        else
+                            assigned.Add(Items[i]);
+
+                    Parent->Assign(Items, Count);
+                    std::swap(ListedModules.Slots, assigned.Slots);
+                    std::swap(ListedModules.Capacity, assigned.Capacity);
+                    std::swap(ListedModules.Count, assigned.Count);
                     if (isRunning)
-                        ToEditModules.Push(std::tuple(Clear, -1, nullptr));
+                        PublishModules(*Parent);
                     Chunk0ModulesStartIndex = 0;
                     Chunk0ModulesEndIndex = 0;
+                    for (int i = 0; i < Count; i++)
+                    {
+                        if (Items[i]->GetExecutionChunk() < 0)
+                            Chunk0ModulesStartIndex++;
+                        if (Items[i]->GetExecutionChunk() <= 0)
+                            Chunk0ModulesEndIndex++;
+                    }
+                }
+            ),
+                                 Chunk0ModulesStartIndex(0), Chunk0ModulesEndIndex(0),
+                                 isRunning(false), SharedThreadPool(nullptr),
+                                 ThreadCpus(nullptr), ThreadCpusCount(0), WorkersCpus(nullptr), WorkersCpusCount(0),
+                                 isStablePlacementEnabled(false), SpinTime(-1), SubmitState(0), RunNumber(0),
+                                 StartTime(std::chrono::time_point<std::chrono::steady_clock>()),
+                                 ClockSequence(0), ClockTick(0), ClockTime(0), ClockTimeDiff(0),
+                                 ClockTimeAsFloat(0), ClockTimeDiffAsFloat(0), ClockLag(0),
+                                 ShouldStop(false), TickRate(0), FixedTimestep(false),
+                                 IsCalibratingSpin(false), ShortGapsRatio(0), ShortGapTime(0), Jobs(new JobPool()),
+                                 UpdatingModules(nullptr), NextEdits(nullptr), FreeEdits(nullptr),
+                                 ModuleChanges(nullptr), ModuleChangesCapacity(0), ModuleChangesCount(0),
+                                 ChunkWaiters(nullptr), Ticks(0), WaitersChunk(0),
+                                 Tasks(nullptr), TaskPointers(nullptr), TasksCapacity(0), TasksCount(0),
+                                 DispatchModules(nullptr), DispatchRecords(nullptr), DispatchChunks(nullptr), DispatchTypes(nullptr),
+                                 DispatchCapacity(0), DispatchCount(0), IsDispatchTableDirty(true),
+                                 GraphNodes(nullptr), GraphNodesCapacity(0), GraphNodesCount(0),
+                                 GraphSuccessorsStart(nullptr), GraphSuccessors(nullptr), GraphSuccessorsCapacity(0),
+                                 GraphSchedulesIndex(0), GraphRoots(nullptr), GraphSegmentEnd(0), GraphPool(nullptr),
+                                 isStatisticsEnabled(false), TickProfiler(nullptr), BarrierWaitTime(0),
+                                 isTracingEnabled(false), TickTracer(nullptr), TickChunk(0)
+        {
+
+        }
+
+        Loop::~Loop()
+        {
+            Jobs->Release();
+            delete NextEdits.load(std::memory_order_acquire);
+            delete FreeEdits.load(std::memory_order_acquire);
+            delete[] ModuleChanges;
+            delete[] Tasks;
+            delete[] TaskPointers;
+            delete[] DispatchModules;
+            delete[] DispatchRecords;
+            delete[] DispatchChunks;
+            delete[] DispatchTypes;
+            delete[] GraphNodes;
+            delete[] GraphSuccessorsStart;
+            delete[] GraphSuccessors;
+            delete[] GraphRoots;
+            delete[] ThreadCpus;
+            delete[] WorkersCpus;
+        }
+
+        void Loop::AddModules(Module * const * Items, int Count)
+        {
+            if (Count <= 0)
+                return;
+            Modules.LockAndDo([&] {
+                // Assign checks the duplicates, the null modules can't be sorted
+                for (int i = 0; i < Count; i++)
+                    if (Items[i] == nullptr)
+                        throw std::invalid_argument("The module is null.");
+                Module ** items = new Module*[Count];
+                std::copy(Items, Items + Count, items);
+                std::stable_sort(items, items + Count, [](Module * a, Module * b) {
+                    return a->GetExecutionChunk() < b->GetExecutionChunk();
+                });
+
+                // Like Add, each module is placed after the modules of its ExecutionChunk
+                int merged_count = Modules.GetCount() + Count;
+                Module ** merged = new Module*[merged_count];
+                int next = 0, merged_index = 0;
+                Modules.ForEach([&](Module * module) {
+                    for (; next < Count && items[next]->GetExecutionChunk() < module->GetExecutionChunk(); next++)
+                        merged[merged_index++] = items[next];
+                    merged[merged_index++] = module;
+                });
+                for (; next < Count; next++)
+                    merged[merged_index++] = items[next];
+                delete[] items;
+
+                try
+                {
+                    Modules.Assign(merged, merged_count);
+                }
+                catch (...)
+                {
+                    delete[] merged;
+                    throw;
+                }
+                delete[] merged;
+            });
+        }
+
+        Loop::ModulesSet::ModulesSet() : Slots(nullptr), Capacity(0), Count(0) {}
+
+        Loop::ModulesSet::~ModulesSet()
+        {
+            delete[] Slots;
+        }
+
+        bool Loop::ModulesSet::Contains(Module * Item)
+        {
+            return Count > 0 && Slots[GetSlot(Item)] == Item;
+        }
+
+        void Loop::ModulesSet::Add(Module * Item)
+        {
+            // Is kept at most half full
+            if ((Count + 1) * 2 > Capacity)
+            {
+                Module ** slots = Slots;
+                int capacity = Capacity;
+                Capacity = Capacity > 0 ? Capacity * 2 : 16;
+                Slots = new Module*[Capacity]();
+                for (int i = 0; i < capacity; i++)
+                    if (slots[i] != nullptr)
+                        Slots[GetSlot(slots[i])] = slots[i];
+                delete[] slots;
+            }
+            int slot = GetSlot(Item);
+            if (Slots[slot] == nullptr)
+            {
+                Slots[slot] = Item;
+                Count++;
+            }
+        }
+
+        void Loop::ModulesSet::Remove(Module * Item)
+        {
+            if (Count == 0)
+                return;
+            int slot = GetSlot(Item);
+            if (Slots[slot] != Item)
+                return;
+            Slots[slot] = nullptr;
+            Count--;
+            // The following modules of the probe sequence are moved back, unless it's before their home
+            int mask = Capacity - 1;
+            for (int i = (slot + 1) & mask; Slots[i] != nullptr; i = (i + 1) & mask)
+                if (((i - GetHome(Slots[i])) & mask) >= ((i - slot) & mask))
+                {
+                    Slots[slot] = Slots[i];
+                    Slots[i] = nullptr;
+                    slot = i;
+                }
+        }
+
+        void Loop::ModulesSet::Clear()
+        {
+            std::fill(Slots, Slots + Capacity, nullptr);
+            Count = 0;
+        }
+
+        int Loop::ModulesSet::GetHome(Module * Item)
+        {
+            // Fibonacci hashing, the low bits of the address are the same for the aligned objects
+            std::uint64_t hash = (std::uint64_t)(std::uintptr_t)Item * 0x9E3779B97F4A7C15ull;
+            return (int)(hash >> 32) & (Capacity - 1);
+        }
+
+        int Loop::ModulesSet::GetSlot(Module * Item)
+        {
+            int slot = GetHome(Item);
+            while (Slots[slot] != nullptr && Slots[slot] != Item)
+                slot = (slot + 1) & (Capacity - 1);
+            return slot;
+        }
+
+        Loop::ModulesSnapshot::ModulesSnapshot() : Items(nullptr), Count(0), Capacity(0) {}
+
+        Loop::ModulesSnapshot::~ModulesSnapshot()
+        {
+            delete[] Items;
+        }
+
+        void Loop::ModulesSnapshot::Assign(Utilities::Collections::List<Module*>& Source)
+        {
+            Count = 0;
+            Reserve(Source.GetCount());
+            Source.ForEach([this](Module * module) { Items[Count++] = module; });
+        }
+
+        void Loop::ModulesSnapshot::Edit(ModulesEditType Type, int Index, Module * Item)
+        {
+            switch (Type)
+            {
+                case Add:
+                    Reserve(Count + 1);
+                    std::copy_backward(Items + Index, Items + Count, Items + Count + 1);
+                    Items[Index] = Item;
+                    Count++;
+                    break;
+                case Replace:
+                    Items[Index] = Item;
+                    break;
+                case Remove:
+                    std::copy(Items + Index + 1, Items + Count, Items + Index);
+                    Count--;
+                    break;
+                case Clear:
+                    Count = 0;
+                    break;
+            }
+        }
+
+        void Loop::ModulesSnapshot::Reserve(int Count)
+        {
+            if (Capacity >= Count)
+                return;
+            int capacity = Capacity > 0 ? Capacity : 16;
+            while (capacity < Count)
+                capacity *= 2;
+            Module ** items = new Module*[capacity];
+            std::copy(Items, Items + this->Count, items);
+            delete[] Items;
+            Items = items;
+            Capacity = capacity;
+        }
+
+        Loop::ModulesEdits::ModulesEdits() : Items(nullptr), Count(0), Capacity(0) {}
+
+        Loop::ModulesEdits::~ModulesEdits()
+        {
+            delete[] Items;
+        }
+
+        void Loop::ModulesEdits::Push(ModulesEditType Type, int Index, Module * Item)
+        {
+            if (Count == Capacity)
+            {
+                int capacity = Capacity > 0 ? Capacity * 2 : 16;
+                Edit * items = new Edit[capacity];
+                std::copy(Items, Items + Count, items);
+                delete[] Items;
+                Items = items;
+                Capacity = capacity;
+            }
+            Items[Count++] = { Type, Index, Item };
+        }
+
+        void Loop::PublishModules(Utilities::Collections::List<Module*>& Source)
+        {
+            PublishModules(Clear, -1, nullptr);
+            ModulesEdits * next = NextEdits.exchange(nullptr, std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                next = FreeEdits.exchange(nullptr, std::memory_order_acquire);
+                if (next == nullptr)
+                    next = new ModulesEdits();
+            }
+            int index = 0;
+            Source.ForEach([&](Module * module) { next->Push(Add, index++, module); });
+            NextEdits.store(next, std::memory_order_release);
+            Wake();
+        }
+
+        void Loop::PublishModules(ModulesEditType Type, int Index, Module * Item)
+        {
+            // The edits between two loop updates are applied at once, the loop copies nothing
+            ModulesEdits * next = NextEdits.exchange(nullptr, std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                next = FreeEdits.exchange(nullptr, std::memory_order_acquire);
+                if (next == nullptr)
+                    next = new ModulesEdits();
+            }
+            next->Push(Type, Index, Item);
+            NextEdits.store(next, std::memory_order_release);
+            Wake();
+        }
+
+        void Loop::ApplyModules(ModulesEdits * Edits)
+        {
+            for (int i = 0; i < Edits->Count; i++)
+            {
+                const ModulesEdits::Edit& edit = Edits->Items[i];
+                switch (edit.Type)
+                {
+                    case Add:
+                        ChangeModule(edit.Item, true);
+                        break;
+                    case Replace:
+                        ChangeModule(UpdatingModules->Items[edit.Index], false);
+                        ChangeModule(edit.Item, true);
+                        break;
+                    case Remove:
+                        ChangeModule(UpdatingModules->Items[edit.Index], false);
+                        break;
+                    case Clear:
+                        for (int j = 0; j < UpdatingModules->Count; j++)
+                            ChangeModule(UpdatingModules->Items[j], false);
+                        break;
                 }
-            )
+                UpdatingModules->Edit(edit.Type, edit.Index, edit.Item);
+            }
+            IsDispatchTableDirty.store(true, std::memory_order_relaxed);
+
+            // Kept for the next publication
+            Edits->Count = 0;
+            delete FreeEdits.exchange(Edits, std::memory_order_acq_rel);
+        }
+
+        void Loop::ChangeModule(Module * Item, bool IsListed)
         {
+            Item->IsListed = IsListed;
+            if (Item->IsChangePending)
+                return;
+            if (ModuleChangesCount == ModuleChangesCapacity)
+            {
+                int capacity = ModuleChangesCapacity > 0 ? ModuleChangesCapacity * 2 : 16;
+                Module ** changes = new Module*[capacity];
+                std::copy(ModuleChanges, ModuleChanges + ModuleChangesCount, changes);
+                delete[] ModuleChanges;
+                ModuleChanges = changes;
+                ModuleChangesCapacity = capacity;
+            }
+            ModuleChanges[ModuleChangesCount++] = Item;
+            Item->IsChangePending = true;
+        }
 
+        void Loop::StartStopModules()
+        {
+            int taken = 0, changed = 0;
+            for (; taken < ModuleChangesCount && changed < MaxModuleChangesPerTick; taken++)
+            {
+                Module * module = ModuleChanges[taken];
+                if (module->IsListed == module->IsStarted)
+                {
+                    // Removed and added back, or added and removed, before its turn
+                    module->IsChangePending = false;
+                    continue;
+                }
+                std::chrono::time_point<std::chrono::steady_clock> start;
+                if (TickTracer != nullptr)
+                    start = std::chrono::steady_clock::now();
+                if (module->IsStarted)
+                {
+                    module->IsChangePending = false;
+                    module->IsStarted = false;
+                    module->_Stop();
+                    module->Release();
+                }
+                else
+                {
+                    // Throws before anything is changed if the module is in another loop
+                    module->Acquire(this);
+                    module->IsChangePending = false;
+                    module->IsStarted = true;
+                    module->_Start();
+                }
+                if (TickTracer != nullptr)
+                    TickTracer->Record(module->IsStarted ? Tracer::Add : Tracer::Remove, GetTraceName(module), 0,
+                                       start, std::chrono::steady_clock::now());
+                changed++;
+            }
+            std::copy(ModuleChanges + taken, ModuleChanges + ModuleChangesCount, ModuleChanges);
+            ModuleChangesCount -= taken;
+            if (changed > 0)
+                IsDispatchTableDirty.store(true, std::memory_order_relaxed);
         }
 
         void Loop::Run()
         {
+            ThreadPool * pool_pointer = nullptr;
             // Using Modules list lock to: 1. Prevent more than one async starts.
-            //                             2. Provide thread safety for ToEditModules modifications.
+            //                             2. Provide thread safety for publishing NextEdits.
             // NOTE: should not use the Modules list while locking isRunning to prevent deadlock
             //       as the Modules list uses this mutex inside (OnAdd, ...).
             Modules.LockAndDo([&] {                     // Lock #1
                 auto guard = isRunning.Mutex.GetLock(); // Lock #2 => no deadlock, guaranteed
                 if (isRunning)
                     throw std::logic_error("Cannot start twice.");
-                ToEditModules.Clear(); // Just to be sure
-                UpdatingModules = Modules;
-                ToSchedule.Clear(); // Just to be sure
-                ToSchedule.SetAutoShrink(false);
+                // Just to be sure
+                delete NextEdits.exchange(nullptr, std::memory_order_acquire);
+                ClearSchedules(); // Just to be sure
+                // The threads of the own pool are kept for the next runs
+                pool_pointer = SharedThreadPool;
+                if (pool_pointer == nullptr)
+                {
+                    if (OwnThreadPool == nullptr)
+                        OwnThreadPool.reset(new ThreadPool(0, "Loop Worker", 1));
+                    pool_pointer = OwnThreadPool.get();
+                }
+                // Throws if the pool is full, before anything is changed
+                pool_pointer->Attach();
+                try
+                {
+                    UpdatingModules = new ModulesSnapshot();
+                    UpdatingModules->Assign(Modules);
+                    if (pool_pointer == OwnThreadPool.get() && WorkersCpusCount > 0)
+                        pool_pointer->SetAffinity(WorkersCpus, WorkersCpusCount);
+                    // The last step that can fail, the thread isn't pinned by a failed start
+                    if (ThreadCpusCount > 0)
+                        ThreadPool::SetThreadAffinity(ThreadCpus, ThreadCpusCount);
+                }
+                catch (...)
+                {
+                    delete UpdatingModules;
+                    UpdatingModules = nullptr;
+                    pool_pointer->Detach();
+                    throw;
+                }
                 isRunning = true;
+                RunNumber.fetch_add(1, std::memory_order_relaxed);
+                SubmitState.fetch_or(1, std::memory_order_release);
                 StartTime = std::chrono::steady_clock::now();
             });
 
             // No need to shared-lock the mutex on time updates
             std::chrono::time_point<std::chrono::steady_clock> StartTimeLocalCopy = StartTime;
             double PreviousTime = 0;
-            Time = 0;
-            TimeDiff = 0;
-            TimeAsFloat = 0;
-            TimeDiffAsFloat = 0;
-
-            ShouldStop = false;
-            Schedules.Clear();
-            Schedules.SetAutoShrink(false);
-
-            UpdatingModules.ForEach([this](Module * Item) { Item->Acquire(this); Item->_Start(); });
-
-            // Threads initialization
-
-            unsigned int threads_count = std::thread::hardware_concurrency();
-            if (threads_count == 0) threads_count = 1;
-            enum thread_state
-            {
-                /// @brief Should start working, set by the main thread
-                ready,
-                /// @brief Is working, set by each thread in the pool
-                working,
-                /// @brief Waiting for the main thread to continue, set by each thread
-                passing,
-                /// @brief Current ExecutionChunk done, set by each thread
-                done,
-                /// @brief Used to detect bugs
-                error
-            };
-            Utilities::Collections::List<std::thread*, false> threads(threads_count);
-            Utilities::Collections::List<thread_state> thread_states(threads_count);
-            threads.SetAutoShrink(false);
-            thread_states.SetAutoShrink(false);
+            FrameClock clock;
+            PublishClock(clock);
 
-            std::condition_variable condition;
-            std::mutex condition_mutex;
+            // Pacing state, rebased whenever the settings are changed
+            double tick_rate = 0;
+            bool fixed_timestep = false;
+            double pacing_actual_base = 0; // The actual time of the base tick
+            double pacing_time_base = 0;   // The fixed timestep time of the base tick
+            long long paced_ticks = 0;     // The ticks since the base tick
+            bool is_first_tick = true;
+            bool should_rebase_pacing = false;
 
-            Utilities::Shared<int> CurrentExecutionChunk = -128; // Only set by the main thread
-            Utilities::Shared<int, true> ModuleIndex = 0;
-            Utilities::Shared<bool> ShouldTerminate = false;
+            ShouldStop = false;
 
-            for (int i = 0; i < threads_count; i++)
+            // The first modules are started at once, before the first loop update
+            for (int i = 0; i < UpdatingModules->Count; i++)
             {
-                thread_states.Add(done);
-                // Update loop: thread pool
-                threads.Add(new std::thread([&](int thread_index) {
-                    while (true)
-                    {
-                        std::unique_lock<std::mutex> condition_guard(condition_mutex);
-                        condition.wait(condition_guard, [&]() {
-                            return thread_states.GetItem(thread_index) == thread_state::ready;
-                        });
-                        if (ShouldTerminate)
-                        {
-                            thread_states.SetItem(thread_index, thread_state::done);
-                            condition_guard.unlock();
-                            condition.notify_all();
-                            return;
-                        }
-                        thread_states.SetItem(thread_index, thread_state::working);
-                        condition_guard.unlock();
-                        if (CurrentExecutionChunk == 0)
-                        {
-                            ScheduledJob job;
-                            bool done_for_now = false;
-                            auto guard = ModuleIndex.Mutex.GetLock();
-                            while (!Schedules.IsEmpty())
-                            {
-                                job = ScheduledJob(nullptr, nullptr);
-                                if (Schedules.GetFirstPriority() <= Time)
-                                    switch (Schedules.GetFirstItem().first)
-                                    {
-                                        case ExecutionType::FreeAsync:
-                                            std::thread([&](ScheduledJob job) {
-                                                ExecuteScheduledJob(job);
-                                            }, Schedules.Pop().second).detach();
-                                            break;
-                                        case ExecutionType::BoundedAsync:
-                                            job = Schedules.Pop().second;
-                                            break;
-                                        case ExecutionType::SingleThreaded:
-                                            condition_guard.lock();
-                                            thread_states.SetItem(thread_index, thread_state::passing);
-                                            condition_guard.unlock();
-                                            condition.notify_all();
-                                            done_for_now = true;
-                                            break;
-                                    }
-                                else break;
-                                guard.Unlock();
-                                if (done_for_now) break;
-                                if (job.Task != nullptr) ExecuteScheduledJob(job);
-                                guard = ModuleIndex.Mutex.GetLock();
-                            }
-                            // Wait for the main thread to continue to run the schedules.
-                            // And do not continue to the modules yet.
-                            if (done_for_now) continue;
-                        }
-                        {
-                            Module * module;
-                            bool done_for_now = false;
-                            auto guard = ModuleIndex.Mutex.GetLock();
-                            while (ModuleIndex < UpdatingModules.GetCount()
-                                && CurrentExecutionChunk == UpdatingModules.GetItem(ModuleIndex)->GetExecutionChunk())
-                            {
-                                if (!UpdatingModules.GetItem(ModuleIndex)->isEnabled)
-                                {
-                                    ModuleIndex = ModuleIndex + 1;
-                                    continue;
-                                }
-                                module = nullptr;
-                                switch (UpdatingModules.GetItem(ModuleIndex)->GetExecutionType())
-                                {
-                                    case ExecutionType::FreeAsync:
-                                        std::thread([&](Module * module) {
-                                            ExecuteUpdate(module);
-                                        }, UpdatingModules.GetItem(ModuleIndex)).detach();
-                                        ModuleIndex = ModuleIndex + 1;
-                                        break;
-                                    case ExecutionType::BoundedAsync:
-                                        module = UpdatingModules.GetItem(ModuleIndex);
-                                        ModuleIndex = ModuleIndex + 1;
-                                        break;
-                                    case ExecutionType::SingleThreaded:
-                                        condition_guard.lock();
-                                        thread_states.SetItem(thread_index, thread_state::passing);
-                                        condition_guard.unlock();
-                                        condition.notify_all();
-                                        done_for_now = true;
-                                        break;
-                                }
-                                guard.Unlock();
-                                if (done_for_now) break;
-                                if (module != nullptr) ExecuteUpdate(module);
-                                guard = ModuleIndex.Mutex.GetLock();
-                            }
-                            // Wait for the main thread to continue to run the modules.
-                            // And do not set the state to 'done' yet.
-                            if (done_for_now) continue;
-                        }
-                        condition_guard.lock();
-                        thread_states.SetItem(thread_index, thread_state::done);
-                        condition_guard.unlock();
-                        condition.notify_all();
-                    }
-                }, i));
-            }
-
-            auto pool_process = [&]()->thread_state {
-                // start
-                std::unique_lock<std::mutex> condition_guard(condition_mutex);
-                for (int i = 0; i < threads_count; i++)
-                    thread_states.SetItem(i, thread_state::ready);
-                condition_guard.unlock();
-                condition.notify_all();
-                // wait
-                thread_state result = thread_state::error;
-                condition_guard.lock();
-                condition.wait(condition_guard, [&]() {
-                    int done_count = 0;
-                    int passing_count = 0;
-                    for (int i = 0; i < threads_count; i++)
-                        switch (thread_states.GetItem(i))
-                        {
-                            case thread_state::done: done_count++; break;
-                            case thread_state::passing: passing_count++; break;
-                            default: return false;
-                        }
-                    if (done_count == threads_count) result = thread_state::done;
-                    else if (passing_count == threads_count) result = thread_state::passing;
-                    else result = thread_state::error;
-                    return true;
-                });
-                if (result == thread_state::error)
-                    throw std::logic_error("This is a bug!");
-                return result;
-            };
+                UpdatingModules->Items[i]->Acquire(this);
+                UpdatingModules->Items[i]->IsListed = true;
+                UpdatingModules->Items[i]->IsStarted = true;
+                UpdatingModules->Items[i]->_Start();
+            }
+
+            ThreadPool& pool = *pool_pointer;
+            bool is_own_pool = pool_pointer == OwnThreadPool.get();
+            double applied_spin_time = -1;
+            LastBatchEnd = std::chrono::time_point<std::chrono::steady_clock>();
 
-            thread_state pool_state = thread_state::done;
+            IsDispatchTableDirty.store(true, std::memory_order_relaxed);
 
-            // Update loop: main thread
+            // Update loop
             while (!ShouldStop)
             {
-                // Update Modules list changes
-                while (!ToEditModules.IsEmpty())
-                {
-                    auto item = ToEditModules.Pop();
-                    Module * to_remove;
-                    switch(std::get<0>(item))
-                    {
-                        case Add:
-                            std::get<2>(item)->Acquire(this);
-                            std::get<2>(item)->_Start();
-                            UpdatingModules.Add(std::get<2>(item), std::get<1>(item));
-                            break;
-                        case Replace:
-                            to_remove = UpdatingModules.GetItem(std::get<1>(item));
-                            to_remove->_Stop();
-                            to_remove->Release();
-                            std::get<2>(item)->Acquire(this);
-                            std::get<2>(item)->_Start();
-                            UpdatingModules.SetItem(std::get<1>(item), std::get<2>(item));
-                            break;
-                        case Remove:
-                            to_remove = UpdatingModules.GetItem(std::get<1>(item));
-                            to_remove->_Stop();
-                            to_remove->Release();
-                            UpdatingModules.RemoveByIndex(std::get<1>(item));
-                            break;
-                        case Clear:
-                            UpdatingModules.ForEach([](Module * module) {
-                                module->_Stop();
-                                module->Release();
-                            });
-                            UpdatingModules.Clear();
-                            break;
-                    }
-                }
+                // The events after this point end the idling of this tick
+                std::uint32_t wakeups = Wakeups.Value.load(std::memory_order_seq_cst);
+
+                TickProfiler = isStatisticsEnabled.load(std::memory_order_acquire) ? Statistics.get() : nullptr;
+                TickTracer = isTracingEnabled.load(std::memory_order_acquire) ? Trace.get() : nullptr;
+                std::chrono::time_point<std::chrono::steady_clock> tick_start;
+                if (TickProfiler != nullptr)
+                    tick_start = std::chrono::steady_clock::now();
+                if (TickTracer != nullptr)
+                    TickTracer->NameThread("Loop");
+
+                // Apply the latest edits of Modules, the added and removed modules are started and stopped gradually
+                ModulesEdits * next_edits = NextEdits.exchange(nullptr, std::memory_order_acquire);
+                if (next_edits != nullptr)
+                    ApplyModules(next_edits);
+                if (ModuleChangesCount > 0)
+                    StartStopModules();
 
                 // Update Schedules
-                while (!ToSchedule.IsEmpty())
+                for (ScheduledJob * job = ToSchedule.PopAll(), * next; job != nullptr; job = next)
                 {
-                    auto item = ToSchedule.Pop();
-                    Schedules.Push(std::pair(std::get<0>(item), std::get<1>(item)), std::get<2>(item));
+                    next = ToSchedule.GetNext(job);
+                    UpdateSchedule(job, tick_start);
                 }
+                if (TickProfiler != nullptr)
+                    TickProfiler->RecordSchedulesCount(Schedules.GetCount());
 
-                if (UpdatingModules.GetCount() == 0)
+                if (UpdatingModules->Count == 0)
                     break;
+                // Enabling or disabling a module also makes it dirty
+                if (IsDispatchTableDirty.exchange(false, std::memory_order_acq_rel))
+                    BuildDispatchTable();
+
+                // The waiters added from now on see the new tick, the chunks are not separated in the graph
+                WaitersChunk.store(GraphNodesCount > 0 ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min(),
+                                   std::memory_order_relaxed);
+                long long tick = Ticks.fetch_add(1, std::memory_order_release) + 1;
 
                 auto duration = std::chrono::steady_clock::now() - StartTimeLocalCopy;
-                PreviousTime = Time;
-                Time = (double)std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
-                TimeDiff = Time - PreviousTime;
-                TimeAsFloat = (float)Time;
-                TimeDiffAsFloat = (float)TimeDiff;
-
-                CurrentExecutionChunk = -128;
-                ModuleIndex = 0;
-
-                while (true)
-                {
-                    // Set ModuleIndex
-                    if (ModuleIndex >= UpdatingModules.GetCount())
-                        if (CurrentExecutionChunk <= 0)
-                            CurrentExecutionChunk = 0;
-                        else break;
-                    else if (CurrentExecutionChunk < UpdatingModules.GetItem(ModuleIndex)->GetExecutionChunk())
-                        if (CurrentExecutionChunk <= 0 && UpdatingModules.GetItem(ModuleIndex)->GetExecutionChunk() > 0)
-                            CurrentExecutionChunk = 0;
-                        else CurrentExecutionChunk = UpdatingModules.GetItem(ModuleIndex)->GetExecutionChunk();
-                    //  Normal process
-                    if (CurrentExecutionChunk == 0)
+                double actual_time = (double)std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
+                double time = actual_time;
+
+                double new_tick_rate = TickRate;
+                bool new_fixed_timestep = FixedTimestep;
+                if (should_rebase_pacing || new_tick_rate != tick_rate || new_fixed_timestep != fixed_timestep)
+                {
+                    should_rebase_pacing = false;
+                    tick_rate = new_tick_rate;
+                    fixed_timestep = new_fixed_timestep;
+                    pacing_actual_base = actual_time;
+                    pacing_time_base = is_first_tick || tick_rate == 0 ? PreviousTime : PreviousTime + 1 / tick_rate;
+                    paced_ticks = 0;
+                }
+                double lag = 0;
+                if (tick_rate > 0)
+                {
+                    double target_time = pacing_actual_base + paced_ticks / tick_rate;
+                    lag = actual_time > target_time ? actual_time - target_time : 0;
+                    if (fixed_timestep)
+                        time = pacing_time_base + paced_ticks / tick_rate;
+                }
+                is_first_tick = false;
+
+                clock.Tick++;
+                clock.Time = time;
+                clock.TimeDiff = time - PreviousTime;
+                clock.TimeAsFloat = (float)time;
+                clock.TimeDiffAsFloat = (float)(time - PreviousTime);
+                clock.Lag = lag;
+                PublishClock(clock);
+                PreviousTime = time;
+
+                // The modules are executed as soon as their predecessors in the graph are done,
+                // each SingleThreaded update waits for the previous ones.
+                // The schedules are executed right before chunk-0, only waiting if any are due.
+                if (GraphNodesCount > 0)
+                {
+                    bool schedules_done = !(Schedules.GetNextTime() <= time) && ChunkWaiters == nullptr && ToResume.IsEmpty();
+                    int start = 0;
+                    while (start < GraphNodesCount || !schedules_done)
                     {
-                        ScheduledJob job;
-                        bool pass_to_pool = false;
-                        bool chunk_done = false;
-                        auto guard = ModuleIndex.Mutex.GetLock();
-                        while (!Schedules.IsEmpty())
+                        int end = start;
+                        int limit = schedules_done ? GraphNodesCount : GraphSchedulesIndex;
+                        while (end < limit && GraphNodes[end].Type != ExecutionType::SingleThreaded)
+                            end++;
+                        ExecuteGraph(pool, start, end);
+                        if (!schedules_done && end == GraphSchedulesIndex)
                         {
-                            job = ScheduledJob(nullptr, nullptr);
-                            if (Schedules.GetFirstPriority() <= Time)
-                                switch (Schedules.GetFirstItem().first)
-                                {
-                                    case ExecutionType::FreeAsync:
-                                        std::thread([&](ScheduledJob job) {
-                                            ExecuteScheduledJob(job);
-                                        }, Schedules.Pop().second).detach();
-                                        break;
-                                    case ExecutionType::SingleThreaded:
-                                        job = Schedules.Pop().second;
-                                        break;
-                                    case ExecutionType::BoundedAsync:
-                                        pass_to_pool = true;
-                                        break;
-                                }
-                            else break;
-                            guard.Unlock();
-                            if (pass_to_pool)
-                            {
-                                chunk_done = pool_process() == thread_state::done;
-                                if (chunk_done) break;
-                                pass_to_pool = false;
-                            }
-                            if (job.Task != nullptr) ExecuteScheduledJob(job);
-                            guard = ModuleIndex.Mutex.GetLock();
+                            ExecuteSchedules(pool, time);
+                            PushWaiters(tick, std::numeric_limits<int>::max());
+                            ExecuteTasks(pool);
+                            schedules_done = true;
+                            start = end;
                         }
-                        if (chunk_done)
+                        else if (end < GraphNodesCount)
                         {
-                            // chunk-0 is done now.
-                            CurrentExecutionChunk = CurrentExecutionChunk + 1;
-                            continue;
+                            ExecuteUpdate(GraphNodes[end].Target, GraphNodes[end].Record);
+                            start = end + 1;
                         }
+                        else
+                            start = end;
                     }
+                }
+
+                // The BoundedAsync updates are collected and executed together on the pool,
+                // each ExecutionChunk and each SingleThreaded update waits for the previous ones.
+                // The schedules are executed right before chunk-0 and together with its modules.
+                int index = 0;
+                bool schedules_done = GraphNodesCount > 0;
+                // The table is kept between the ticks, so is the thread of each BoundedAsync update
+                bool is_placement_stable = isStablePlacementEnabled.load(std::memory_order_relaxed);
+                int placement = 0;
+                while (GraphNodesCount == 0 && (index < DispatchCount || !schedules_done))
+                {
+                    int chunk = index < DispatchCount ? DispatchChunks[index] : 0;
+                    std::chrono::time_point<std::chrono::steady_clock> chunk_start;
+                    TickChunk = chunk;
+                    if (TickProfiler != nullptr || TickTracer != nullptr)
+                    {
+                        chunk_start = std::chrono::steady_clock::now();
+                        BarrierWaitTime = std::chrono::steady_clock::duration(0);
+                    }
+                    WaitersChunk.store(chunk, std::memory_order_relaxed);
+                    if (!schedules_done && chunk >= 0)
+                    {
+                        ExecuteSchedules(pool, time);
+                        schedules_done = true;
+                    }
+                    PushWaiters(tick, chunk);
+                    for (; index < DispatchCount && DispatchChunks[index] == chunk; index++)
                     {
-                        Module * module;
-                        bool pass_to_pool = false;
-                        bool chunk_done = false;
-                        auto guard = ModuleIndex.Mutex.GetLock();
-                        while (ModuleIndex < UpdatingModules.GetCount()
-                            && CurrentExecutionChunk == UpdatingModules.GetItem(ModuleIndex)->GetExecutionChunk())
+                        Module * module = DispatchModules[index];
+                        Profiler::ModuleRecord * record = DispatchRecords[index];
+                        switch (DispatchTypes[index])
                         {
-                            if (!UpdatingModules.GetItem(ModuleIndex)->isEnabled)
-                            {
-                                ModuleIndex = ModuleIndex + 1;
-                                continue;
-                            }
-                            module = nullptr;
-                            switch (UpdatingModules.GetItem(ModuleIndex)->GetExecutionType())
-                            {
-                                case ExecutionType::FreeAsync:
-                                    std::thread([&](Module * module) {
-                                        ExecuteUpdate(module);
-                                    }, UpdatingModules.GetItem(ModuleIndex)).detach();
-                                    ModuleIndex = ModuleIndex + 1;
-                                    break;
-                                case ExecutionType::SingleThreaded:
-                                    module = UpdatingModules.GetItem(ModuleIndex);
-                                    ModuleIndex = ModuleIndex + 1;
-                                    break;
-                                case ExecutionType::BoundedAsync:
-                                    pass_to_pool = true;
-                                    break;
-                            }
-                            guard.Unlock();
-                            if (pass_to_pool)
-                            {
-                                chunk_done = pool_process() == thread_state::done;
-                                if (chunk_done) break;
-                                pass_to_pool = false;
-                            }
-                            if (module != nullptr) ExecuteUpdate(module);
-                            guard = ModuleIndex.Mutex.GetLock();
+                            case ExecutionType::FreeAsync:
+                                ExecuteAsyncUpdate(module, record);
+                                break;
+                            case ExecutionType::BoundedAsync:
+                                PushTask(module, record);
+                                if (is_placement_stable)
+                                    Tasks[TasksCount - 1].SetPreferredThread(placement++ % pool.GetThreadsCount());
+                                break;
+                            case ExecutionType::SingleThreaded:
+                                ExecuteTasks(pool);
+                                ExecuteUpdate(module, record);
+                                break;
                         }
                     }
-                    CurrentExecutionChunk = CurrentExecutionChunk + 1;
+                    ExecuteTasks(pool);
+                    if (TickProfiler != nullptr || TickTracer != nullptr)
+                    {
+                        auto chunk_end = std::chrono::steady_clock::now();
+                        if (TickProfiler != nullptr)
+                            TickProfiler->RecordChunk(chunk, chunk_end - chunk_start, BarrierWaitTime);
+                        if (TickTracer != nullptr)
+                            TickTracer->Record(Tracer::Chunk, nullptr, chunk, chunk_start, chunk_end);
+                    }
                 }
-            }
+                // The waiters of the chunks after the last one
+                WaitersChunk.store(std::numeric_limits<int>::max(), std::memory_order_relaxed);
+                PushWaiters(tick, std::numeric_limits<int>::max());
+                ExecuteTasks(pool);
+                if (TickProfiler != nullptr)
+                    TickProfiler->Ticks.Record(std::chrono::steady_clock::now() - tick_start);
 
-            ShouldTerminate = true;
-            pool_process();
-            for (int i = 0; i < threads_count; i++)
-            {
-                threads.GetItem(i)->join();
-                delete threads.GetItem(i);
-            }
+                // Spins for the usual short gaps, or sleeps right away if most of the gaps are long
+                double spin_time = SpinTime.load(std::memory_order_relaxed);
+                IsCalibratingSpin = spin_time < 0 && is_own_pool;
+                if (IsCalibratingSpin)
+                    spin_time = ShortGapsRatio >= 0.5 ? std::min(2 * ShortGapTime,
+                        std::chrono::duration<double>(MaxCalibratedSpinTime).count()) : 0;
+                if (spin_time >= 0 && spin_time != applied_spin_time)
+                {
+                    pool.SetSpinTime(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(spin_time)));
+                    applied_spin_time = spin_time;
+                }
 
-            UpdatingModules.ForEach([](Module * Item) { Item->_Stop(); Item->Release(); });
-            UpdatingModules.Clear();
+                // Wait for the next schedule or event if all the modules are disabled,
+                // unless the time is driven by ticks or a waiter is waiting for the next tick
+                if (DispatchCount == 0 && ModuleChangesCount == 0 && !(tick_rate > 0 && fixed_timestep) && ChunkWaiters == nullptr)
+                {
+                    double next_time = Schedules.GetNextTime();
+                    if (next_time == std::numeric_limits<double>::infinity())
+                        Wakeups.Wait(wakeups);
+                    else if (next_time > time)
+                        Wakeups.WaitUntil(wakeups, StartTimeLocalCopy + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(next_time)));
+                    should_rebase_pacing = true;
+                    continue;
+                }
+
+                // Wait for the next paced tick
+                if (tick_rate > 0)
+                {
+                    paced_ticks++;
+                    double next_time = pacing_actual_base + paced_ticks / tick_rate;
+                    duration = std::chrono::steady_clock::now() - StartTimeLocalCopy;
+                    actual_time = (double)std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
+                    if (!fixed_timestep && actual_time > next_time)
+                    {
+                        // Skip the missed ticks, the late one is started right away
+                        paced_ticks += (long long)((actual_time - next_time) * tick_rate);
+                        next_time = pacing_actual_base + paced_ticks / tick_rate;
+                    }
+                    if (actual_time < next_time)
+                        SleepUntil(StartTimeLocalCopy + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(next_time)));
+                }
+            }
 
-            Schedules.SetAutoShrink(true);
-            Schedules.Clear();
+            // The removed modules that are not stopped yet are stopped too
+            for (int i = 0; i < UpdatingModules->Count; i++)
+                UpdatingModules->Items[i]->IsListed = false;
+            for (int i = 0; i < ModuleChangesCount; i++)
+                ModuleChanges[i]->IsChangePending = false;
+            for (int i = 0; i < UpdatingModules->Count; i++)
+                if (UpdatingModules->Items[i]->IsStarted)
+                {
+                    UpdatingModules->Items[i]->IsStarted = false;
+                    UpdatingModules->Items[i]->_Stop();
+                    UpdatingModules->Items[i]->Release();
+                }
+            for (int i = 0; i < ModuleChangesCount; i++)
+                if (ModuleChanges[i]->IsStarted)
+                {
+                    ModuleChanges[i]->IsStarted = false;
+                    ModuleChanges[i]->_Stop();
+                    ModuleChanges[i]->Release();
+                }
+            ModuleChangesCount = 0;
+            delete UpdatingModules;
+            UpdatingModules = nullptr;
+            pool.Detach();
 
-            Time = 0;
-            TimeDiff = 0;
-            TimeAsFloat = 0;
-            TimeDiffAsFloat = 0;
+            PublishClock(FrameClock());
 
             Modules.LockAndDo([&] {
                 auto guard = isRunning.Mutex.GetLock();
-                ToSchedule.SetAutoShrink(true);
-                ToSchedule.Clear();
-                ToEditModules.Clear();
+                // Stop accepting schedules and wait for the ongoing submissions
+                SubmitState.fetch_and(~1u, std::memory_order_acq_rel);
+                while (SubmitState.load(std::memory_order_acquire) != 0)
+                    std::this_thread::yield();
+                ClearSchedules();
+                delete NextEdits.exchange(nullptr, std::memory_order_acquire);
                 isRunning = false;
             });
         }
@@ -516,93 +851,1213 @@ namespace Engine
         void Loop::Stop()
         {
             ShouldStop = true;
+            Wake();
         }
 
-        bool Loop::IsRunning()
+        void Loop::SetThreadPool(ThreadPool * Pool)
         {
-            return isRunning;
+            auto guard = isRunning.Mutex.GetLock();
+            if (isRunning)
+                throw std::logic_error("Cannot change the thread pool while running.");
+            SharedThreadPool = Pool;
         }
 
-        void Loop::Schedule(
-                std::function<void()> Func,
-                std::function<void(std::exception&)> ExceptionHandler,
-                double Time, ExecutionType ExecutionType
-        ) {
+        ThreadPool * Loop::GetThreadPool()
+        {
             auto guard = isRunning.Mutex.GetLock();
-            if (isRunning)
-                ToSchedule.Push(std::tuple(ExecutionType, ScheduledJob(Func, ExceptionHandler), Time));
+            return SharedThreadPool;
         }
 
-        void Loop::Schedule(
-                double Time,
-                std::function<void()> Func,
-                std::function<void(std::exception&)> ExceptionHandler,
-                ExecutionType ExecutionType
-        ) {
+        void Loop::SetThreadAffinity(const int * Cpus, int Count)
+        {
+            int * cpus = Count > 0 ? new int[Count] : nullptr;
+            std::copy(Cpus, Cpus + std::max(Count, 0), cpus);
             auto guard = isRunning.Mutex.GetLock();
-            if (isRunning)
-                ToSchedule.Push(std::tuple(ExecutionType, ScheduledJob(Func, ExceptionHandler), Time));
+            delete[] ThreadCpus;
+            ThreadCpus = cpus;
+            ThreadCpusCount = std::max(Count, 0);
         }
 
-        void Loop::Schedule(
-                double Time, ExecutionType ExecutionType,
-                std::function<void()> Func,
-                std::function<void(std::exception&)> ExceptionHandler
-        ) {
+        void Loop::SetWorkersAffinity(const int * Cpus, int Count)
+        {
+            int * cpus = Count > 0 ? new int[Count] : nullptr;
+            std::copy(Cpus, Cpus + std::max(Count, 0), cpus);
             auto guard = isRunning.Mutex.GetLock();
-            if (isRunning)
-                ToSchedule.Push(std::tuple(ExecutionType, ScheduledJob(Func, ExceptionHandler), Time));
+            delete[] WorkersCpus;
+            WorkersCpus = cpus;
+            WorkersCpusCount = std::max(Count, 0);
         }
 
-        Loop::ScheduledJob::ScheduledJob(
-            std::function<void()> Task,
-            std::function<void(std::exception&)> ExceptionHandler
-        ) : Task(Task), ExceptionHandler(ExceptionHandler) {}
+        void Loop::SetStablePlacementEnabled(bool Value)
+        {
+            isStablePlacementEnabled.store(Value, std::memory_order_relaxed);
+        }
 
-        inline void Loop::ExecuteScheduledJob(ScheduledJob& job)
+        bool Loop::IsStablePlacementEnabled()
         {
-            try
-            {
-                job.Task();
-            }
-            catch (std::exception& e)
-            {
-                if (job.ExceptionHandler != nullptr) try
-                {
-                    job.ExceptionHandler(e);
-                }
-                catch (...) {} // ignore
-            }
-            catch (...)
-            {
-                if (job.ExceptionHandler != nullptr) try
-                {
-                    std::runtime_error e("Unknown exception (not derived from std::exception)");
-                    job.ExceptionHandler(e);
-                }
-                catch (...) {} // ignore
-            }
+            return isStablePlacementEnabled.load(std::memory_order_relaxed);
         }
-        inline void Loop::ExecuteUpdate(Module * module)
+
+        void Loop::SetSpinTime(double Seconds)
         {
-            try
-            {
-                module->OnUpdate();
-            }
-            catch (std::exception& e)
-            {
-                try { module->OnException(e); }
-                catch (...) {} // ignore
-            }
-            catch (...)
-            {
-                try
-                {
-                    std::runtime_error e("Unknown exception (not derived from std::exception)");
-                    module->OnException(e);
+            if (std::isnan(Seconds) || std::isinf(Seconds))
+                throw std::domain_error("Seconds must be a finite number.");
+            SpinTime.store(Seconds, std::memory_order_relaxed);
+        }
+
+        double Loop::GetSpinTime()
+        {
+            return SpinTime.load(std::memory_order_relaxed);
+        }
+
+        bool Loop::IsRunning()
+        {
+            return (SubmitState.load(std::memory_order_acquire) & 1) != 0;
+        }
+
+        void Loop::SetTickRate(double TickRate, bool FixedTimestep)
+        {
+            if (!(TickRate >= 0) || std::isinf(TickRate))
+                throw std::domain_error("TickRate must be a finite non-negative number.");
+            this->TickRate = TickRate;
+            this->FixedTimestep = FixedTimestep;
+        }
+
+        double Loop::GetTickRate()
+        {
+            return TickRate;
+        }
+
+        bool Loop::IsFixedTimestep()
+        {
+            return FixedTimestep;
+        }
+
+        double Loop::GetLag()
+        {
+            return GetClock().Lag;
+        }
+
+        FrameClock Loop::GetClock()
+        {
+            FrameClock clock;
+            while (true)
+            {
+                unsigned int sequence = ClockSequence.load(std::memory_order_acquire);
+                // Is being written, which is a few stores once per loop update
+                if (sequence & 1)
+                    continue;
+                clock.Tick = ClockTick.load(std::memory_order_relaxed);
+                clock.Time = ClockTime.load(std::memory_order_relaxed);
+                clock.TimeDiff = ClockTimeDiff.load(std::memory_order_relaxed);
+                clock.TimeAsFloat = ClockTimeAsFloat.load(std::memory_order_relaxed);
+                clock.TimeDiffAsFloat = ClockTimeDiffAsFloat.load(std::memory_order_relaxed);
+                clock.Lag = ClockLag.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ClockSequence.load(std::memory_order_relaxed) == sequence)
+                    return clock;
+            }
+        }
+
+        void Loop::PublishClock(const FrameClock& Clock)
+        {
+            unsigned int sequence = ClockSequence.load(std::memory_order_relaxed);
+            ClockSequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            ClockTick.store(Clock.Tick, std::memory_order_relaxed);
+            ClockTime.store(Clock.Time, std::memory_order_relaxed);
+            ClockTimeDiff.store(Clock.TimeDiff, std::memory_order_relaxed);
+            ClockTimeAsFloat.store(Clock.TimeAsFloat, std::memory_order_relaxed);
+            ClockTimeDiffAsFloat.store(Clock.TimeDiffAsFloat, std::memory_order_relaxed);
+            ClockLag.store(Clock.Lag, std::memory_order_relaxed);
+            ClockSequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        void Loop::SetStatisticsEnabled(bool Value)
+        {
+            std::unique_lock<std::mutex> guard(StatisticsMutex);
+            if (Value && Statistics == nullptr)
+                Statistics.reset(new Profiler());
+            isStatisticsEnabled.store(Value, std::memory_order_release);
+            // Updates the records of the dispatched modules
+            IsDispatchTableDirty.store(true, std::memory_order_release);
+        }
+
+        bool Loop::IsStatisticsEnabled()
+        {
+            return isStatisticsEnabled.load(std::memory_order_acquire);
+        }
+
+        LoopStatistics Loop::GetStatistics()
+        {
+            LoopStatistics statistics;
+            std::unique_lock<std::mutex> guard(StatisticsMutex);
+            if (Statistics != nullptr)
+                Statistics->Read(statistics);
+            return statistics;
+        }
+
+        void Loop::ResetStatistics()
+        {
+            std::unique_lock<std::mutex> guard(StatisticsMutex);
+            if (Statistics != nullptr)
+                Statistics->Reset();
+        }
+
+        void Loop::SetTracingEnabled(bool Value)
+        {
+            std::unique_lock<std::mutex> guard(StatisticsMutex);
+            if (Value && Trace == nullptr)
+                Trace.reset(new Tracer());
+            // Keeps the module records that name the events
+            if (Value && Statistics == nullptr)
+                Statistics.reset(new Profiler());
+            isTracingEnabled.store(Value, std::memory_order_release);
+            IsDispatchTableDirty.store(true, std::memory_order_release);
+        }
+
+        bool Loop::IsTracingEnabled()
+        {
+            return isTracingEnabled.load(std::memory_order_acquire);
+        }
+
+        void Loop::WriteTrace(const std::string& FilePath)
+        {
+            std::unique_lock<std::mutex> guard(StatisticsMutex);
+            if (Trace == nullptr)
+                Trace.reset(new Tracer());
+            Trace->Write(FilePath);
+        }
+
+        void Loop::ParallelFor(int Start, int End, int Grain, std::function<void(int Start, int End)> Body)
+        {
+            if (Grain <= 0)
+                throw std::domain_error("Grain must be greater than zero.");
+            if (Start >= End)
+                return;
+
+            long long count = ((long long)End - Start + Grain - 1) / Grain;
+            if (count > std::numeric_limits<int>::max())
+                throw std::invalid_argument("The range has too many subranges, use a greater Grain.");
+            ThreadPool * pool = ThreadPool::GetCurrent();
+            if (pool == nullptr || pool->GetThreadsCount() == 1 || count == 1)
+            {
+                for (long long s = Start; s < End; s += Grain)
+                    Body((int)s, (int)std::min<long long>(s + Grain, End));
+                return;
+            }
+
+            // A few tasks per thread are enough to balance by stealing, each takes consecutive subranges
+            int tasks_count = (int)std::min<long long>(count, (long long)pool->GetThreadsCount() * 4);
+            std::mutex exception_mutex;
+            std::exception_ptr exception;
+            RangeTask * tasks = new RangeTask[tasks_count];
+            ThreadPool::Task ** task_pointers = new ThreadPool::Task*[tasks_count];
+            for (int i = 0; i < tasks_count; i++)
+            {
+                tasks[i].Body = &Body;
+                tasks[i].Start = (int)(Start + count * i / tasks_count * Grain);
+                tasks[i].End = (int)std::min<long long>(Start + count * (i + 1) / tasks_count * Grain, End);
+                tasks[i].Grain = Grain;
+                tasks[i].ExceptionMutex = &exception_mutex;
+                tasks[i].Exception = &exception;
+                task_pointers[i] = &tasks[i];
+            }
+            pool->Execute(task_pointers, tasks_count);
+            delete[] tasks;
+            delete[] task_pointers;
+            if (exception != nullptr)
+                std::rethrow_exception(exception);
+        }
+
+        ScheduleHandle Loop::Schedule(
+                Utilities::InlineFunction<void()> Func,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler,
+                double Time, ExecutionType ExecutionType
+        ) {
+            if (!IsRunning())
+                return ScheduleHandle();
+            ScheduledJob * job = Jobs->Create(RunNumber.load(std::memory_order_relaxed), std::move(Func), std::move(ExceptionHandler), ExecutionType, Time);
+            ScheduleHandle handle(this, job);
+            SubmitJob(job);
+            return handle;
+        }
+
+        ScheduleHandle Loop::Schedule(
+                double Time,
+                Utilities::InlineFunction<void()> Func,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler,
+                ExecutionType ExecutionType
+        ) {
+            if (!IsRunning())
+                return ScheduleHandle();
+            ScheduledJob * job = Jobs->Create(RunNumber.load(std::memory_order_relaxed), std::move(Func), std::move(ExceptionHandler), ExecutionType, Time);
+            ScheduleHandle handle(this, job);
+            SubmitJob(job);
+            return handle;
+        }
+
+        ScheduleHandle Loop::Schedule(
+                double Time, ExecutionType ExecutionType,
+                Utilities::InlineFunction<void()> Func,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler
+        ) {
+            if (!IsRunning())
+                return ScheduleHandle();
+            ScheduledJob * job = Jobs->Create(RunNumber.load(std::memory_order_relaxed), std::move(Func), std::move(ExceptionHandler), ExecutionType, Time);
+            ScheduleHandle handle(this, job);
+            SubmitJob(job);
+            return handle;
+        }
+
+        void Loop::ScheduleBatch(ScheduleItem * Items, int Count, ScheduleHandle * Handles)
+        {
+            if (Count <= 0 || !IsRunning())
+            {
+                if (Handles != nullptr)
+                    for (int i = 0; i < Count; i++)
+                        Handles[i] = ScheduleHandle();
+                return;
+            }
+            // Kept by the thread for its next batches
+            static thread_local std::unique_ptr<ScheduledJob*[]> batch_jobs;
+            static thread_local int batch_capacity = 0;
+            if (batch_capacity < Count)
+            {
+                batch_jobs.reset(new ScheduledJob*[Count]);
+                batch_capacity = Count;
+            }
+            ScheduledJob ** jobs = batch_jobs.get();
+            int created = 0;
+            try
+            {
+                for (; created < Count; created++)
+                    jobs[created] = Jobs->Create(
+                        RunNumber.load(std::memory_order_relaxed),
+                        std::move(Items[created].Task), std::move(Items[created].ExceptionHandler),
+                        Items[created].Type, Items[created].Time
+                    );
+            }
+            catch (...)
+            {
+                for (int i = 0; i < created; i++)
+                {
+                    jobs[i]->State.store(ScheduledJob::Cancelled, std::memory_order_relaxed);
+                    ReleaseJob(jobs[i]);
+                }
+                throw;
+            }
+            if (Handles != nullptr)
+                for (int i = 0; i < Count; i++)
+                    Handles[i] = ScheduleHandle(this, jobs[i]);
+            SubmitJob(jobs, Count);
+        }
+
+        ScheduleHandle Loop::ScheduleEvery(
+                double Period,
+                Utilities::InlineFunction<void()> Func,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler,
+                RecurrencePolicy Policy, ExecutionType ExecutionType
+        ) {
+            if (!(Period > 0))
+                throw std::invalid_argument("Period must be positive.");
+            if (!IsRunning())
+                return ScheduleHandle();
+            ScheduledJob * job = Jobs->Create(RunNumber.load(std::memory_order_relaxed), std::move(Func), std::move(ExceptionHandler), ExecutionType, GetClock().Time + Period, Period, Policy);
+            ScheduleHandle handle(this, job);
+            SubmitJob(job);
+            return handle;
+        }
+
+        void Loop::ResumeInChunk(ChunkWaiter * Waiter, int ExecutionChunk)
+        {
+            // The chunk is read after the tick, so it's not older than the tick
+            long long tick = Ticks.load(std::memory_order_acquire);
+            Waiter->TargetTick = ExecutionChunk > WaitersChunk.load(std::memory_order_relaxed) ? tick : tick + 1;
+            Waiter->ExecutionChunk = ExecutionChunk;
+            if ((SubmitState.fetch_add(2, std::memory_order_acquire) & 1) != 0)
+            {
+                ToResume.Push(Waiter);
+                Wake();
+                SubmitState.fetch_sub(2, std::memory_order_release);
+            }
+            else
+            {
+                SubmitState.fetch_sub(2, std::memory_order_release);
+                Waiter->Drop();
+            }
+        }
+
+#ifdef ENGINE_COROUTINES
+        void Loop::Spawn(Coroutine<void> Task, Utilities::InlineFunction<void(std::exception&)> ExceptionHandler)
+        {
+            // Else destroyed with the parameter
+            if (!Task.Handle || !IsRunning())
+                return;
+            std::coroutine_handle<Coroutine<void>::promise_type> handle = Task.Handle;
+            Task.Handle = nullptr;
+            handle.promise().IsSpawned = true;
+            handle.promise().ExceptionHandler = std::move(ExceptionHandler);
+            handle.resume();
+        }
+
+        DelayAwaiter Loop::Delay(double Seconds)
+        {
+            return DelayAwaiter(this, GetClock().Time + Seconds);
+        }
+
+        ChunkAwaiter Loop::NextTick()
+        {
+            return ChunkAwaiter(this, std::numeric_limits<int>::min());
+        }
+
+        ChunkAwaiter Loop::NextChunk(int ExecutionChunk)
+        {
+            return ChunkAwaiter(this, ExecutionChunk);
+        }
+#endif
+
+        Loop::JobPool::JobPool() : References(1), FreeJobs(nullptr) {}
+
+        Loop::JobPool::~JobPool()
+        {
+            for (ScheduledJob * job = FreeJobs, * next; job != nullptr; job = next)
+            {
+                next = Utilities::Collections::MPSCQueue<ScheduledJob>::GetNext(job);
+                delete job;
+            }
+            for (ScheduledJob * job = Recycled.PopAll(), * next; job != nullptr; job = next)
+            {
+                next = Recycled.GetNext(job);
+                delete job;
+            }
+        }
+
+        Loop::ScheduledJob * Loop::JobPool::Create(
+            std::uint64_t RunNumber,
+            Utilities::InlineFunction<void()> Task,
+            Utilities::InlineFunction<void(std::exception&)> ExceptionHandler,
+            ExecutionType Type,
+            double DueTime,
+            double Period,
+            RecurrencePolicy Policy
+        ) {
+            ScheduledJob * job;
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                if (FreeJobs == nullptr)
+                    FreeJobs = Recycled.PopAll();
+                job = FreeJobs;
+                if (job != nullptr)
+                    FreeJobs = Recycled.GetNext(job);
+            }
+            if (job == nullptr)
+                job = new ScheduledJob();
+            job->Task = std::move(Task);
+            job->ExceptionHandler = std::move(ExceptionHandler);
+            job->Type = Type;
+            job->DueTime.store(DueTime, std::memory_order_relaxed);
+            job->Period = Period;
+            job->Policy = Policy;
+            job->ReadyTime = std::chrono::time_point<std::chrono::steady_clock>();
+            job->State.store(ScheduledJob::Pending, std::memory_order_relaxed);
+            job->IsQueued.store(true, std::memory_order_relaxed);
+            job->References.store(1, std::memory_order_relaxed);
+            job->Pool = this;
+            job->RunNumber = RunNumber;
+            References.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+
+        void Loop::JobPool::Recycle(ScheduledJob * job)
+        {
+            job->Task = nullptr;
+            job->ExceptionHandler = nullptr;
+            Recycled.Push(job);
+            Release();
+        }
+
+        void Loop::JobPool::Release()
+        {
+            if (References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        void Loop::SubmitJob(ScheduledJob * job)
+        {
+            // Lock-free check, also counts this thread as submitting
+            // so that the loop doesn't clear ToSchedule meanwhile.
+            if ((SubmitState.fetch_add(2, std::memory_order_acquire) & 1) != 0)
+            {
+                ToSchedule.Push(job);
+                Wake();
+            }
+            else
+            {
+                job->IsQueued.store(false, std::memory_order_relaxed);
+                CancelJob(job);
+                ReleaseJob(job);
+            }
+            SubmitState.fetch_sub(2, std::memory_order_release);
+        }
+
+        void Loop::SubmitJob(ScheduledJob ** jobs, int Count)
+        {
+            if ((SubmitState.fetch_add(2, std::memory_order_acquire) & 1) != 0)
+            {
+                ToSchedule.Push(jobs, Count);
+                Wake();
+            }
+            else
+                for (int i = 0; i < Count; i++)
+                {
+                    jobs[i]->IsQueued.store(false, std::memory_order_relaxed);
+                    CancelJob(jobs[i]);
+                    ReleaseJob(jobs[i]);
+                }
+            SubmitState.fetch_sub(2, std::memory_order_release);
+        }
+
+        void Loop::Requeue(ScheduledJob * job)
+        {
+            if (job->IsQueued.exchange(true, std::memory_order_acq_rel))
+                return;
+            job->References.fetch_add(1, std::memory_order_relaxed);
+            SubmitJob(job);
+        }
+
+        void Loop::UpdateSchedule(ScheduledJob * job, std::chrono::time_point<std::chrono::steady_clock> TickStart)
+        {
+            // The changes after this point queue the job again, the ones before it are seen here
+            job->IsQueued.exchange(false, std::memory_order_acq_rel);
+            // A recurring job that was running while the previous run stopped, which was never in Schedules
+            if (job->RunNumber != RunNumber.load(std::memory_order_relaxed))
+            {
+                CancelJob(job);
+                ReleaseJob(job);
+                return;
+            }
+            if (job->State.load(std::memory_order_acquire) == ScheduledJob::Pending)
+            {
+                if (job->IsLinked())
+                    Schedules.Remove(job);
+                else
+                    job->References.fetch_add(1, std::memory_order_relaxed);
+                ArmJob(job, job->DueTime.load(std::memory_order_relaxed), TickStart);
+            }
+            else if (job->IsLinked())
+            {
+                // Cancelled, the reference of Schedules is released
+                Schedules.Remove(job);
+                ReleaseJob(job);
+            }
+            ReleaseJob(job);
+        }
+
+        void Loop::CancelJob(ScheduledJob * job)
+        {
+            int state = ScheduledJob::Pending;
+            if (job->State.compare_exchange_strong(state, ScheduledJob::Cancelled, std::memory_order_acq_rel))
+            {
+                job->Task = nullptr;
+                job->ExceptionHandler = nullptr;
+            }
+        }
+
+        void Loop::ArmJob(
+            ScheduledJob * job, double DueTime,
+            std::chrono::time_point<std::chrono::steady_clock> TickStart
+        ) {
+            if (TickProfiler != nullptr)
+                job->ReadyTime = std::max(
+                    StartTime.Get() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(DueTime)),
+                    TickStart);
+            else
+                job->ReadyTime = std::chrono::time_point<std::chrono::steady_clock>();
+            Schedules.Push(job, DueTime);
+        }
+
+        void Loop::FinishJob(ScheduledJob * job, bool IsLoopThread)
+        {
+            int state = ScheduledJob::Running;
+            if (job->Period > 0 && job->State.compare_exchange_strong(state, ScheduledJob::Pending, std::memory_order_acq_rel))
+            {
+                // The reference of Schedules is kept, or passed to ToSchedule
+                if (IsLoopThread)
+                    ArmJob(job, job->DueTime.load(std::memory_order_relaxed),
+                           std::chrono::time_point<std::chrono::steady_clock>());
+                else
+                {
+                    Requeue(job);
+                    ReleaseJob(job);
+                }
+                return;
+            }
+            // Else done, or cancelled while running
+            job->Task = nullptr;
+            job->ExceptionHandler = nullptr;
+            if (state == ScheduledJob::Running)
+                job->State.store(ScheduledJob::Done, std::memory_order_release);
+            ReleaseJob(job);
+        }
+
+        void Loop::ReleaseJob(ScheduledJob * job)
+        {
+            if (job->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                job->Pool->Recycle(job);
+        }
+
+        void Loop::ClearSchedules()
+        {
+            for (ScheduledJob * job = ToSchedule.PopAll(), * next; job != nullptr; job = next)
+            {
+                next = ToSchedule.GetNext(job);
+                job->IsQueued.store(false, std::memory_order_seq_cst);
+                CancelJob(job);
+                ReleaseJob(job);
+            }
+            while (ScheduledJob * job = Schedules.Pop())
+            {
+                CancelJob(job);
+                ReleaseJob(job);
+            }
+            // A dropped waiter may be freed, so the next one is read before
+            for (ChunkWaiter * waiter = ToResume.PopAll(), * next; waiter != nullptr; waiter = next)
+            {
+                next = ToResume.GetNext(waiter);
+                waiter->Drop();
+            }
+            for (ChunkWaiter * next; ChunkWaiters != nullptr; ChunkWaiters = next)
+            {
+                next = ChunkWaiters->ChunkNext;
+                ChunkWaiters->Drop();
+            }
+        }
+
+        Loop::UpdateTask::UpdateTask() : Owner(nullptr), Target(nullptr), Record(nullptr), Job(nullptr), Waiter(nullptr) {}
+
+        void Loop::UpdateTask::Execute()
+        {
+            if (Target != nullptr)
+                Owner->ExecuteUpdate(Target, Record);
+            else if (Job != nullptr)
+                Owner->ExecuteScheduledJob(*Job);
+            else try
+            {
+                Waiter->Resume();
+            }
+            catch (...) {} // ignore
+        }
+
+        void Loop::BuildDispatchTable()
+        {
+            if (DispatchCapacity < UpdatingModules->Count)
+            {
+                int capacity = DispatchCapacity > 0 ? DispatchCapacity : 16;
+                while (capacity < UpdatingModules->Count)
+                    capacity *= 2;
+                delete[] DispatchModules;
+                delete[] DispatchRecords;
+                delete[] DispatchChunks;
+                delete[] DispatchTypes;
+                DispatchModules = new Module*[capacity];
+                DispatchRecords = new Profiler::ModuleRecord*[capacity];
+                DispatchChunks = new int[capacity];
+                DispatchTypes = new ExecutionType[capacity];
+                DispatchCapacity = capacity;
+            }
+
+            // UpdatingModules is sorted by ExecutionChunk, so is the table
+            DispatchCount = 0;
+            Profiler * profiler = TickProfiler != nullptr || TickTracer != nullptr ? Statistics.get() : nullptr;
+            bool has_dependencies = false;
+            for (int i = 0; i < UpdatingModules->Count; i++)
+            {
+                Module * module = UpdatingModules->Items[i];
+                if (!module->IsEnabled() || !module->IsStarted)
+                    continue;
+                if (module->HasDependencies())
+                    has_dependencies = true;
+                DispatchModules[DispatchCount] = module;
+                if (profiler != nullptr && module->ProfilerRecord == nullptr)
+                    module->ProfilerRecord = profiler->GetModuleRecord(module);
+                DispatchRecords[DispatchCount] = profiler != nullptr ? module->ProfilerRecord : nullptr;
+                DispatchChunks[DispatchCount] = module->GetExecutionChunk();
+                DispatchTypes[DispatchCount] = module->GetExecutionType();
+                DispatchCount++;
+            }
+
+            if (has_dependencies)
+                BuildDependencyGraph();
+            else
+                GraphNodesCount = 0;
+        }
+
+        void Loop::BuildDependencyGraph()
+        {
+            // Each chunk except the first one has a join, which waits for the joins and modules before it
+            if (GraphNodesCapacity < DispatchCount * 2)
+            {
+                delete[] GraphNodes;
+                delete[] GraphSuccessorsStart;
+                delete[] GraphRoots;
+                GraphNodesCapacity = DispatchCount * 2;
+                GraphNodes = new GraphNode[GraphNodesCapacity];
+                GraphSuccessorsStart = new int[GraphNodesCapacity + 1];
+                GraphRoots = new ThreadPool::Task*[GraphNodesCapacity];
+            }
+
+            // To find the dispatch index of a module
+            std::pair<Module*, int> * lookup = new std::pair<Module*, int>[DispatchCount];
+            for (int i = 0; i < DispatchCount; i++)
+                lookup[i] = std::make_pair(DispatchModules[i], i);
+            std::sort(lookup, lookup + DispatchCount);
+            auto find = [&](Module * module) {
+                auto item = std::lower_bound(lookup, lookup + DispatchCount, std::make_pair(module, -1));
+                return item != lookup + DispatchCount && item->first == module ? item->second : -1;
+            };
+
+            // Sort each chunk topologically, keeping the order of the independent modules
+            int * order = new int[DispatchCount];         // Position => dispatch index
+            int * positions = new int[DispatchCount];     // Dispatch index => node index
+            std::int_fast8_t * states = new std::int_fast8_t[DispatchCount](); // 0: new, 1: visiting, 2: done
+            // A module is pushed once, and at most once more for each module that depends on it
+            int stack_capacity = DispatchCount;
+            for (int i = 0; i < DispatchCount; i++)
+                if (DispatchModules[i]->HasDependencies())
+                    stack_capacity += DispatchModules[i]->Declarations->Dependencies.GetCount();
+            int * stack = new int[stack_capacity];
+            int ordered_count = 0;
+            for (int chunk_start = 0, chunk_end; chunk_start < DispatchCount; chunk_start = chunk_end)
+            {
+                for (chunk_end = chunk_start; chunk_end < DispatchCount
+                        && DispatchChunks[chunk_end] == DispatchChunks[chunk_start]; chunk_end++);
+                for (int i = chunk_start; i < chunk_end; i++)
+                {
+                    if (states[i] != 0)
+                        continue;
+                    int stack_count = 0;
+                    stack[stack_count++] = i;
+                    while (stack_count > 0)
+                    {
+                        int top = stack[stack_count - 1];
+                        if (states[top] == 0)
+                        {
+                            states[top] = 1;
+                            // Pushed in reverse to visit the dependencies in order
+                            Module * module = DispatchModules[top];
+                            int dependencies_count = module->HasDependencies() ? module->Declarations->Dependencies.GetCount() : 0;
+                            for (int d = dependencies_count - 1; d >= 0; d--)
+                            {
+                                int dependency = find(module->Declarations->Dependencies.GetItem(d));
+                                if (dependency >= chunk_start && dependency < chunk_end && states[dependency] == 0)
+                                    stack[stack_count++] = dependency;
+                            }
+                        }
+                        else
+                        {
+                            stack_count--;
+                            if (states[top] == 1)
+                            {
+                                states[top] = 2;
+                                order[ordered_count++] = top;
+                            }
+                        }
+                    }
+                }
+            }
+
+            int edges_capacity = DispatchCount * 4;
+            int edges_count = 0;
+            std::pair<int, int> * edges = new std::pair<int, int>[edges_capacity];
+            auto add_edge = [&](int from, int to) {
+                if (from == to)
+                    return;
+                if (edges_count == edges_capacity)
+                {
+                    std::pair<int, int> * new_edges = new std::pair<int, int>[edges_capacity * 2];
+                    std::copy(edges, edges + edges_count, new_edges);
+                    delete[] edges;
+                    edges = new_edges;
+                    edges_capacity *= 2;
+                }
+                edges[edges_count++] = std::make_pair(from, to);
+            };
+
+            // The nodes and the chunk edges
+            GraphNodesCount = 0;
+            GraphSchedulesIndex = -1;
+            int previous_join = -1;
+            int previous_chunk_start = 0; // The node index of the first module of the previous chunk
+            for (int position = 0; position < DispatchCount; position++)
+            {
+                int index = order[position];
+                bool is_chunk_start = position == 0 || DispatchChunks[index] != DispatchChunks[order[position - 1]];
+                if (is_chunk_start && position > 0)
+                {
+                    GraphNode& join = GraphNodes[GraphNodesCount];
+                    join.Owner = this;
+                    join.Target = nullptr;
+                    join.Record = nullptr;
+                    join.Type = ExecutionType::BoundedAsync;
+                    join.ExecutionChunk = DispatchChunks[index];
+                    if (previous_join >= 0)
+                        add_edge(previous_join, GraphNodesCount);
+                    for (int i = previous_chunk_start; i < GraphNodesCount; i++)
+                        add_edge(i, GraphNodesCount);
+                    previous_join = GraphNodesCount;
+                    GraphNodesCount++;
+                }
+                if (is_chunk_start)
+                    previous_chunk_start = GraphNodesCount;
+                if (GraphSchedulesIndex < 0 && DispatchChunks[index] >= 0)
+                    GraphSchedulesIndex = is_chunk_start && previous_join >= 0 ? previous_join : GraphNodesCount;
+
+                GraphNode& node = GraphNodes[GraphNodesCount];
+                node.Owner = this;
+                node.Target = DispatchModules[index];
+                node.Record = DispatchRecords[index];
+                node.Type = DispatchTypes[index];
+                node.ExecutionChunk = DispatchChunks[index];
+                positions[index] = GraphNodesCount;
+                // Every module waits for the lower chunks, the declarations only order a chunk
+                if (previous_join >= 0)
+                    add_edge(previous_join, GraphNodesCount);
+                GraphNodesCount++;
+            }
+            if (GraphSchedulesIndex < 0)
+                GraphSchedulesIndex = GraphNodesCount;
+
+            // The module edges, which go forward as the dependencies are sorted
+            struct ResourceAccess
+            {
+                std::string Name;
+                int Node;
+                bool IsWrite;
+                bool operator<(const ResourceAccess& Other) const
+                {
+                    int comparison = Name.compare(Other.Name);
+                    if (comparison != 0)
+                        return comparison < 0;
+                    if (Node != Other.Node)
+                        return Node < Other.Node;
+                    return !IsWrite && Other.IsWrite;
+                }
+            };
+            Utilities::Collections::List<ResourceAccess, false> accesses;
+            for (int i = 0; i < DispatchCount; i++)
+            {
+                Module * module = DispatchModules[i];
+                if (!module->HasDependencies())
+                    continue;
+                module->Declarations->Dependencies.ForEach([&](Module * dependency) {
+                    int dependency_index = find(dependency);
+                    if (dependency_index >= 0)
+                        add_edge(positions[dependency_index], positions[i]);
+                });
+                module->Declarations->ReadResources.ForEach([&](std::string resource) {
+                    accesses.Add(ResourceAccess{ resource, positions[i], false });
+                });
+                module->Declarations->WriteResources.ForEach([&](std::string resource) {
+                    accesses.Add(ResourceAccess{ resource, positions[i], true });
+                });
+            }
+            ResourceAccess * sorted_accesses = new ResourceAccess[accesses.GetCount() > 0 ? accesses.GetCount() : 1];
+            for (int i = 0; i < accesses.GetCount(); i++)
+                sorted_accesses[i] = accesses.GetItem(i);
+            std::sort(sorted_accesses, sorted_accesses + accesses.GetCount());
+            // A read waits for the last write, a write waits for the reads since the last write or else the last write
+            int last_write = -1;
+            int reads_start = 0;
+            for (int i = 0; i < accesses.GetCount(); i++)
+            {
+                ResourceAccess& access = sorted_accesses[i];
+                if (i > 0 && access.Name != sorted_accesses[i - 1].Name)
+                {
+                    last_write = -1;
+                    reads_start = i;
+                }
+                if (!access.IsWrite)
+                {
+                    if (last_write >= 0)
+                        add_edge(last_write, access.Node);
+                    continue;
+                }
+                if (reads_start < i)
+                    for (int r = reads_start; r < i; r++)
+                        add_edge(sorted_accesses[r].Node, access.Node);
+                else if (last_write >= 0)
+                    add_edge(last_write, access.Node);
+                last_write = access.Node;
+                reads_start = i + 1;
+            }
+
+            // Compressed successor lists
+            std::sort(edges, edges + edges_count);
+            edges_count = (int)(std::unique(edges, edges + edges_count) - edges);
+            if (GraphSuccessorsCapacity < edges_count)
+            {
+                delete[] GraphSuccessors;
+                GraphSuccessorsCapacity = edges_count;
+                GraphSuccessors = new int[GraphSuccessorsCapacity];
+            }
+            for (int i = 0, e = 0; i <= GraphNodesCount; i++)
+            {
+                GraphSuccessorsStart[i] = e;
+                for (; e < edges_count && edges[e].first == i; e++)
+                    GraphSuccessors[e] = edges[e].second;
+            }
+
+            delete[] lookup;
+            delete[] order;
+            delete[] positions;
+            delete[] states;
+            delete[] stack;
+            delete[] edges;
+            delete[] sorted_accesses;
+        }
+
+        void Loop::ExecuteGraph(ThreadPool& pool, int Start, int End)
+        {
+            if (Start >= End)
+                return;
+            GraphSegmentEnd = End;
+            GraphPool = &pool;
+            for (int i = Start; i < End; i++)
+                GraphNodes[i].PredecessorsLeft.store(0, std::memory_order_relaxed);
+            for (int i = Start; i < End; i++)
+                for (int e = GraphSuccessorsStart[i]; e < GraphSuccessorsStart[i + 1] && GraphSuccessors[e] < End; e++)
+                    GraphNodes[GraphSuccessors[e]].PredecessorsLeft.fetch_add(1, std::memory_order_relaxed);
+            int roots_count = 0;
+            for (int i = Start; i < End; i++)
+                if (GraphNodes[i].PredecessorsLeft.load(std::memory_order_relaxed) == 0)
+                    GraphRoots[roots_count++] = &GraphNodes[i];
+
+            TickChunk = GraphNodes[Start].ExecutionChunk;
+            std::chrono::steady_clock::duration previous_wait_time = BarrierWaitTime;
+            pool.Execute(GraphRoots, roots_count, TickProfiler != nullptr || TickTracer != nullptr ? &BarrierWaitTime : nullptr);
+            if (TickTracer != nullptr)
+            {
+                auto end = std::chrono::steady_clock::now();
+                TickTracer->Record(Tracer::Barrier, nullptr, TickChunk, end - (BarrierWaitTime - previous_wait_time), end);
+            }
+        }
+
+        Loop::GraphNode::GraphNode() : Owner(nullptr), Target(nullptr), Record(nullptr),
+                                       Type(ExecutionType::BoundedAsync), ExecutionChunk(0), PredecessorsLeft(0) {}
+
+        void Loop::GraphNode::Execute()
+        {
+            if (Target != nullptr)
+            {
+                if (Type == ExecutionType::FreeAsync)
+                    Owner->ExecuteAsyncUpdate(Target, Record);
+                else
+                    Owner->ExecuteUpdate(Target, Record);
+            }
+
+            // The successors are sorted, the ones after the segment are not counted
+            int * successors = Owner->GraphSuccessors;
+            for (int e = Owner->GraphSuccessorsStart[this - Owner->GraphNodes],
+                     end = Owner->GraphSuccessorsStart[this - Owner->GraphNodes + 1];
+                 e < end && successors[e] < Owner->GraphSegmentEnd; e++)
+            {
+                GraphNode& successor = Owner->GraphNodes[successors[e]];
+                if (successor.PredecessorsLeft.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    Owner->GraphPool->Push(&successor);
+            }
+        }
+
+        void Loop::RangeTask::Execute()
+        {
+            for (long long s = Start; s < End; s += Grain)
+                try
+                {
+                    (*Body)((int)s, (int)std::min<long long>(s + Grain, End));
+                }
+                catch (...)
+                {
+                    std::unique_lock<std::mutex> guard(*ExceptionMutex);
+                    if (*Exception == nullptr)
+                        *Exception = std::current_exception();
+                }
+        }
+
+        void Loop::PushTask(Module * module, Profiler::ModuleRecord * record)
+        {
+            if (TasksCount >= TasksCapacity)
+            {
+                int capacity = TasksCapacity > 0 ? TasksCapacity * 2 : 16;
+                UpdateTask * tasks = new UpdateTask[capacity];
+                for (int i = 0; i < TasksCount; i++)
+                    tasks[i] = Tasks[i];
+                delete[] Tasks;
+                delete[] TaskPointers;
+                Tasks = tasks;
+                TaskPointers = new ThreadPool::Task*[capacity];
+                TasksCapacity = capacity;
+            }
+            Tasks[TasksCount].Owner = this;
+            Tasks[TasksCount].Target = module;
+            Tasks[TasksCount].Record = record;
+            Tasks[TasksCount].Job = nullptr;
+            Tasks[TasksCount].Waiter = nullptr;
+            Tasks[TasksCount].SetPreferredThread(-1);
+            TasksCount++;
+        }
+
+        void Loop::PushTask(ScheduledJob * job)
+        {
+            PushTask(nullptr, nullptr);
+            Tasks[TasksCount - 1].Job = job;
+        }
+
+        void Loop::PushTask(ChunkWaiter * waiter)
+        {
+            PushTask(nullptr, nullptr);
+            Tasks[TasksCount - 1].Waiter = waiter;
+        }
+
+        void Loop::PushWaiters(long long Tick, int ExecutionChunk)
+        {
+            for (ChunkWaiter * waiter = ToResume.PopAll(), * next; waiter != nullptr; waiter = next)
+            {
+                next = ToResume.GetNext(waiter);
+                waiter->ChunkNext = ChunkWaiters;
+                ChunkWaiters = waiter;
+            }
+            for (ChunkWaiter ** link = &ChunkWaiters; *link != nullptr;)
+            {
+                ChunkWaiter * waiter = *link;
+                if (waiter->TargetTick < Tick || (waiter->TargetTick == Tick && ExecutionChunk >= waiter->ExecutionChunk))
+                {
+                    *link = waiter->ChunkNext;
+                    PushTask(waiter);
+                }
+                else
+                    link = &waiter->ChunkNext;
+            }
+        }
+
+        void Loop::ExecuteTasks(ThreadPool& pool)
+        {
+            if (TasksCount == 0)
+                return;
+            if (IsCalibratingSpin)
+            {
+                // The threads of the pool are idle since the previous batch
+                auto now = std::chrono::steady_clock::now();
+                if (LastBatchEnd != std::chrono::time_point<std::chrono::steady_clock>())
+                {
+                    auto gap = now - LastBatchEnd;
+                    bool is_short = gap <= MaxCalibratedSpinTime;
+                    ShortGapsRatio += ((is_short ? 1.0 : 0.0) - ShortGapsRatio) * SpinCalibrationWeight;
+                    if (is_short)
+                        ShortGapTime += (std::chrono::duration<double>(gap).count() - ShortGapTime) * SpinCalibrationWeight;
+                }
+            }
+            for (int i = 0; i < TasksCount; i++)
+                TaskPointers[i] = &Tasks[i];
+            std::chrono::steady_clock::duration previous_wait_time = BarrierWaitTime;
+            pool.Execute(TaskPointers, TasksCount, TickProfiler != nullptr || TickTracer != nullptr ? &BarrierWaitTime : nullptr);
+            if (TickTracer != nullptr)
+            {
+                // The wait is at the end of the execution
+                auto end = std::chrono::steady_clock::now();
+                TickTracer->Record(Tracer::Barrier, nullptr, TickChunk, end - (BarrierWaitTime - previous_wait_time), end);
+            }
+            if (IsCalibratingSpin)
+                LastBatchEnd = std::chrono::steady_clock::now();
+            for (int i = 0; i < TasksCount; i++)
+                if (Tasks[i].Job != nullptr)
+                    FinishJob(Tasks[i].Job, true);
+            TasksCount = 0;
+        }
+
+        void Loop::ExecuteSchedules(ThreadPool& pool, double Time)
+        {
+            while (ScheduledJob * job = Schedules.Pop(Time))
+            {
+                // A cancelled job is released here if its removal is not applied yet
+                int state = ScheduledJob::Pending;
+                if (!job->State.compare_exchange_strong(state, ScheduledJob::Running, std::memory_order_acq_rel))
+                {
+                    ReleaseJob(job);
+                    continue;
+                }
+                double due_time = job->DueTime.load(std::memory_order_relaxed);
+                if (job->Period > 0)
+                {
+                    // Advanced from the previous due time to not drift
+                    double next_due_time = due_time + job->Period;
+                    if (job->Policy == RecurrencePolicy::Skip && next_due_time <= Time)
+                        next_due_time += (std::floor((Time - next_due_time) / job->Period) + 1) * job->Period;
+                    job->DueTime.store(next_due_time, std::memory_order_relaxed);
+                }
+                switch (job->Type)
+                {
+                    case ExecutionType::FreeAsync:
+                    {
+                        bool is_accepted;
+                        try
+                        {
+                            is_accepted = FreeAsyncExecutor.Execute([this, job]() {
+                                ExecuteScheduledJob(*job);
+                                FinishJob(job, false);
+                            });
+                        }
+                        catch (...)
+                        {
+                            FinishJob(job, true);
+                            throw;
+                        }
+                        if (!is_accepted)
+                        {
+                            // The executor is full, this job and the next due ones wait for the next tick
+                            job->DueTime.store(due_time, std::memory_order_relaxed);
+                            state = ScheduledJob::Running;
+                            if (job->State.compare_exchange_strong(state, ScheduledJob::Pending, std::memory_order_acq_rel))
+                                ArmJob(job, due_time, job->ReadyTime);
+                            else
+                                FinishJob(job, true); // Cancelled meanwhile
+                            return;
+                        }
+                        break;
+                    }
+                    case ExecutionType::BoundedAsync:
+                        PushTask(job);
+                        break;
+                    case ExecutionType::SingleThreaded:
+                        ExecuteTasks(pool);
+                        ExecuteScheduledJob(*job);
+                        FinishJob(job, true);
+                        break;
+                }
+            }
+        }
+
+        void Loop::Wake()
+        {
+            Wakeups.IncreaseAndWakeAll();
+        }
+
+        void Loop::SleepUntil(std::chrono::time_point<std::chrono::steady_clock> Deadline)
+        {
+            // Sleeping may overshoot by tens of microseconds, so the last part is spun
+            while (!ShouldStop)
+            {
+                auto now = std::chrono::steady_clock::now();
+                auto wake_time = Deadline - PacingSpinTime;
+                if (now >= wake_time)
+                    break;
+                if (wake_time - now > PacingSleepSlice)
+                    wake_time = now + PacingSleepSlice;
+#ifdef __linux__
+                // steady_clock is CLOCK_MONOTONIC on Linux, an absolute wake time doesn't drift
+                long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(wake_time.time_since_epoch()).count();
+                timespec wake_timespec;
+                wake_timespec.tv_sec = (time_t)(nanoseconds / 1000000000);
+                wake_timespec.tv_nsec = (long)(nanoseconds % 1000000000);
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_timespec, nullptr);
+#else
+                std::this_thread::sleep_until(wake_time);
+#endif
+            }
+            while (std::chrono::steady_clock::now() < Deadline)
+                std::this_thread::yield();
+        }
+
+        inline void Loop::ExecuteScheduledJob(ScheduledJob& job)
+        {
+            if (job.ReadyTime != std::chrono::time_point<std::chrono::steady_clock>())
+                Statistics->ScheduleLateness.Record(std::chrono::steady_clock::now() - job.ReadyTime);
+            std::chrono::time_point<std::chrono::steady_clock> start;
+            bool is_tracing = isTracingEnabled.load(std::memory_order_acquire);
+            if (is_tracing)
+                start = std::chrono::steady_clock::now();
+            try
+            {
+                job.Task();
+            }
+            catch (std::exception& e)
+            {
+                if (job.ExceptionHandler != nullptr) try
+                {
+                    job.ExceptionHandler(e);
+                }
+                catch (...) {} // ignore
+            }
+            catch (...)
+            {
+                if (job.ExceptionHandler != nullptr) try
+                {
+                    std::runtime_error e("Unknown exception (not derived from std::exception)");
+                    job.ExceptionHandler(e);
+                }
+                catch (...) {} // ignore
+            }
+            if (is_tracing)
+                Trace->Record(Tracer::Schedule, nullptr, 0, start, std::chrono::steady_clock::now());
+        }
+        inline void Loop::ExecuteUpdate(Module * module, Profiler::ModuleRecord * record)
+        {
+            std::chrono::time_point<std::chrono::steady_clock> start;
+            if (record != nullptr)
+                start = std::chrono::steady_clock::now();
+            try
+            {
+                module->OnUpdate();
+            }
+            catch (std::exception& e)
+            {
+                try { module->OnException(e); }
+                catch (...) {} // ignore
+            }
+            catch (...)
+            {
+                try
+                {
+                    std::runtime_error e("Unknown exception (not derived from std::exception)");
+                    module->OnException(e);
                 }
                 catch (...) {} // ignore
             }
+            if (record != nullptr)
+            {
+                auto end = std::chrono::steady_clock::now();
+                if (isStatisticsEnabled.load(std::memory_order_acquire))
+                    record->Updates.Record(end - start);
+                if (isTracingEnabled.load(std::memory_order_acquire))
+                    Trace->Record(Tracer::Update, &record->Name, 0, start, end);
+            }
+        }
+
+        void Loop::ExecuteAsyncUpdate(Module * module, Profiler::ModuleRecord * record)
+        {
+            if (module->isUpdatingAsync.exchange(true, std::memory_order_acquire))
+                return;
+            try
+            {
+                if (FreeAsyncExecutor.Execute([this, module, record]() {
+                    ExecuteUpdate(module, record);
+                    module->isUpdatingAsync.store(false, std::memory_order_release);
+                }))
+                    return;
+            }
+            catch (...)
+            {
+                module->isUpdatingAsync.store(false, std::memory_order_relaxed);
+                throw;
+            }
+            module->isUpdatingAsync.store(false, std::memory_order_relaxed);
+        }
+
+        const std::string * Loop::GetTraceName(Module * module)
+        {
+            if (module->ProfilerRecord == nullptr)
+                module->ProfilerRecord = Statistics->GetModuleRecord(module);
+            return &module->ProfilerRecord->Name;
         }
     }
 }
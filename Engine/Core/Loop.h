@@ -2,8 +2,17 @@
 
 #include "../Engine.dec.h"
 #include "../Utilities/Shared.h"
+#include "../Utilities/Futex.h"
+#include "../Utilities/InlineFunction.h"
 #include "../Utilities/Collections/List.h"
-#include "../Utilities/Collections/PriorityQueue.h"
+#include "../Utilities/Collections/TimerWheel.h"
+#include "../Utilities/Collections/MPSCQueue.h"
+#include "AsyncExecutor.h"
+#include "ThreadPool.h"
+#include "TaskGroup.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "Future.h"
 
 namespace Engine
 {
@@ -12,17 +21,50 @@ namespace Engine
         class Loop final
         {
             friend Module;
+            friend ScheduleHandle;
         public:
+            /// @brief A function to schedule with Loop::ScheduleBatch.
+            struct ScheduleItem
+            {
+                Utilities::InlineFunction<void()> Task;
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler;
+                double Time = 0;
+                ExecutionType Type = ExecutionType::BoundedAsync;
+            };
+
+            /// @brief Is resumed in an ExecutionChunk of a loop update, see ResumeInChunk.
+            class ChunkWaiter : public Utilities::Collections::MPSCQueue<ChunkWaiter>::Node
+            {
+                friend Loop;
+            public:
+                /// @brief Is called by the threads of the loop, together with the BoundedAsync updates of the chunk.
+                virtual void Resume() = 0;
+                /// @brief Is called instead of Resume if the loop is stopped or not running.
+                virtual void Drop() = 0;
+            protected:
+                ~ChunkWaiter() = default;
+            private:
+                /// The loop update that the waiter is resumed in, or before.
+                long long TargetTick;
+                int ExecutionChunk;
+                ChunkWaiter * ChunkNext;
+            };
+
             /// @brief The modules that are going to be running.
             ///
             /// Add the modules to this list.
+            /// Assign replaces the modules at once, they must be sorted by ExecutionChunk.
+            /// While the loop is running, the added and removed modules are started and stopped
+            /// between the loop updates, a few per update. A removed module is running until it's stopped.
             Utilities::Collections::List<Module*> Modules;
 
             Loop();
+            ~Loop();
 
             /// @brief Starts the loop.
             ///
             /// Note that it's not an async start.
+            /// Throws without starting if the thread pool is full or the thread can't be pinned.
             void Run();
             /// @brief Stops the loop.
             void Stop();
@@ -30,6 +72,127 @@ namespace Engine
             /// @brief Checks if the loop is running.
             bool IsRunning();
 
+            /// @brief Adds many modules to Modules at once.
+            ///
+            /// Is the same as adding the modules one by one, except that they are sorted
+            /// by ExecutionChunk once and merged with the list in a single pass.
+            /// Throws std::invalid_argument and adds none of them if any is null or already added.
+            void AddModules(Module * const * Items, int Count);
+
+            /// @brief Sets the pacing of the loop updates.
+            ///
+            /// The loop sleeps for the rest of each tick
+            /// and spins shortly before the next one for precision.
+            /// Can be called while running.
+            ///
+            /// @param TickRate The target number of ticks per second.
+            ///        TickRate = 0 disables pacing, which is the default.
+            /// @param FixedTimestep If true, the time advances exactly 1 / TickRate each tick
+            ///        and the missed ticks are caught up without sleeping (see GetLag).
+            ///        Else, the time is the actual time and the missed ticks are skipped.
+            void SetTickRate(double TickRate, bool FixedTimestep = false);
+            /// @brief Gets the target number of ticks per second, 0 if not paced.
+            double GetTickRate();
+            /// @brief Checks whether the time advances by a fixed timestep.
+            bool IsFixedTimestep();
+            /// @brief Gets how late the current tick is started relative to its target time.
+            ///
+            /// Is 0 if not paced. With a fixed timestep, the lag accumulates
+            /// as long as the ticks take longer than the timestep.
+            double GetLag();
+            /// @brief Gets the time values of the current loop update at once.
+            ///
+            /// The values are always of the same loop update, and all 0 while not running.
+            /// Can be called by any thread without locking.
+            FrameClock GetClock();
+
+            /// @brief Enables or disables collecting the statistics of the loop.
+            ///
+            /// Disabled by default, which has almost no overhead.
+            /// Can be called while running.
+            void SetStatisticsEnabled(bool Value);
+            /// @brief Checks whether the statistics are being collected.
+            bool IsStatisticsEnabled();
+            /// @brief Gets a snapshot of the statistics collected so far.
+            ///
+            /// Can be called while running, the loop is not blocked meanwhile.
+            LoopStatistics GetStatistics();
+            /// @brief Clears the collected statistics.
+            void ResetStatistics();
+
+            /// @brief Enables or disables recording the trace events of the loop.
+            ///
+            /// The module updates, schedules, chunks, barrier waits and module additions and removals
+            /// are recorded with their threads and times. Only the latest events of each thread are kept.
+            /// Disabled by default, which has almost no overhead.
+            /// Can be called while running.
+            void SetTracingEnabled(bool Value);
+            /// @brief Checks whether the trace events are being recorded.
+            bool IsTracingEnabled();
+            /// @brief Writes the recorded trace events to a file and clears them.
+            ///
+            /// The file is in Chrome Trace Event JSON format, viewable by chrome://tracing or Perfetto.
+            /// Can be called while running.
+            void WriteTrace(const std::string& FilePath);
+
+            /// @brief Sets the pool that executes the BoundedAsync updates and schedules.
+            ///
+            /// The pool can be shared by several loops and must be kept until the loop is stopped.
+            /// Throws std::logic_error if the loop is running.
+            ///
+            /// @param Pool The pool, null results in using a pool of the loop,
+            ///        which is created by the first run and kept until the loop is destroyed.
+            void SetThreadPool(ThreadPool * Pool);
+            /// @brief Gets the pool that is set by SetThreadPool, null if none.
+            ThreadPool * GetThreadPool();
+            /// @brief Pins the thread that runs the loop to a set of CPUs when the next runs start.
+            ///
+            /// The thread stays pinned after the run. See ThreadPool::SetThreadAffinity.
+            /// Count = 0 results in not pinning it by the next runs.
+            void SetThreadAffinity(const int * Cpus, int Count);
+            /// @brief Pins the threads of the pool of the loop to CPUs when the next runs start.
+            ///
+            /// Is not applied to a pool that is set by SetThreadPool, use ThreadPool::SetAffinity instead.
+            /// Count = 0 results in not pinning them by the next runs.
+            void SetWorkersAffinity(const int * Cpus, int Count);
+            /// @brief Enables or disables executing each BoundedAsync update by the same thread every tick.
+            ///
+            /// Keeps the data of the modules in the caches of the threads, and in the NUMA nodes
+            /// of the threads that allocate it if the threads are pinned.
+            /// The idle threads still take the updates that wait for a thread while it's busy with another one.
+            /// Is not applied to the modules with dependencies, as they are executed by their order.
+            /// Disabled by default.
+            /// Can be called while running.
+            void SetStablePlacementEnabled(bool Value);
+            /// @brief Checks whether the BoundedAsync updates are executed by the same threads every tick.
+            bool IsStablePlacementEnabled();
+            /// @brief Sets how long the threads of the pool spin, then yield, before sleeping when they run out of work.
+            ///
+            /// Spinning lowers the latency of starting the next chunk at the cost of CPU time.
+            /// Is applied to a pool that is set by SetThreadPool too, see ThreadPool::SetSpinTime.
+            /// Can be called while running.
+            ///
+            /// @param Seconds The spin time, Seconds < 0 results in calibrating it every tick
+            ///        from the gaps between the executions of the chunks, which is the default.
+            ///        The pools that are set by SetThreadPool are not calibrated.
+            void SetSpinTime(double Seconds);
+            /// @brief Gets the spin time that is set by SetSpinTime, negative if it's calibrated.
+            double GetSpinTime();
+
+            /// @brief Calls a function for the subranges of a range in parallel and waits for them.
+            ///
+            /// Inside the updates and schedules of the running loop (except the FreeAsync ones),
+            /// the subranges are processed by the threads of the loop and the calling thread helps meanwhile.
+            /// Elsewhere, they are processed by the calling thread. See also TaskGroup.
+            /// Rethrows the first exception thrown by Body.
+            /// Throws std::invalid_argument if the range has more than INT_MAX subranges.
+            ///
+            /// @param Start The first index of the range.
+            /// @param End The index after the last one.
+            /// @param Grain The size of the subranges, except the last one which may be smaller.
+            /// @param Body The function that processes the subrange [Start, End).
+            void ParallelFor(int Start, int End, int Grain, std::function<void(int Start, int End)> Body);
+
             /// @brief Schedules to call a function.
             ///
             /// Will not call if the Loop is stopped before the call.
@@ -39,9 +202,10 @@ namespace Engine
             /// @param ExceptionHandler The function that will be called to handle exceptions thrown by Task.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
-                std::function<void()> Task,
-                std::function<void(std::exception&)> ExceptionHandler = nullptr,
+            /// @return The handle to cancel or reschedule the call, refers to no schedule if not running.
+            ScheduleHandle Schedule(
+                Utilities::InlineFunction<void()> Task,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler = nullptr,
                 double Time = 0,
                 ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
@@ -54,10 +218,11 @@ namespace Engine
             /// @param ExceptionHandler The function that will be called to handle exceptions thrown by Task.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
+            /// @return The handle to cancel or reschedule the call, refers to no schedule if not running.
+            ScheduleHandle Schedule(
                 double Time,
-                std::function<void()> Task,
-                std::function<void(std::exception&)> ExceptionHandler = nullptr,
+                Utilities::InlineFunction<void()> Task,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler = nullptr,
                 ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
             /// @brief Schedules to call a function.
@@ -69,44 +234,503 @@ namespace Engine
             /// @param ExceptionHandler The function that will be called to handle exceptions thrown by Task.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
+            /// @return The handle to cancel or reschedule the call, refers to no schedule if not running.
+            ScheduleHandle Schedule(
                 double Time,
                 ExecutionType ExecutionType,
-                std::function<void()> Task,
-                std::function<void(std::exception&)> ExceptionHandler = nullptr
+                Utilities::InlineFunction<void()> Task,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler = nullptr
+            );
+            /// @brief Schedules to call many functions at once.
+            ///
+            /// Is the same as scheduling the items one by one,
+            /// except that they are submitted to the loop together.
+            ///
+            /// @param Items The functions, their times and their execution types.
+            ///        The functions are moved out of the items.
+            /// @param Count The number of the items.
+            /// @param Handles Is filled with a handle for each item if not null,
+            ///        the handles refer to no schedule if not running.
+            void ScheduleBatch(ScheduleItem * Items, int Count, ScheduleHandle * Handles = nullptr);
+            /// @brief Schedules to call a function and gets the future of its result.
+            ///
+            /// Is executed right before Chunk-0 Modules, like Schedule.
+            /// The result is the value returned by Task or the exception thrown by it.
+            /// If the Loop is stopped before the call, the result is an exception.
+            /// Use Future::Then to continue with the result on the Loop.
+            ///
+            /// @param Task The function that will be called.
+            template <typename FunctionType>
+            Future<typename std::invoke_result<FunctionType&>::type> Submit(
+                FunctionType Task,
+                ExecutionType ExecutionType = ExecutionType::BoundedAsync
+            );
+            /// @brief Resumes a waiter with the BoundedAsync updates of an ExecutionChunk.
+            ///
+            /// Is resumed in the current loop update if the chunk is not started yet, else in the next one.
+            /// Is resumed at the end of the loop update if there are no modules in the chunk or after it.
+            /// If any of the modules have dependencies, the chunks are not separated
+            /// and the waiter is resumed with the schedules of the next loop update instead.
+            /// Can be called by any thread.
+            ///
+            /// @param Waiter Must be kept until it's resumed or dropped.
+            /// @param ExecutionChunk The chunk, std::numeric_limits<int>::min() for the start of the next loop update.
+            void ResumeInChunk(ChunkWaiter * Waiter, int ExecutionChunk);
+#ifdef ENGINE_COROUTINES
+            /// @brief Starts a coroutine on the calling thread and keeps it until it's done.
+            ///
+            /// The coroutine is resumed by the threads of the loop after each suspension.
+            /// Is destroyed without being started if the loop is not running,
+            /// or when it can't be resumed because the loop is stopped.
+            ///
+            /// @param ExceptionHandler The function that will be called to handle exceptions thrown by the coroutine.
+            void Spawn(Coroutine<void> Coroutine, Utilities::InlineFunction<void(std::exception&)> ExceptionHandler = nullptr);
+            /// @brief Gets an awaitable that resumes the coroutine after some seconds, as a BoundedAsync schedule.
+            DelayAwaiter Delay(double Seconds);
+            /// @brief Gets an awaitable that resumes the coroutine at the start of the next loop update.
+            ChunkAwaiter NextTick();
+            /// @brief Gets an awaitable that resumes the coroutine in an ExecutionChunk, see ResumeInChunk.
+            ChunkAwaiter NextChunk(int ExecutionChunk);
+#endif
+            /// @brief Schedules to call a function repeatedly.
+            ///
+            /// The calls are at multiples of Period from now, regardless of how late each call is,
+            /// and a call is not started before the previous one is done.
+            /// The schedule is kept and repeated until it's cancelled or the Loop is stopped.
+            /// Is executed right before Chunk-0 Modules.
+            ///
+            /// @param Period The time between the calls, must be positive.
+            /// @param Task The function that will be called.
+            /// @param ExceptionHandler The function that will be called to handle exceptions thrown by Task.
+            /// @param Policy What to do when the calls fall behind by a period or more.
+            /// @return The handle to cancel or reschedule the calls, refers to no schedule if not running.
+            ScheduleHandle ScheduleEvery(
+                double Period,
+                Utilities::InlineFunction<void()> Task,
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler = nullptr,
+                RecurrencePolicy Policy = RecurrencePolicy::Skip,
+                ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
         private:
             int Chunk0ModulesStartIndex;
             int Chunk0ModulesEndIndex;
 
+            /// @brief A set of modules as an open addressing hash table.
+            struct ModulesSet final
+            {
+                Module ** Slots;
+                int Capacity;
+                int Count;
+                ModulesSet();
+                ~ModulesSet();
+                bool Contains(Module*);
+                void Add(Module*);
+                void Remove(Module*);
+                void Clear();
+                /// @brief Gets the slot that a module is hashed to.
+                int GetHome(Module*);
+                /// @brief Gets the slot of a module, or the empty slot where it would be added.
+                int GetSlot(Module*);
+            };
+            /// The modules of Modules, to check the membership without scanning the list.
+            /// Guarded by the lock of Modules.
+            ModulesSet ListedModules;
+
             Utilities::Shared<bool, true> isRunning;
+            /// Guarded by isRunning.Mutex.
+            ThreadPool * SharedThreadPool;
+            /// Is created by the first run that doesn't have a SharedThreadPool.
+            std::unique_ptr<ThreadPool> OwnThreadPool;
+            /// The CPUs of the loop thread and the threads of OwnThreadPool, guarded by isRunning.Mutex.
+            int * ThreadCpus;
+            int ThreadCpusCount;
+            int * WorkersCpus;
+            int WorkersCpusCount;
+            std::atomic<bool> isStablePlacementEnabled;
+            std::atomic<double> SpinTime;
+            /// Lock-free mirror of isRunning for the schedule submissions.
+            /// Bit 0 is set while running, the rest counts the submitting threads.
+            std::atomic<unsigned int> SubmitState;
+            /// Is increased by each run, before the schedules are accepted.
+            std::atomic<std::uint64_t> RunNumber;
             Utilities::Shared<std::chrono::time_point<std::chrono::steady_clock>> StartTime;
-            Utilities::Shared<double> Time;
-            Utilities::Shared<double> TimeDiff;
-            Utilities::Shared<float> TimeAsFloat;
-            Utilities::Shared<float> TimeDiffAsFloat;
+            /// The FrameClock of the current loop update, published by a seqlock.
+            /// Is odd while the thread that runs the loop writes the values,
+            /// which are atomics to be read meanwhile and then discarded.
+            std::atomic<unsigned int> ClockSequence;
+            std::atomic<long long> ClockTick;
+            std::atomic<double> ClockTime;
+            std::atomic<double> ClockTimeDiff;
+            std::atomic<float> ClockTimeAsFloat;
+            std::atomic<float> ClockTimeDiffAsFloat;
+            std::atomic<double> ClockLag;
             Utilities::Shared<bool> ShouldStop;
+            Utilities::Shared<double> TickRate;
+            Utilities::Shared<bool> FixedTimestep;
+            /// Is increased on the events that end idling: schedules, module edits, enabling a module and Stop.
+            Utilities::Futex Wakeups;
+
+            /// The time spent spinning instead of sleeping before a paced tick.
+            static constexpr std::chrono::microseconds PacingSpinTime = std::chrono::microseconds(200);
+            /// The longest sleep between the checks of ShouldStop.
+            static constexpr std::chrono::milliseconds PacingSleepSlice = std::chrono::milliseconds(50);
+            /// The longest calibrated spin time, the longer gaps between the chunks are slept.
+            static constexpr std::chrono::microseconds MaxCalibratedSpinTime = std::chrono::microseconds(100);
+            /// The weight of each gap between the chunks in the calibration.
+            static constexpr double SpinCalibrationWeight = 0.05;
+
+            /// Whether the gaps between the chunks are measured in this run.
+            bool IsCalibratingSpin;
+            std::chrono::time_point<std::chrono::steady_clock> LastBatchEnd;
+            /// The moving averages of the ratio of the gaps that are shorter than MaxCalibratedSpinTime,
+            /// and of their length in seconds.
+            double ShortGapsRatio;
+            double ShortGapTime;
 
-            struct ScheduledJob
+            class JobPool;
+            struct ScheduledJob final : public Utilities::Collections::TimerWheel<ScheduledJob>::Node,
+                                        public Utilities::Collections::MPSCQueue<ScheduledJob>::Node
             {
-                std::function<void()> Task;
-                std::function<void(std::exception&)> ExceptionHandler;
-                ScheduledJob() {}
-                ScheduledJob(
-                    std::function<void()> Task,
-                    std::function<void(std::exception&)> ExceptionHandler
+                enum StateType : int { Pending, Running, Done, Cancelled };
+
+                /// Are released when the job is done or cancelled.
+                Utilities::InlineFunction<void()> Task;
+                Utilities::InlineFunction<void(std::exception&)> ExceptionHandler;
+                ExecutionType Type;
+                /// Is changed by the handles, read by the loop when the job is in ToSchedule.
+                /// Is advanced by the loop when a recurring job is started.
+                std::atomic<double> DueTime;
+                /// 0 for the jobs that are executed once.
+                double Period;
+                RecurrencePolicy Policy;
+                /// When the job is due or submitted, whichever is later.
+                /// Is only set while collecting statistics.
+                std::chrono::time_point<std::chrono::steady_clock> ReadyTime;
+                /// Only the thread that changes it from Pending may touch the functions.
+                /// A recurring job goes back from Running to Pending, unless it's cancelled meanwhile.
+                std::atomic<int> State;
+                /// Whether the job is in ToSchedule, to apply the changes of the handles only once.
+                std::atomic<bool> IsQueued;
+                /// Are held by the handles, by ToSchedule and by Schedules until the job is done.
+                std::atomic<int> References;
+                /// The pool that the job is recycled to once it's released.
+                JobPool * Pool;
+                /// The run of the loop that the job is created in, the jobs of the previous runs are dropped.
+                std::uint64_t RunNumber;
+            };
+
+            /// @brief Recycles the released jobs, so that a warmed-up loop schedules without allocating.
+            ///
+            /// Is shared by the loop and the jobs that it has created,
+            /// as the last handle of a job may be released after the loop is destroyed.
+            /// Keeps as many jobs as the most that have been alive at once.
+            class JobPool final
+            {
+            public:
+                /// @brief Starts with the reference of the loop.
+                JobPool();
+                ~JobPool();
+
+                JobPool(const JobPool&) = delete;
+                JobPool& operator=(const JobPool&) = delete;
+
+                /// @brief Takes a released job or creates one, which holds a reference to the pool.
+                ///
+                /// The job starts with the reference of ToSchedule.
+                /// Can be called by any thread.
+                ScheduledJob * Create(
+                    std::uint64_t RunNumber,
+                    Utilities::InlineFunction<void()> Task,
+                    Utilities::InlineFunction<void(std::exception&)> ExceptionHandler,
+                    ExecutionType Type,
+                    double DueTime,
+                    double Period = 0,
+                    RecurrencePolicy Policy = RecurrencePolicy::Skip
                 );
+                /// @brief Keeps a released job for Create, and releases its reference to the pool.
+                ///
+                /// Can be called by any thread.
+                void Recycle(ScheduledJob*);
+                /// @brief Releases a reference, deleting the pool and the kept jobs with the last one.
+                void Release();
+            private:
+                /// Are held by the loop and by the jobs that are not recycled.
+                std::atomic<int> References;
+                /// The jobs that are recycled by any thread.
+                Utilities::Collections::MPSCQueue<ScheduledJob> Recycled;
+                /// Guards the draining of Recycled and FreeJobs.
+                std::mutex Mutex;
+                /// The jobs drained from Recycled, linked by the queue.
+                ScheduledJob * FreeJobs;
             };
 
-            Utilities::Collections::PriorityQueue<std::pair<ExecutionType, ScheduledJob>, double> Schedules;
+            /// Only used by the thread that runs the loop.
+            Utilities::Collections::TimerWheel<ScheduledJob> Schedules;
+            /// Creates the jobs of the loop, see JobPool.
+            JobPool * Jobs;
 
             enum ModulesEditType : std::int_fast8_t { Add, Replace, Remove, Clear };
-            Utilities::Collections::Queue<std::tuple<ModulesEditType, int, Module*>> ToEditModules;
-            Utilities::Collections::List<Module*> UpdatingModules;
-            Utilities::Collections::Queue<std::tuple<ExecutionType, ScheduledJob, double>> ToSchedule;
+            /// @brief A copy of Modules, sorted by ExecutionChunk.
+            struct ModulesSnapshot final
+            {
+                Module ** Items;
+                int Count;
+                int Capacity;
+                ModulesSnapshot();
+                ~ModulesSnapshot();
+                /// @brief Copies the modules of a list.
+                void Assign(Utilities::Collections::List<Module*>&);
+                /// @brief Applies an edit of Modules to the copy.
+                void Edit(ModulesEditType Type, int Index, Module * Item);
+                /// @brief Grows the capacity, keeping the modules.
+                void Reserve(int Count);
+            };
+            /// @brief The edits of Modules in their order, published to the loop as a batch.
+            struct ModulesEdits final
+            {
+                struct Edit
+                {
+                    ModulesEditType Type;
+                    int Index;
+                    Module * Item;
+                };
+                Edit * Items;
+                int Count;
+                int Capacity;
+                ModulesEdits();
+                ~ModulesEdits();
+                void Push(ModulesEditType Type, int Index, Module * Item);
+            };
+            /// The copy of Modules that is updated, kept in sync by applying NextEdits between the loop updates.
+            /// Only used by the thread that runs the loop.
+            ModulesSnapshot * UpdatingModules;
+            /// The edits of Modules that are not applied yet, pushed by the thread that edits Modules.
+            /// Is owned by the thread that exchanges it out.
+            std::atomic<ModulesEdits*> NextEdits;
+            /// An applied batch of edits that is reused by the next publication, to not allocate on each edit.
+            std::atomic<ModulesEdits*> FreeEdits;
+            /// The modules that are added or removed by the applied edits and are not started or stopped yet, in their order.
+            /// Only used by the thread that runs the loop.
+            Module ** ModuleChanges;
+            int ModuleChangesCapacity;
+            int ModuleChangesCount;
+            /// The most modules that are started or stopped in one loop update, the rest are left to the next updates.
+            static constexpr int MaxModuleChangesPerTick = 4;
+            /// The new jobs and the jobs that are changed by their handles.
+            /// Drained by the thread that runs the loop.
+            Utilities::Collections::MPSCQueue<ScheduledJob> ToSchedule;
+            /// The new chunk waiters, drained at the start of each chunk.
+            Utilities::Collections::MPSCQueue<ChunkWaiter> ToResume;
+            /// The chunk waiters that are drained, not in order.
+            /// Only used by the thread that runs the loop.
+            ChunkWaiter * ChunkWaiters;
+            /// The number of the started loop updates, for the chunk waiters.
+            std::atomic<long long> Ticks;
+            /// The ExecutionChunk that is started in the current loop update,
+            /// the lowest int before the chunks and the highest int after them.
+            std::atomic<int> WaitersChunk;
+
+            /// @brief A BoundedAsync module update or scheduled job to run on the pool.
+            class UpdateTask final : public ThreadPool::Task
+            {
+            public:
+                Loop * Owner;
+                Module * Target;
+                Profiler::ModuleRecord * Record;
+                ScheduledJob * Job;
+                ChunkWaiter * Waiter;
+                UpdateTask();
+                void Execute() override;
+            };
+
+            /// @brief Consecutive subranges of ParallelFor.
+            class RangeTask final : public ThreadPool::Task
+            {
+            public:
+                std::function<void(int, int)> * Body;
+                int Start;
+                int End;
+                int Grain;
+                std::mutex * ExceptionMutex;
+                /// The first exception thrown by the subranges, guarded by ExceptionMutex.
+                std::exception_ptr * Exception;
+                void Execute() override;
+            };
 
+            /// The BoundedAsync updates that are collected to be executed together.
+            /// Only used by the thread that runs the loop.
+            UpdateTask * Tasks;
+            ThreadPool::Task ** TaskPointers;
+            int TasksCapacity;
+            int TasksCount;
+
+            /// The enabled modules of UpdatingModules in the same order, as plain arrays.
+            /// Is rebuilt on the next tick when marked dirty.
+            /// Only used by the thread that runs the loop.
+            Module ** DispatchModules;
+            /// Null while not collecting statistics or tracing.
+            Profiler::ModuleRecord ** DispatchRecords;
+            int * DispatchChunks;
+            ExecutionType * DispatchTypes;
+            int DispatchCapacity;
+            int DispatchCount;
+            /// Is set on the module edits and on enabling or disabling a module.
+            std::atomic<bool> IsDispatchTableDirty;
+
+            /// @brief A module update, or a join of the modules of the lower chunks, in the dependency graph.
+            class GraphNode final : public ThreadPool::Task
+            {
+            public:
+                Loop * Owner;
+                /// Null for the joins.
+                Module * Target;
+                Profiler::ModuleRecord * Record;
+                ExecutionType Type;
+                int ExecutionChunk;
+                /// The predecessors in the segment being executed that are not done yet.
+                std::atomic<int> PredecessorsLeft;
+                GraphNode();
+                void Execute() override;
+            };
+
+            /// The dependency graph of the dispatch table, which replaces the chunk barriers
+            /// if any of the dispatched modules has dependencies, else empty.
+            /// The nodes are in a topological order and each edge goes forward.
+            /// The SingleThreaded modules and the due schedules split it into segments
+            /// that are executed one after another.
+            /// Only used by the thread that runs the loop, and by the nodes during their segment.
+            GraphNode * GraphNodes;
+            int GraphNodesCapacity;
+            int GraphNodesCount;
+            /// The successors of node i are GraphSuccessors[GraphSuccessorsStart[i] .. GraphSuccessorsStart[i + 1]).
+            int * GraphSuccessorsStart;
+            int * GraphSuccessors;
+            int GraphSuccessorsCapacity;
+            /// The first node with ExecutionChunk >= 0, the due schedules are executed before it.
+            int GraphSchedulesIndex;
+            /// The nodes of the segment being executed that have no predecessors in it.
+            ThreadPool::Task ** GraphRoots;
+            /// The end of the segment being executed.
+            int GraphSegmentEnd;
+            ThreadPool * GraphPool;
+
+            /// Is created when the statistics or tracing are enabled for the first time,
+            /// it also keeps the module records for tracing.
+            /// Guarded by StatisticsMutex until then.
+            std::unique_ptr<Profiler> Statistics;
+            std::mutex StatisticsMutex;
+            std::atomic<bool> isStatisticsEnabled;
+            /// The profiler of the current tick, null while not collecting statistics.
+            /// Only used by the thread that runs the loop.
+            Profiler * TickProfiler;
+            /// The time that the loop thread waited at the barriers of the current chunk.
+            std::chrono::steady_clock::duration BarrierWaitTime;
+            /// Is created when tracing is enabled for the first time.
+            /// Guarded by StatisticsMutex until then.
+            std::unique_ptr<Tracer> Trace;
+            std::atomic<bool> isTracingEnabled;
+            /// The tracer of the current tick, null while not tracing.
+            /// Only used by the thread that runs the loop.
+            Tracer * TickTracer;
+            /// The ExecutionChunk that is being executed, for the trace events of the barriers.
+            int TickChunk;
+
+            /// Executes the FreeAsync updates and schedules, kept between runs.
+            /// Once it's full, the due FreeAsync schedules wait for the next tick.
+            /// Declared last to wait for its tasks before the other members are destroyed.
+            AsyncExecutor FreeAsyncExecutor;
+
+            /// @brief Publishes the content of Modules to NextEdits and wakes the loop, while Modules is locked.
+            void PublishModules(Utilities::Collections::List<Module*>& Source);
+            /// @brief Publishes an edit of Modules to NextEdits and wakes the loop, while Modules is locked.
+            ///
+            /// The edit is pushed to the batch that is not taken by the loop yet, else to a recycled one.
+            void PublishModules(ModulesEditType Type, int Index, Module * Item);
+            /// @brief Applies a batch of edits to UpdatingModules and queues the added and removed modules to ModuleChanges.
+            void ApplyModules(ModulesEdits*);
+            /// @brief Queues a module whose listing is changed to be started or stopped.
+            void ChangeModule(Module*, bool IsListed);
+            /// @brief Stops and then starts up to MaxModuleChangesPerTick modules of ModuleChanges.
+            ///
+            /// The modules that are removed and added back before their turn are not restarted.
+            void StartStopModules();
+            /// @brief Fills the dispatch table from UpdatingModules.
+            void BuildDispatchTable();
+            /// @brief Fills the dependency graph from the dispatch table.
+            void BuildDependencyGraph();
+            /// @brief Executes the nodes [Start, End) of the dependency graph on the pool and waits for them.
+            ///
+            /// The nodes must not be SingleThreaded.
+            void ExecuteGraph(ThreadPool&, int Start, int End);
+            void PushTask(Module*, Profiler::ModuleRecord*);
+            void PushTask(ScheduledJob*);
+            void PushTask(ChunkWaiter*);
+            /// @brief Collects the chunk waiters that are due in a chunk of a tick as tasks.
+            void PushWaiters(long long Tick, int ExecutionChunk);
+            /// @brief Executes the collected tasks on the pool and waits for them.
+            void ExecuteTasks(ThreadPool&);
+            /// @brief Runs the due schedules, the BoundedAsync ones are collected as tasks.
+            void ExecuteSchedules(ThreadPool&, double Time);
+
+            /// @brief Pushes a job to ToSchedule if the loop is running, else drops it.
+            ///
+            /// The caller passes the reference of ToSchedule.
+            void SubmitJob(ScheduledJob*);
+            /// @brief Pushes jobs to ToSchedule at once if the loop is running, else drops them.
+            void SubmitJob(ScheduledJob**, int Count);
+            /// @brief Submits a job again to apply the changes of its handles, unless it's already in ToSchedule.
+            void Requeue(ScheduledJob*);
+            /// @brief Applies the changes of a job that is drained from ToSchedule.
+            void UpdateSchedule(ScheduledJob*, std::chrono::time_point<std::chrono::steady_clock> TickStart);
+            /// @brief Releases the functions of a job that is not going to be executed, if it's pending.
+            static void CancelJob(ScheduledJob*);
+            /// @brief Pushes a pending job to Schedules, on the thread that runs the loop.
+            void ArmJob(ScheduledJob*, double DueTime, std::chrono::time_point<std::chrono::steady_clock> TickStart);
+            /// @brief Arms an executed recurring job again, else marks it as done and releases its functions and its reference.
+            ///
+            /// The recurring jobs that are finished by the other threads are armed through ToSchedule.
+            void FinishJob(ScheduledJob*, bool IsLoopThread);
+            static void ReleaseJob(ScheduledJob*);
+            /// @brief Drops the jobs in ToSchedule and Schedules.
+            void ClearSchedules();
+            /// @brief Replaces the FrameClock, on the thread that runs the loop.
+            void PublishClock(const FrameClock&);
+            /// @brief Wakes the loop if it's idle.
+            void Wake();
+            /// @brief Sleeps and then spins until the deadline or until ShouldStop is set.
+            void SleepUntil(std::chrono::time_point<std::chrono::steady_clock> Deadline);
             void ExecuteScheduledJob(ScheduledJob&);
-            void ExecuteUpdate(Module*);
+            void ExecuteUpdate(Module*, Profiler::ModuleRecord*);
+            /// @brief Submits the update of a FreeAsync module to FreeAsyncExecutor.
+            ///
+            /// Is skipped while the previous update of the module is still running,
+            /// or while FreeAsyncExecutor has no room for it.
+            void ExecuteAsyncUpdate(Module*, Profiler::ModuleRecord*);
+            /// @brief Gets the name of a module that is kept alive for its trace events.
+            const std::string * GetTraceName(Module*);
         };
     }
 }
+
+// DEFINITION ----------------------------------------------------------------
+
+namespace Engine
+{
+    namespace Core
+    {
+        template <typename FunctionType>
+        Future<typename std::invoke_result<FunctionType&>::type> Loop::Submit(
+                FunctionType Task,
+                ExecutionType ExecutionType
+        ) {
+            typedef typename std::invoke_result<FunctionType&>::type ResultType;
+            Promise<ResultType> promise(this);
+            Future<ResultType> future = promise.GetFuture();
+            // The promise is dropped with an exception if the task is not called
+            Schedule(0, ExecutionType, [promise = std::move(promise), task = std::move(Task)]() mutable {
+                promise.SetResultOf(task);
+            });
+            return future;
+        }
+    }
+}
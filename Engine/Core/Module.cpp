@@ -7,38 +7,47 @@ namespace Engine
         Module::Module(std::int_fast8_t ExecutionChunk) : ExecutionChunk(ExecutionChunk >= -128 ?
                                                             (ExecutionChunk <= 127 ? ExecutionChunk : 127)
                                                             : -128),
-                                                        isEnabled(true), loop(nullptr) {}
+                                                        isEnabled(true), loop(nullptr), ProfilerRecord(nullptr), IsStarted(false), IsListed(false), IsChangePending(false),
+                                                        isUpdatingAsync(false) {}
 
         Module::~Module() {}
 
         void Module::Enable()
         {
-            if (!isEnabled)
+            if (!isEnabled.exchange(true, std::memory_order_acq_rel))
             {
-                isEnabled = true;
-                if (loop != nullptr && loop.Get()->isRunning)
+                Loop * owner = GetLoop();
+                if (owner != nullptr && owner->IsRunning())
+                {
                     OnEnable();
+                    owner->IsDispatchTableDirty.store(true, std::memory_order_release);
+                    owner->Wake();
+                }
             }
         }
 
         void Module::Disable()
         {
-            if (isEnabled)
+            // Claims the change like Enable, so concurrent calls disable it once
+            if (isEnabled.exchange(false, std::memory_order_acq_rel))
             {
-                if (loop != nullptr && loop.Get()->isRunning)
+                Loop * owner = GetLoop();
+                if (owner != nullptr && owner->IsRunning())
                     OnDisable();
-                isEnabled = false;
+                if (owner != nullptr)
+                    owner->IsDispatchTableDirty.store(true, std::memory_order_release);
             }
         }
 
         bool Module::IsEnabled()
         {
-            return isEnabled;
+            return isEnabled.load(std::memory_order_acquire);
         }
 
         bool Module::IsRunning()
         {
-            return loop != nullptr && isEnabled && loop.Get()->isRunning;
+            Loop * owner = GetLoop();
+            return owner != nullptr && IsEnabled() && owner->IsRunning();
         }
 
         int Module::GetExecutionChunk()
@@ -55,87 +64,184 @@ namespace Engine
 
         double Module::GetTime()
         {
-            if (loop == nullptr)
-                return 0;
-            return loop.Get()->Time;
+            return GetClock().Time;
         }
 
         double Module::GetTimeDiff()
         {
-            if (loop == nullptr)
-                return 0;
-            return loop.Get()->TimeDiff;
+            return GetClock().TimeDiff;
         }
 
         float Module::GetTimeAsFloat()
         {
-            if (loop == nullptr)
-                return 0;
-            return loop.Get()->TimeAsFloat;
+            return GetClock().TimeAsFloat;
         }
 
         float Module::GetTimeDiffAsFloat()
         {
-            if (loop == nullptr)
-                return 0;
-            return loop.Get()->TimeDiffAsFloat;
+            return GetClock().TimeDiffAsFloat;
+        }
+
+        double Module::GetLag()
+        {
+            return GetClock().Lag;
+        }
+
+        long long Module::GetTick()
+        {
+            return GetClock().Tick;
+        }
+
+        FrameClock Module::GetClock()
+        {
+            Loop * owner = GetLoop();
+            if (owner == nullptr)
+                return FrameClock();
+            return owner->GetClock();
         }
 
         double Module::GetActualTime()
         {
-            if (loop == nullptr)
+            Loop * owner = GetLoop();
+            if (owner == nullptr)
                 return 0;
-            if (!loop.Get()->isRunning)
+            if (!owner->IsRunning())
                 return 0;
-            auto duration = std::chrono::steady_clock::now() - loop.Get()->StartTime.Get();
+            auto duration = std::chrono::steady_clock::now() - owner->StartTime.Get();
             return (double)std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
         }
 
         Loop * Module::GetLoop()
         {
-            return loop;
+            return loop.load(std::memory_order_acquire);
         }
 
-        void Module::Schedule(
-                std::function<void()> Task,
+        ScheduleHandle Module::Schedule(
+                Utilities::InlineFunction<void()> Task,
                 double Time,
                 ExecutionType ExecutionType
         ) {
             if (GetLoop() == nullptr)
                 throw std::runtime_error("No loop to schedule in.");
-            GetLoop()->Schedule(Time, ExecutionType, Task, [&](std::exception& e) { OnException(e); });
+            return GetLoop()->Schedule(Time, ExecutionType, std::move(Task), [this](std::exception& e) { OnException(e); });
         }
 
-        void Module::Schedule(
+        ScheduleHandle Module::Schedule(
                 double Time,
-                std::function<void()> Task,
+                Utilities::InlineFunction<void()> Task,
                 ExecutionType ExecutionType
         ) {
             if (GetLoop() == nullptr)
                 throw std::runtime_error("No loop to schedule in.");
-            GetLoop()->Schedule(Time, ExecutionType, Task, [&](std::exception& e) { OnException(e); });
+            return GetLoop()->Schedule(Time, ExecutionType, std::move(Task), [this](std::exception& e) { OnException(e); });
         }
 
-        void Module::Schedule(
+        ScheduleHandle Module::Schedule(
                 double Time,
                 ExecutionType ExecutionType,
-                std::function<void()> Task
+                Utilities::InlineFunction<void()> Task
         ) {
             if (GetLoop() == nullptr)
                 throw std::runtime_error("No loop to schedule in.");
-            GetLoop()->Schedule(Time, ExecutionType, Task, [&](std::exception& e) { OnException(e); });
+            return GetLoop()->Schedule(Time, ExecutionType, std::move(Task), [this](std::exception& e) { OnException(e); });
+        }
+
+        ScheduleHandle Module::ScheduleEvery(
+                double Period,
+                Utilities::InlineFunction<void()> Task,
+                RecurrencePolicy Policy,
+                ExecutionType ExecutionType
+        ) {
+            if (GetLoop() == nullptr)
+                throw std::runtime_error("No loop to schedule in.");
+            return GetLoop()->ScheduleEvery(Period, std::move(Task), [this](std::exception& e) { OnException(e); }, Policy, ExecutionType);
+        }
+
+#ifdef ENGINE_COROUTINES
+        void Module::Spawn(Coroutine<void> Task)
+        {
+            if (GetLoop() == nullptr)
+                throw std::runtime_error("No loop to spawn in.");
+            GetLoop()->Spawn(std::move(Task), [this](std::exception& e) { OnException(e); });
+        }
+#endif
+
+        void Module::AddDependency(Module * Other)
+        {
+            if (Other == nullptr)
+                throw std::invalid_argument("Other cannot be null.");
+            if (GetLoop() != nullptr)
+                throw std::logic_error("Cannot change the dependencies while the loop is running.");
+            if (Other->GetExecutionChunk() > GetExecutionChunk())
+                throw std::invalid_argument("Cannot depend on a module with a greater ExecutionChunk.");
+            if (Other == this || Other->DependsOn(this))
+                throw std::invalid_argument("Circular dependency.");
+            DeclarationLists& declarations = GetDeclarations();
+            if (!declarations.Dependencies.Contains(Other))
+                declarations.Dependencies.Add(Other);
+        }
+
+        void Module::AddReadResource(const std::string& Resource)
+        {
+            if (GetLoop() != nullptr)
+                throw std::logic_error("Cannot change the dependencies while the loop is running.");
+            DeclarationLists& declarations = GetDeclarations();
+            if (!declarations.ReadResources.Contains(Resource))
+                declarations.ReadResources.Add(Resource);
+        }
+
+        void Module::AddWriteResource(const std::string& Resource)
+        {
+            if (GetLoop() != nullptr)
+                throw std::logic_error("Cannot change the dependencies while the loop is running.");
+            DeclarationLists& declarations = GetDeclarations();
+            if (!declarations.WriteResources.Contains(Resource))
+                declarations.WriteResources.Add(Resource);
+        }
+
+        bool Module::HasDependencies()
+        {
+            // The declarations are never removed
+            return Declarations != nullptr;
+        }
+
+        bool Module::DependsOn(Module * Other)
+        {
+            Utilities::Collections::List<Module*, false> visited;
+            Utilities::Collections::Stack<Module*, false> to_visit;
+            to_visit.Push(this);
+            Module * module;
+            while (to_visit.Pop(module))
+            {
+                if (module == Other && module != this)
+                    return true;
+                if (visited.Contains(module))
+                    continue;
+                visited.Add(module);
+                if (module->Declarations != nullptr)
+                    module->Declarations->Dependencies.ForEach([&](Module * dependency) { to_visit.Push(dependency); });
+            }
+            return false;
+        }
+
+        Module::DeclarationLists& Module::GetDeclarations()
+        {
+            if (Declarations == nullptr)
+                Declarations.reset(new DeclarationLists());
+            return *Declarations;
         }
 
         void Module::Acquire(Loop * loop)
         {
-            if (this->loop != nullptr)
+            Loop * expected = nullptr;
+            if (!this->loop.compare_exchange_strong(expected, loop, std::memory_order_acq_rel))
                 throw std::logic_error("Cannot add one Module to multiple Loops.");
-            this->loop = loop;
         }
 
         void Module::Release()
         {
-            loop = nullptr;
+            loop.store(nullptr, std::memory_order_release);
+            ProfilerRecord = nullptr;
         }
 
         void Module::_Start()
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "../Engine.dec.h"
-#include "../Utilities/Shared.h"
+#include "../Utilities/InlineFunction.h"
+#include "../Utilities/Collections/List.h"
+#include "Profiler.h"
 
 namespace Engine
 {
@@ -16,7 +18,7 @@ namespace Engine
             ///
             ///     MyModule(...) : Module(ChunkNumber) {...}
             ///
-            /// @param ExecutionChunk Specifies modules' execution order
+            /// @param ExecutionChunk Specifies modules' execution order, see also AddDependency
             Module(std::int_fast8_t ExecutionChunk = 0);
 
             virtual ~Module();
@@ -28,7 +30,8 @@ namespace Engine
             void Enable();
             /// @brief Disables the module
             ///
-            /// The OnUpdate won't be called when the module is disabled.
+            /// The OnUpdate won't be called when the module is disabled,
+            /// starting from the next loop update.
             void Disable();
 
             /// @brief Checks whether the module is enabled.
@@ -48,7 +51,39 @@ namespace Engine
 
             virtual std::string GetName() = 0;
 
+            /// @brief Gets how the module's OnUpdate is executed.
+            ///
+            /// Is cached by the running Loop, so it must not change while the module is added to a Loop.
             virtual ExecutionType GetExecutionType();
+
+            /// @brief Makes the module update after another module in each loop update.
+            ///
+            /// Like every module, a module that declares any dependencies or resources waits for
+            /// all the modules of the lower chunks. Within its chunk, it's updated as soon as
+            /// the modules it depends on are updated, without waiting for the rest of the chunk.
+            /// The dependencies on the modules that are not being updated are ignored.
+            ///
+            /// Cannot be called while the loop of the module is running.
+            /// The other module must be kept alive while this module is.
+            ///
+            /// @param Other A module with a lower or the same ExecutionChunk.
+            void AddDependency(Module * Other);
+            /// @brief Declares that the module reads a named resource in OnUpdate.
+            ///
+            /// The module is updated after the preceding modules that write the resource
+            /// and before the following ones, where the order is by ExecutionChunk
+            /// and then by the order in the loop. See AddDependency.
+            /// Cannot be called while the loop of the module is running.
+            void AddReadResource(const std::string& Resource);
+            /// @brief Declares that the module writes a named resource in OnUpdate.
+            ///
+            /// The module is updated after the preceding modules that read or write the resource
+            /// and before the following ones, where the order is by ExecutionChunk
+            /// and then by the order in the loop. See AddDependency.
+            /// Cannot be called while the loop of the module is running.
+            void AddWriteResource(const std::string& Resource);
+            /// @brief Checks whether the module declares any dependencies or resources.
+            bool HasDependencies();
         protected:
             /// @brief Is called on loop start or when being added
             ///        to the loop while the loop is running.
@@ -79,6 +114,16 @@ namespace Engine
             float GetTimeAsFloat();
             /// @brief Gets the time difference between the last 2 updates as float.
             float GetTimeDiffAsFloat();
+            /// @brief Gets how late the current update is started relative to its target time.
+            ///
+            /// Is 0 unless the Loop is paced using Loop::SetTickRate.
+            double GetLag();
+            /// @brief Gets the number of the current update since the Loop is started, starting from 1.
+            long long GetTick();
+            /// @brief Gets the time values of the current update at once, see Loop::GetClock.
+            ///
+            /// Unlike calling the other getters one by one, the values are always of the same update.
+            FrameClock GetClock();
 
             /// @brief Gets the actual time passed from the start of the Loop
             ///        to the execution of this function.
@@ -100,8 +145,9 @@ namespace Engine
             /// @param Task The function that will be called.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
-                std::function<void()> Task,
+            /// @return The handle to cancel or reschedule the call.
+            ScheduleHandle Schedule(
+                Utilities::InlineFunction<void()> Task,
                 double Time = 0,
                 ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
@@ -115,9 +161,10 @@ namespace Engine
             /// @param Task The function that will be called.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
+            /// @return The handle to cancel or reschedule the call.
+            ScheduleHandle Schedule(
                 double Time,
-                std::function<void()> Task,
+                Utilities::InlineFunction<void()> Task,
                 ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
             /// @brief Schedules to call a function.
@@ -130,17 +177,65 @@ namespace Engine
             /// @param Task The function that will be called.
             /// @param Time The time when the function will be called.
             ///        Time = 0 or Time <= CurrentTime results in calling the function shortly.
-            void Schedule(
+            /// @return The handle to cancel or reschedule the call.
+            ScheduleHandle Schedule(
                 double Time,
                 ExecutionType ExecutionType,
-                std::function<void()> Task
+                Utilities::InlineFunction<void()> Task
+            );
+            /// @brief Schedules to call a function repeatedly, see Loop::ScheduleEvery.
+            ///
+            /// Is repeated until cancelled or the Loop is stopped.
+            /// Is executed right before modules with ExecutionChunk=0.
+            ///
+            /// The exceptions thrown by the Task will be handled by this module
+            ///
+            /// @param Period The time between the calls, must be positive.
+            /// @param Task The function that will be called.
+            /// @param Policy What to do when the calls fall behind by a period or more.
+            /// @return The handle to cancel or reschedule the calls.
+            ScheduleHandle ScheduleEvery(
+                double Period,
+                Utilities::InlineFunction<void()> Task,
+                RecurrencePolicy Policy = RecurrencePolicy::Skip,
+                ExecutionType ExecutionType = ExecutionType::BoundedAsync
             );
+#ifdef ENGINE_COROUTINES
+            /// @brief Starts a coroutine in the Loop, see Loop::Spawn.
+            ///
+            /// The exceptions thrown by the coroutine will be handled by this module
+            void Spawn(Coroutine<void> Task);
+#endif
         private:
+            /// @brief The dependencies and the resources, which most modules don't declare.
+            struct DeclarationLists final
+            {
+                Utilities::Collections::List<Module*, false> Dependencies;
+                Utilities::Collections::List<std::string, false> ReadResources;
+                Utilities::Collections::List<std::string, false> WriteResources;
+            };
+
             const std::int_fast8_t ExecutionChunk;
 
-            Utilities::Shared<bool> isEnabled;
-            Utilities::Shared<Loop*> loop;
+            std::atomic<bool> isEnabled;
+            /// The loop that the module is added to, null while the loop is not running.
+            std::atomic<Loop*> loop;
+            /// Is created by the first declaration, see GetDeclarations.
+            std::unique_ptr<DeclarationLists> Declarations;
+            /// Owned by the loop, is created when the loop collects statistics or traces.
+            Profiler::ModuleRecord * ProfilerRecord;
+            /// Whether the module is started by the loop, is listed in its updating modules,
+            /// and is queued to be started or stopped. Only used by the thread that runs the loop.
+            bool IsStarted;
+            bool IsListed;
+            bool IsChangePending;
+            /// Is set from the submission of a FreeAsync update until it's done.
+            std::atomic<bool> isUpdatingAsync;
 
+            /// @brief Checks whether the module depends on another module directly or indirectly.
+            bool DependsOn(Module*);
+            /// @brief Gets the declarations, creating them if there are none.
+            DeclarationLists& GetDeclarations();
             void Acquire(Loop*);
             void Release();
             void _Start();
@@ -0,0 +1,172 @@
+#include "../Engine.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        DurationHistogram::DurationHistogram() : Count(0), TotalTime(0), MaxTime(0)
+        {
+            for (int i = 0; i < BucketsCount; i++)
+                Counts[i] = 0;
+        }
+
+        double DurationHistogram::GetMeanTime()
+        {
+            return Count > 0 ? TotalTime / Count : 0;
+        }
+
+        double DurationHistogram::GetPercentileTime(double Percentile)
+        {
+            if (!(Percentile >= 0 && Percentile <= 100))
+                throw std::domain_error("Percentile must be in [0, 100].");
+            if (Count == 0)
+                return 0;
+
+            long long rank = (long long)std::ceil(Percentile / 100 * Count);
+            if (rank < 1)
+                rank = 1;
+            long long counted = 0;
+            for (int i = 0; i < BucketsCount; i++)
+            {
+                counted += Counts[i];
+                if (counted >= rank)
+                    return std::min(std::ldexp(1.0, i + 1) / 1000000000.0, MaxTime);
+            }
+            return MaxTime;
+        }
+
+        ModuleStatistics::ModuleStatistics() : Target(nullptr) {}
+
+        ChunkStatistics::ChunkStatistics() : ExecutionChunk(0) {}
+
+        LoopStatistics::LoopStatistics() : SchedulesCount(0), MaxSchedulesCount(0) {}
+
+        Profiler::Recorder::Recorder() : Count(0), TotalNanoseconds(0), MaxNanoseconds(0)
+        {
+            for (int i = 0; i < DurationHistogram::BucketsCount; i++)
+                Counts[i].store(0, std::memory_order_relaxed);
+        }
+
+        void Profiler::Recorder::Record(std::chrono::steady_clock::duration Duration)
+        {
+            long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Duration).count();
+            if (nanoseconds < 0)
+                nanoseconds = 0;
+
+            int bucket = 0;
+            for (long long n = nanoseconds >> 1; n != 0 && bucket < DurationHistogram::BucketsCount - 1; n >>= 1)
+                bucket++;
+            Counts[bucket].fetch_add(1, std::memory_order_relaxed);
+            Count.fetch_add(1, std::memory_order_relaxed);
+            TotalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+            long long max = MaxNanoseconds.load(std::memory_order_relaxed);
+            while (nanoseconds > max && !MaxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed));
+        }
+
+        void Profiler::Recorder::Read(DurationHistogram& HistogramOut)
+        {
+            // Not an atomic snapshot, the values may be a few records apart
+            for (int i = 0; i < DurationHistogram::BucketsCount; i++)
+                HistogramOut.Counts[i] = Counts[i].load(std::memory_order_relaxed);
+            HistogramOut.Count = Count.load(std::memory_order_relaxed);
+            HistogramOut.TotalTime = (double)TotalNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+            HistogramOut.MaxTime = (double)MaxNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+        }
+
+        void Profiler::Recorder::Reset()
+        {
+            for (int i = 0; i < DurationHistogram::BucketsCount; i++)
+                Counts[i].store(0, std::memory_order_relaxed);
+            Count.store(0, std::memory_order_relaxed);
+            TotalNanoseconds.store(0, std::memory_order_relaxed);
+            MaxNanoseconds.store(0, std::memory_order_relaxed);
+        }
+
+        Profiler::ModuleRecord::ModuleRecord(Module * Target) : Target(Target), Name(Target->GetName()) {}
+
+        Profiler::Profiler() : SchedulesCount(0), MaxSchedulesCount(0)
+        {
+            for (int i = 0; i < ChunksCount; i++)
+                IsChunkExecuted[i] = false;
+        }
+
+        Profiler::~Profiler()
+        {
+            ModuleRecords.ForEach([](ModuleRecord * record) { delete record; });
+        }
+
+        Profiler::ModuleRecord * Profiler::GetModuleRecord(Module * module)
+        {
+            std::string name = module->GetName();
+            std::unique_lock<std::mutex> guard(Mutex);
+            ModuleRecord *& record = RecordsByModule[module];
+            if (record != nullptr && record->Name == name)
+                return record;
+            std::unique_ptr<ModuleRecord> created(new ModuleRecord(module));
+            ModuleRecords.Add(created.get());
+            record = created.release();
+            return record;
+        }
+
+        void Profiler::RecordChunk(int ExecutionChunk, std::chrono::steady_clock::duration Duration,
+                                   std::chrono::steady_clock::duration BarrierWait)
+        {
+            int index = ExecutionChunk + ChunksCount / 2;
+            ChunkDurations[index].Record(Duration);
+            ChunkBarrierWaits[index].Record(BarrierWait);
+            if (!IsChunkExecuted[index])
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                IsChunkExecuted[index] = true;
+                ChunksOrder.Add(ExecutionChunk);
+            }
+        }
+
+        void Profiler::RecordSchedulesCount(int Count)
+        {
+            SchedulesCount.store(Count, std::memory_order_relaxed);
+            if (Count > MaxSchedulesCount.load(std::memory_order_relaxed))
+                MaxSchedulesCount.store(Count, std::memory_order_relaxed);
+        }
+
+        void Profiler::Read(LoopStatistics& StatisticsOut)
+        {
+            Ticks.Read(StatisticsOut.Ticks);
+            ScheduleLateness.Read(StatisticsOut.ScheduleLateness);
+            StatisticsOut.SchedulesCount = SchedulesCount.load(std::memory_order_relaxed);
+            StatisticsOut.MaxSchedulesCount = MaxSchedulesCount.load(std::memory_order_relaxed);
+
+            std::unique_lock<std::mutex> guard(Mutex);
+            ModuleRecords.ForEach([&](ModuleRecord * record) {
+                ModuleStatistics statistics;
+                statistics.Target = record->Target;
+                statistics.Name = record->Name;
+                record->Updates.Read(statistics.Updates);
+                StatisticsOut.Modules.Add(statistics);
+            });
+            ChunksOrder.ForEach([&](int chunk) {
+                ChunkStatistics statistics;
+                statistics.ExecutionChunk = chunk;
+                ChunkDurations[chunk + ChunksCount / 2].Read(statistics.Durations);
+                ChunkBarrierWaits[chunk + ChunksCount / 2].Read(statistics.BarrierWaits);
+                StatisticsOut.Chunks.Add(statistics);
+            });
+        }
+
+        void Profiler::Reset()
+        {
+            Ticks.Reset();
+            ScheduleLateness.Reset();
+            SchedulesCount.store(0, std::memory_order_relaxed);
+            MaxSchedulesCount.store(0, std::memory_order_relaxed);
+            for (int i = 0; i < ChunksCount; i++)
+            {
+                ChunkDurations[i].Reset();
+                ChunkBarrierWaits[i].Reset();
+            }
+            std::unique_lock<std::mutex> guard(Mutex);
+            ModuleRecords.ForEach([](ModuleRecord * record) { record->Updates.Reset(); });
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/Collections/List.h"
+#include <unordered_map>
+
+namespace Engine
+{
+    namespace Core
+    {
+        struct DurationHistogram final
+        {
+            static const int BucketsCount = 40;
+
+            /// Counts[i] is the number of durations in [2^i, 2^(i+1)) nanoseconds,
+            /// Counts[0] also includes the shorter ones and the last one the longer ones.
+            long long Counts[BucketsCount];
+            long long Count;
+            /// In seconds.
+            double TotalTime;
+            /// In seconds.
+            double MaxTime;
+
+            DurationHistogram();
+
+            /// @brief Gets the average duration in seconds, 0 if empty.
+            double GetMeanTime();
+            /// @brief Gets the upper bound of the bucket that contains a percentile, in seconds.
+            /// @param Percentile A number in [0, 100].
+            double GetPercentileTime(double Percentile);
+        };
+
+        struct ModuleStatistics final
+        {
+            /// May be removed from the loop or deleted, do not dereference.
+            Module * Target;
+            std::string Name;
+            /// The durations of OnUpdate.
+            DurationHistogram Updates;
+
+            ModuleStatistics();
+        };
+
+        struct ChunkStatistics final
+        {
+            int ExecutionChunk;
+            /// The wall times from the start of the chunk to its barrier.
+            DurationHistogram Durations;
+            /// The times that the loop thread waited for the other threads at the barriers of the chunk.
+            DurationHistogram BarrierWaits;
+
+            ChunkStatistics();
+        };
+
+        struct LoopStatistics final
+        {
+            /// The wall times of the ticks, without pacing and idling.
+            DurationHistogram Ticks;
+            /// The times from when the schedules are due (or submitted, if later) to their execution.
+            DurationHistogram ScheduleLateness;
+            /// The schedules that were waiting in the last tick.
+            int SchedulesCount;
+            /// The maximum of SchedulesCount.
+            int MaxSchedulesCount;
+            /// The modules that are updated while collecting statistics, in the order of their first updates.
+            Utilities::Collections::List<ModuleStatistics, false> Modules;
+            /// The chunks that are executed while collecting statistics, in the order of execution.
+            /// The chunks are not recorded while the modules are ordered by their dependencies.
+            Utilities::Collections::List<ChunkStatistics, false> Chunks;
+
+            LoopStatistics();
+        };
+
+        class Profiler final
+        {
+            friend Loop;
+        public:
+            /// @brief Records durations into a DurationHistogram, thread-safe and lock-free.
+            class Recorder final
+            {
+            public:
+                Recorder();
+                void Record(std::chrono::steady_clock::duration Duration);
+                void Read(DurationHistogram& HistogramOut);
+                void Reset();
+            private:
+                std::atomic<long long> Counts[DurationHistogram::BucketsCount];
+                std::atomic<long long> Count;
+                std::atomic<long long> TotalNanoseconds;
+                std::atomic<long long> MaxNanoseconds;
+            };
+
+            /// @brief The record of a module, kept by the module while it's in the loop.
+            ///
+            /// Is reused when the module is added again or the loop is run again,
+            /// and is kept until the loop is destroyed, as the trace events refer to its name.
+            struct ModuleRecord final
+            {
+                Module * Target;
+                std::string Name;
+                Recorder Updates;
+                ModuleRecord(Module * Target);
+            };
+
+            Profiler();
+            ~Profiler();
+
+            Profiler(const Profiler&) = delete;
+            Profiler& operator=(const Profiler&) = delete;
+        private:
+            static const int ChunksCount = 256; // std::int_fast8_t values
+
+            Recorder Ticks;
+            Recorder ScheduleLateness;
+            std::atomic<int> SchedulesCount;
+            std::atomic<int> MaxSchedulesCount;
+            Recorder ChunkDurations[ChunksCount];
+            Recorder ChunkBarrierWaits[ChunksCount];
+
+            /// Guards ModuleRecords, RecordsByModule and ChunksOrder.
+            std::mutex Mutex;
+            Utilities::Collections::List<ModuleRecord*, false> ModuleRecords;
+            /// The latest record of each module.
+            std::unordered_map<Module*, ModuleRecord*> RecordsByModule;
+            /// The chunks in the order of their first executions.
+            Utilities::Collections::List<int, false> ChunksOrder;
+            bool IsChunkExecuted[ChunksCount];
+
+            /// @brief Gets the record of a module, creating it for a new module.
+            ///
+            /// A new module at the address of a deleted one gets its own record, unless their names are the same.
+            ModuleRecord * GetModuleRecord(Module*);
+            void RecordChunk(int ExecutionChunk, std::chrono::steady_clock::duration Duration,
+                             std::chrono::steady_clock::duration BarrierWait);
+            void RecordSchedulesCount(int Count);
+            void Read(LoopStatistics& StatisticsOut);
+            void Reset();
+        };
+    }
+}
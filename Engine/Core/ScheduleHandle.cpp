@@ -0,0 +1,74 @@
+#include "../Engine.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        ScheduleHandle::ScheduleHandle() : Owner(nullptr), Job(nullptr) {}
+
+        ScheduleHandle::ScheduleHandle(Loop * Owner, Loop::ScheduledJob * Job) : Owner(Owner), Job(Job)
+        {
+            Job->References.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ScheduleHandle::ScheduleHandle(const ScheduleHandle& Op) : Owner(Op.Owner), Job(Op.Job)
+        {
+            if (Job != nullptr)
+                Job->References.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ScheduleHandle::ScheduleHandle(ScheduleHandle&& Op) noexcept : Owner(Op.Owner), Job(Op.Job)
+        {
+            Op.Owner = nullptr;
+            Op.Job = nullptr;
+        }
+
+        ScheduleHandle::~ScheduleHandle()
+        {
+            if (Job != nullptr)
+                Loop::ReleaseJob(Job);
+        }
+
+        ScheduleHandle& ScheduleHandle::operator=(ScheduleHandle Op) noexcept
+        {
+            std::swap(Owner, Op.Owner);
+            std::swap(Job, Op.Job);
+            return *this;
+        }
+
+        bool ScheduleHandle::Cancel()
+        {
+            if (Job == nullptr)
+                return false;
+            int state = Loop::ScheduledJob::Pending;
+            while (!Job->State.compare_exchange_strong(state, Loop::ScheduledJob::Cancelled, std::memory_order_acq_rel))
+                if (state != Loop::ScheduledJob::Pending && (state != Loop::ScheduledJob::Running || Job->Period == 0))
+                    return false;
+            // A running recurring job is released by the thread that runs it
+            if (state == Loop::ScheduledJob::Running)
+                return true;
+            // The loop doesn't touch the functions of a job that it can't start
+            Job->Task = nullptr;
+            Job->ExceptionHandler = nullptr;
+            Owner->Requeue(Job);
+            return true;
+        }
+
+        bool ScheduleHandle::Reschedule(double Time)
+        {
+            if (Job == nullptr || Job->State.load(std::memory_order_acquire) != Loop::ScheduledJob::Pending)
+                return false;
+            Job->DueTime.store(Time, std::memory_order_relaxed);
+            Owner->Requeue(Job);
+            return true;
+        }
+
+        bool ScheduleHandle::IsPending()
+        {
+            if (Job == nullptr)
+                return false;
+            int state = Job->State.load(std::memory_order_acquire);
+            return state == Loop::ScheduledJob::Pending || (state == Loop::ScheduledJob::Running && Job->Period > 0);
+        }
+    }
+}
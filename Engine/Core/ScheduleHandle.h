@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "Loop.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class ScheduleHandle final
+        {
+            friend Loop;
+        public:
+            /// @brief Creates a handle that refers to no schedule.
+            ScheduleHandle();
+            ScheduleHandle(const ScheduleHandle&);
+            ScheduleHandle(ScheduleHandle&&) noexcept;
+            ~ScheduleHandle();
+
+            ScheduleHandle& operator=(ScheduleHandle) noexcept;
+
+            /// @brief Cancels the schedule if it's not executed yet.
+            ///
+            /// The function of the schedule is released right away,
+            /// and the schedule is removed from the loop.
+            /// A recurring schedule that is being executed is released after the call instead.
+            /// Can be called by any thread, in O(1).
+            ///
+            /// @return Whether the schedule was pending and is not going to be executed (again).
+            bool Cancel();
+            /// @brief Changes the time of the schedule if it's not executed yet.
+            ///
+            /// Takes effect from the next loop update, the schedule may be executed in the current one.
+            /// The next calls of a recurring schedule are counted from the new time.
+            /// Can be called by any thread, in O(1).
+            ///
+            /// @param Time The new time when the function will be called.
+            ///        Time <= CurrentTime results in calling the function shortly.
+            /// @return Whether the schedule was pending.
+            bool Reschedule(double Time);
+            /// @brief Checks whether the schedule is waiting to be executed.
+            ///
+            /// Is false once the schedule is being executed, done or cancelled,
+            /// and for the schedules that are dropped because the loop is stopped.
+            /// A recurring schedule is pending until it's cancelled or dropped.
+            bool IsPending();
+        private:
+            /// Must outlive the handle to cancel or reschedule.
+            Loop * Owner;
+            Loop::ScheduledJob * Job;
+
+            /// @brief Refers to a job, taking a reference to it.
+            ScheduleHandle(Loop * Owner, Loop::ScheduledJob * Job);
+        };
+    }
+}
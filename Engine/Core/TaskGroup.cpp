@@ -0,0 +1,93 @@
+#include "../Engine.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        /// The tasks that the thread has freed, for its next groups.
+        struct GroupTaskCache
+        {
+            TaskGroup::GroupTask * FreeTasks = nullptr;
+
+            ~GroupTaskCache()
+            {
+                for (TaskGroup::GroupTask * next; FreeTasks != nullptr; FreeTasks = next)
+                {
+                    next = FreeTasks->Next;
+                    delete FreeTasks;
+                }
+            }
+        };
+        static thread_local GroupTaskCache TaskCache;
+
+        TaskGroup::TaskGroup() : Pool(ThreadPool::GetCurrent()), Pending(0), Tasks(nullptr) {}
+
+        TaskGroup::~TaskGroup()
+        {
+            try
+            {
+                Wait();
+            }
+            catch (...) {} // ignore
+        }
+
+        void TaskGroup::Run(Utilities::InlineFunction<void()> Task)
+        {
+            if (Pool == nullptr)
+            {
+                Execute(Task);
+                return;
+            }
+            GroupTask * task = TaskCache.FreeTasks;
+            if (task != nullptr)
+                TaskCache.FreeTasks = task->Next;
+            else
+                task = new GroupTask();
+            task->Owner = this;
+            task->Function = std::move(Task);
+            task->Next = Tasks;
+            Tasks = task;
+            Pool->Fork(task, Pending);
+        }
+
+        void TaskGroup::Wait()
+        {
+            if (Pool != nullptr)
+                Pool->Join(Pending);
+            for (GroupTask * next; Tasks != nullptr; Tasks = next)
+            {
+                next = Tasks->Next;
+                Tasks->Function = nullptr;
+                Tasks->Next = TaskCache.FreeTasks;
+                TaskCache.FreeTasks = Tasks;
+            }
+
+            std::exception_ptr exception;
+            {
+                std::unique_lock<std::mutex> guard(ExceptionMutex);
+                std::swap(exception, Exception);
+            }
+            if (exception != nullptr)
+                std::rethrow_exception(exception);
+        }
+
+        void TaskGroup::GroupTask::Execute()
+        {
+            Owner->Execute(Function);
+        }
+
+        void TaskGroup::Execute(Utilities::InlineFunction<void()>& Function)
+        {
+            try
+            {
+                Function();
+            }
+            catch (...)
+            {
+                std::unique_lock<std::mutex> guard(ExceptionMutex);
+                if (Exception == nullptr)
+                    Exception = std::current_exception();
+            }
+        }
+    }
+}
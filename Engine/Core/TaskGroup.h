@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/InlineFunction.h"
+#include "ThreadPool.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class TaskGroup final
+        {
+        public:
+            /// @brief Creates a group that runs its tasks on the pool of the calling thread.
+            ///
+            /// Inside the updates and schedules of a running Loop (except the FreeAsync ones),
+            /// the tasks run on the threads of the Loop. Elsewhere, they run right away in Run.
+            TaskGroup();
+            /// Waits for the tasks, ignoring their exceptions.
+            ~TaskGroup();
+
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+
+            /// @brief Starts running a task.
+            ///
+            /// Must be called by the thread that has created the group.
+            /// The task is moved into the group, a small one without a heap allocation.
+            /// The nodes of the tasks are kept by the thread for its next groups.
+            void Run(Utilities::InlineFunction<void()> Task);
+            /// @brief Waits for the started tasks to be done.
+            ///
+            /// The calling thread executes the tasks of the pool meanwhile.
+            /// Must be called by the thread that has created the group.
+            /// Rethrows the first exception thrown by the tasks.
+            void Wait();
+        private:
+            class GroupTask final : public ThreadPool::Task
+            {
+            public:
+                TaskGroup * Owner;
+                Utilities::InlineFunction<void()> Function;
+                /// The next task of the group, or the next free task of the thread.
+                GroupTask * Next;
+                void Execute() override;
+            };
+            friend struct GroupTaskCache;
+
+            ThreadPool * const Pool;
+            std::atomic<int> Pending;
+            /// The started tasks, in the reverse order of starting.
+            GroupTask * Tasks;
+
+            std::mutex ExceptionMutex;
+            /// The first exception thrown by the tasks, guarded by ExceptionMutex.
+            std::exception_ptr Exception;
+
+            void Execute(Utilities::InlineFunction<void()>& Function);
+        };
+    }
+}
@@ -0,0 +1,439 @@
+#include "../Engine.h"
+#include <fstream>
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace Engine
+{
+    namespace Core
+    {
+        /// The pool that the current thread belongs to, and its index.
+        struct ThreadPoolWorker
+        {
+            ThreadPool * Pool = nullptr;
+            int Index = 0;
+            /// The counter of the batch of the task that is being executed.
+            std::atomic<int> * Pending = nullptr;
+        };
+        static thread_local ThreadPoolWorker CurrentWorker;
+
+        /// Hints the CPU that the thread is spinning, which saves power and the resources of the sibling thread.
+        static inline void Pause()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            asm volatile("yield");
+#endif
+        }
+
+        ThreadPool::Task::Task() : Pending(nullptr), PreferredThread(-1) {}
+
+        ThreadPool::Task::~Task() {}
+
+        void ThreadPool::Task::SetPreferredThread(int Index)
+        {
+            PreferredThread = Index;
+        }
+
+        ThreadPool::ThreadPool(int ThreadsCount, const std::string& ThreadsName, int MaxUsersCount)
+            : ThreadsCount(ThreadsCount > 0 ? ThreadsCount :
+                           (std::thread::hardware_concurrency() > 0 ? (int)std::thread::hardware_concurrency() : 1)),
+              UsersCount(MaxUsersCount > 0 ? MaxUsersCount : 1),
+              WorkersCount(this->UsersCount + this->ThreadsCount - 1), ThreadsName(ThreadsName),
+              ShouldTerminate(false), SpinNanoseconds(20000),
+              SleepingWorkersCount(0), SleepingJoinsCount(0)
+        {
+            Workers = new Worker[WorkersCount];
+            for (int i = 0; i < WorkersCount; i++)
+            {
+                Workers[i].Thread = nullptr;
+                Workers[i].IsUsed.store(false, std::memory_order_relaxed);
+                Workers[i].IsInboxTaken.store(false, std::memory_order_relaxed);
+                Workers[i].ExecutingCount.store(0, std::memory_order_relaxed);
+                Workers[i].PreviousPool = nullptr;
+                Workers[i].PreviousIndex = 0;
+            }
+            for (int i = UsersCount; i < WorkersCount; i++)
+                Workers[i].Thread = new std::thread([this](int Index) { WorkerProcess(Index); }, i);
+        }
+
+        ThreadPool::~ThreadPool()
+        {
+            ShouldTerminate.store(true, std::memory_order_seq_cst);
+            Work.IncreaseAndWakeAll();
+
+            for (int i = UsersCount; i < WorkersCount; i++)
+            {
+                Workers[i].Thread->join();
+                delete Workers[i].Thread;
+            }
+            delete[] Workers;
+        }
+
+        void ThreadPool::SetAffinity(const int * Cpus, int Count)
+        {
+            if (Count <= 0)
+                throw std::invalid_argument("Count must be positive.");
+#ifdef __linux__
+            for (int i = UsersCount; i < WorkersCount; i++)
+            {
+                int cpu = Cpus[(i - UsersCount) % Count];
+                if (cpu < 0 || cpu >= CPU_SETSIZE)
+                    throw std::invalid_argument("The CPU is out of range.");
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                if (pthread_setaffinity_np(Workers[i].Thread->native_handle(), sizeof(set), &set) != 0)
+                    throw std::runtime_error("Cannot pin the thread to CPU " + std::to_string(cpu) + ".");
+            }
+#endif
+        }
+
+        void ThreadPool::SetThreadAffinity(const int * Cpus, int Count)
+        {
+            if (Count <= 0)
+                throw std::invalid_argument("Count must be positive.");
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int i = 0; i < Count; i++)
+            {
+                if (Cpus[i] < 0 || Cpus[i] >= CPU_SETSIZE)
+                    throw std::invalid_argument("The CPU is out of range.");
+                CPU_SET(Cpus[i], &set);
+            }
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                throw std::runtime_error("Cannot pin the thread to the CPUs.");
+#endif
+        }
+
+        int ThreadPool::GetNodeCpus(int Node, int * Cpus, int Capacity)
+        {
+            // A list of CPUs and ranges, like "0-3,8-11"
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(Node) + "/cpulist");
+            int count = 0;
+            int first, last;
+            while (file >> first)
+            {
+                last = first;
+                if (file.peek() == '-')
+                {
+                    file.get();
+                    if (!(file >> last))
+                        break;
+                }
+                for (int cpu = first; cpu <= last; cpu++, count++)
+                    if (count < Capacity)
+                        Cpus[count] = cpu;
+                if (file.peek() != ',')
+                    break;
+                file.get();
+            }
+            return count;
+        }
+
+        void ThreadPool::SetSpinTime(std::chrono::nanoseconds Time)
+        {
+            SpinNanoseconds.store(std::max<long long>(Time.count(), 0), std::memory_order_relaxed);
+        }
+
+        std::chrono::nanoseconds ThreadPool::GetSpinTime()
+        {
+            return std::chrono::nanoseconds(SpinNanoseconds.load(std::memory_order_relaxed));
+        }
+
+        int ThreadPool::GetThreadsCount()
+        {
+            return ThreadsCount;
+        }
+
+        ThreadPool * ThreadPool::GetCurrent()
+        {
+            return CurrentWorker.Pool;
+        }
+
+        void ThreadPool::Attach()
+        {
+            if (CurrentWorker.Pool == this)
+                throw std::logic_error("The calling thread is already attached to the pool.");
+            for (int i = 0; i < UsersCount; i++)
+            {
+                bool is_used = false;
+                if (Workers[i].IsUsed.load(std::memory_order_relaxed)
+                    || !Workers[i].IsUsed.compare_exchange_strong(is_used, true, std::memory_order_acquire))
+                    continue;
+                Workers[i].PreviousPool = CurrentWorker.Pool;
+                Workers[i].PreviousIndex = CurrentWorker.Index;
+                CurrentWorker.Pool = this;
+                CurrentWorker.Index = i;
+                return;
+            }
+            throw std::runtime_error("Too many threads are attached to the pool.");
+        }
+
+        void ThreadPool::Detach()
+        {
+            int index = GetWorkerIndex();
+            if (index >= UsersCount || CurrentWorker.Pending != nullptr)
+                throw std::logic_error("Only an attached thread that is not executing a task can detach.");
+            CurrentWorker.Pool = Workers[index].PreviousPool;
+            CurrentWorker.Index = Workers[index].PreviousIndex;
+            Workers[index].IsUsed.store(false, std::memory_order_release);
+        }
+
+        void ThreadPool::Execute(Task ** Tasks, int Count, std::chrono::steady_clock::duration * WaitTime)
+        {
+            if (Count <= 0)
+                return;
+            std::atomic<int> pending(0);
+            // There's no need to wake the other threads for a single task
+            PushTasks(Tasks, Count, pending, Count > 1);
+            Join(pending, WaitTime);
+        }
+
+        void ThreadPool::Push(Task * task)
+        {
+            GetWorkerIndex();
+            if (CurrentWorker.Pending == nullptr)
+                throw std::logic_error("Only the tasks that are executed by the pool can push tasks.");
+            PushTasks(&task, 1, *CurrentWorker.Pending, true);
+        }
+
+        void ThreadPool::Fork(Task * task, std::atomic<int>& Pending)
+        {
+            PushTasks(&task, 1, Pending, true);
+        }
+
+        void ThreadPool::Join(std::atomic<int>& Pending, std::chrono::steady_clock::duration * WaitTime)
+        {
+            int index = GetWorkerIndex();
+            unsigned int seed = (unsigned int)index;
+            while (Pending.load(std::memory_order_acquire) > 0)
+            {
+                if (TryExecuteOne(index, seed))
+                    continue;
+                // Nothing left to steal, the rest is being executed by the other threads,
+                // which may push more tasks
+                std::chrono::time_point<std::chrono::steady_clock> wait_start;
+                if (WaitTime != nullptr)
+                    wait_start = std::chrono::steady_clock::now();
+                std::uint32_t done = Done.Value.load(std::memory_order_seq_cst);
+                if (!SpinUntil([&]() { return Pending.load(std::memory_order_acquire) == 0 || HasTasks(index); }))
+                {
+                    SleepingJoinsCount.fetch_add(1, std::memory_order_seq_cst);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (Pending.load(std::memory_order_acquire) > 0 && !HasTasks(index))
+                        Done.Wait(done);
+                    SleepingJoinsCount.fetch_sub(1, std::memory_order_relaxed);
+                }
+                if (WaitTime != nullptr)
+                    *WaitTime += std::chrono::steady_clock::now() - wait_start;
+            }
+        }
+
+        int ThreadPool::GetWorkerIndex()
+        {
+            if (CurrentWorker.Pool != this)
+                throw std::logic_error("The calling thread does not belong to the pool.");
+            return CurrentWorker.Index;
+        }
+
+        void ThreadPool::PushTasks(Task ** Tasks, int Count, std::atomic<int>& Pending, bool ShouldWake)
+        {
+            int index = GetWorkerIndex();
+            // If it's the batch of the pushing task, it's still pending, so Pending doesn't reach 0 meanwhile
+            Pending.fetch_add(Count, std::memory_order_relaxed);
+            // Pushed in reverse, the calling thread pops them in order and the others steal from the back
+            bool has_preferred = false;
+            for (int i = Count - 1; i >= 0; i--)
+            {
+                Tasks[i]->Pending = &Pending;
+                int preferred = Tasks[i]->PreferredThread;
+                if (preferred > 0 && preferred < ThreadsCount)
+                {
+                    Workers[UsersCount + preferred - 1].Inbox.Push(Tasks[i]);
+                    has_preferred = true;
+                }
+                else
+                    Workers[index].Deque.Push(Tasks[i]);
+            }
+
+            if ((!ShouldWake && !has_preferred) || ThreadsCount == 1)
+                return;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Only as many workers as the tasks that can be stolen are woken, the calling thread takes one.
+            // An inbox task needs its own worker, which can't be woken alone.
+            WakeSleeping(has_preferred ? WorkersCount : std::max(Count - 1, 1));
+        }
+
+        void ThreadPool::WakeSleeping(int WorkersCount)
+        {
+            // Either a sleeping thread is counted here, or it sees the change before sleeping
+            if (WorkersCount > 0 && SleepingWorkersCount.load(std::memory_order_relaxed) > 0)
+                Work.IncreaseAndWake(WorkersCount);
+            if (SleepingJoinsCount.load(std::memory_order_relaxed) > 0)
+                Done.IncreaseAndWakeAll();
+        }
+
+        template <typename ConditionType>
+        bool ThreadPool::SpinUntil(ConditionType Condition)
+        {
+            long long spin_time = SpinNanoseconds.load(std::memory_order_relaxed);
+            if (spin_time <= 0)
+                return Condition();
+            auto start = std::chrono::steady_clock::now();
+            auto spin_end = start + std::chrono::nanoseconds(spin_time);
+            auto yield_end = spin_end + std::chrono::nanoseconds(spin_time);
+            // The clock is read once in a while, it's slower than a pause
+            for (int i = 0; ; i++)
+            {
+                if (Condition())
+                    return true;
+                if (i % 16 == 15 && std::chrono::steady_clock::now() >= spin_end)
+                    break;
+                Pause();
+            }
+            while (std::chrono::steady_clock::now() < yield_end)
+            {
+                if (Condition())
+                    return true;
+                std::this_thread::yield();
+            }
+            return Condition();
+        }
+
+        void ThreadPool::WorkerProcess(int Index)
+        {
+#ifdef __linux__
+            if (!ThreadsName.empty())
+            {
+                // Linux limits the names to 15 characters
+                std::string number = std::to_string(Index - UsersCount + 1);
+                std::string name = ThreadsName.substr(0, 15 - number.size() - 1) + "-" + number;
+                pthread_setname_np(pthread_self(), name.c_str());
+            }
+#endif
+            CurrentWorker.Pool = this;
+            CurrentWorker.Index = Index;
+            unsigned int seed = (unsigned int)Index;
+            while (true)
+            {
+                if (TryExecuteOne(Index, seed))
+                    continue;
+
+                // Spins shortly as the next tasks usually come soon, then sleeps
+                std::uint32_t work = Work.Value.load(std::memory_order_seq_cst);
+                if (SpinUntil([&]() { return HasTasks(Index) || ShouldTerminate.load(std::memory_order_relaxed); }))
+                {
+                    if (ShouldTerminate.load(std::memory_order_relaxed))
+                        return;
+                    continue;
+                }
+                SleepingWorkersCount.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!HasTasks(Index) && !ShouldTerminate.load(std::memory_order_seq_cst))
+                    Work.Wait(work);
+                SleepingWorkersCount.fetch_sub(1, std::memory_order_relaxed);
+                if (ShouldTerminate.load(std::memory_order_relaxed))
+                    return;
+            }
+        }
+
+        bool ThreadPool::TryExecuteOne(int Index, unsigned int& Seed)
+        {
+            // The tasks of the inbox can be stolen once they're in the deque
+            int moved = DrainInbox(Index, Index);
+            if (moved > 1)
+            {
+                // The sleeping threads may not see the moved tasks otherwise
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                WakeSleeping(moved - 1);
+            }
+
+            Task * task;
+            if (Workers[Index].Deque.Pop(task))
+            {
+                ExecuteTask(Index, task);
+                return true;
+            }
+
+            // Start from a pseudo-random victim to spread the thieves
+            Seed = Seed * 1103515245u + 12345u;
+            int start = (int)((Seed >> 16) % (unsigned int)WorkersCount);
+            for (int i = 0; i < WorkersCount; i++)
+            {
+                int victim = (start + i) % WorkersCount;
+                if (victim != Index && Workers[victim].Deque.Steal(task))
+                {
+                    ExecuteTask(Index, task);
+                    return true;
+                }
+            }
+
+            // The preferred tasks of the busy workers would wait for them otherwise
+            for (int i = 0; i < WorkersCount; i++)
+            {
+                int victim = (start + i) % WorkersCount;
+                if (victim != Index && Workers[victim].ExecutingCount.load(std::memory_order_acquire) > 0
+                    && DrainInbox(victim, Index) > 0 && Workers[Index].Deque.Pop(task))
+                {
+                    ExecuteTask(Index, task);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        int ThreadPool::DrainInbox(int Inbox, int Index)
+        {
+            Worker& inbox = Workers[Inbox];
+            if (inbox.Inbox.IsEmpty() || inbox.IsInboxTaken.exchange(true, std::memory_order_acquire))
+                return 0;
+            int moved = 0;
+            for (Task * task = inbox.Inbox.PopAll(), * next; task != nullptr; task = next, moved++)
+            {
+                next = inbox.Inbox.GetNext(task);
+                Workers[Index].Deque.Push(task);
+            }
+            inbox.IsInboxTaken.store(false, std::memory_order_release);
+            return moved;
+        }
+
+        bool ThreadPool::HasTasks(int Index)
+        {
+            for (int i = 0; i < WorkersCount; i++)
+                if (!Workers[i].Deque.IsEmpty()
+                    || (!Workers[i].Inbox.IsEmpty()
+                        && (i == Index || Workers[i].ExecutingCount.load(std::memory_order_acquire) > 0)))
+                    return true;
+            return false;
+        }
+
+        void ThreadPool::ExecuteTask(int Index, Task * task)
+        {
+            std::atomic<int> * pending = task->Pending;
+            std::atomic<int> * previous_pending = CurrentWorker.Pending;
+            CurrentWorker.Pending = pending;
+            Workers[Index].ExecutingCount.fetch_add(1, std::memory_order_release);
+            try
+            {
+                task->Execute();
+            }
+            catch (...) {} // ignore
+            Workers[Index].ExecutingCount.fetch_sub(1, std::memory_order_release);
+            CurrentWorker.Pending = previous_pending;
+            if (pending->fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                // The counter may be destroyed by the waiting thread from now on
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                WakeSleeping(0);
+            }
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/Collections/WorkStealingDeque.h"
+#include "../Utilities/Futex.h"
+#include "../Utilities/Collections/MPSCQueue.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class ThreadPool final
+        {
+        public:
+            /// @brief A unit of work that is executed by a ThreadPool.
+            ///
+            /// The task objects are owned by the caller
+            /// and must be kept alive until their execution is done.
+            class Task : public Utilities::Collections::MPSCQueue<Task>::Node
+            {
+                friend ThreadPool;
+            public:
+                Task();
+                virtual ~Task();
+                /// @brief Is called by one of the threads of the pool.
+                ///
+                /// Exceptions thrown by this function are ignored.
+                virtual void Execute() = 0;
+                /// @brief Sets the thread that executes the task when it's executed as a batch.
+                ///
+                /// The task waits for that thread while it's idle,
+                /// and is taken by the idle threads while that thread is busy with another task.
+                /// @param Index The thread in [0, GetThreadsCount()), 0 is the thread that executes the batch.
+                ///        Index < 0 results in any thread, which is the default.
+                void SetPreferredThread(int Index);
+            private:
+                std::atomic<int> * Pending;
+                int PreferredThread;
+            };
+
+            /// @brief Creates the pool and starts its threads, which are kept until the pool is destroyed.
+            ///
+            /// The threads that use the pool must attach to it, see Attach.
+            /// The pool can be shared by several loops, each of them attaches its own thread.
+            ///
+            /// @param ThreadsCount The number of threads including the thread that uses the pool.
+            ///        ThreadsCount <= 0 results in using std::thread::hardware_concurrency().
+            /// @param ThreadsName The name of the threads of the pool, which is followed by their number.
+            ///        Is cut to the limit of the system. An empty name results in not naming the threads.
+            /// @param MaxUsersCount The maximum number of the threads that are attached at once.
+            ThreadPool(int ThreadsCount = 0, const std::string& ThreadsName = "Worker", int MaxUsersCount = 4);
+            /// @brief Stops the threads of the pool.
+            ///
+            /// No thread must be attached to the pool.
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            /// @brief Gets the number of threads including the thread that uses the pool.
+            int GetThreadsCount();
+            /// @brief Gets the pool that the calling thread belongs to, null if none.
+            static ThreadPool * GetCurrent();
+
+            /// @brief Makes the calling thread a thread of the pool until Detach is called.
+            ///
+            /// The thread may be attached to another pool before, which is restored by Detach.
+            /// Throws std::logic_error if the thread is already attached to this pool
+            /// and std::runtime_error if MaxUsersCount threads are attached.
+            void Attach();
+            /// @brief Detaches the calling thread, which must not be executing tasks of the pool.
+            ///
+            /// Throws std::logic_error if the thread is not attached to this pool by Attach.
+            void Detach();
+
+            /// @brief Pins each thread of the pool to a CPU, the attached threads are not pinned.
+            ///
+            /// The i-th thread is pinned to Cpus[i % Count], the CPUs may be isolated ones (isolcpus).
+            /// The memory that a pinned thread touches first is placed on its NUMA node by the system.
+            /// Is ignored on the systems other than Linux.
+            /// Throws std::invalid_argument if Count <= 0 and std::runtime_error if a CPU can't be used.
+            void SetAffinity(const int * Cpus, int Count);
+            /// @brief Pins the calling thread to a set of CPUs.
+            ///
+            /// Is ignored on the systems other than Linux.
+            /// Throws std::invalid_argument if Count <= 0 and std::runtime_error if none of the CPUs can be used.
+            static void SetThreadAffinity(const int * Cpus, int Count);
+            /// @brief Gets the CPUs of a NUMA node, to pin the threads that use the node's memory.
+            ///
+            /// @param Cpus Receives the first Capacity CPUs.
+            /// @return The number of the CPUs of the node, 0 if it's unknown.
+            static int GetNodeCpus(int Node, int * Cpus, int Capacity);
+
+            /// @brief Sets how long a thread that runs out of work spins, then yields, before sleeping.
+            ///
+            /// Spinning avoids the latency of waking the threads when the next tasks come shortly,
+            /// at the cost of the CPU time of the spinning threads. 0 results in sleeping right away.
+            /// Applies to both spinning and then yielding, each for this long.
+            /// Can be called while the pool is used.
+            void SetSpinTime(std::chrono::nanoseconds Time);
+            std::chrono::nanoseconds GetSpinTime();
+
+            /// @brief Executes the tasks on the pool and returns when they are all done.
+            ///
+            /// The calling thread also executes the tasks while waiting,
+            /// and may execute the other tasks of the pool too.
+            /// Can only be called by the threads of the pool,
+            /// including the tasks that are being executed.
+            ///
+            /// @param Tasks The tasks to execute, in the preferred order.
+            /// @param Count The tasks count.
+            /// @param WaitTime If not null, the time that the calling thread waits
+            ///        for the other threads to finish is added to it.
+            void Execute(Task ** Tasks, int Count, std::chrono::steady_clock::duration * WaitTime = nullptr);
+            /// @brief Adds a task to the batch of the task that is being executed.
+            ///
+            /// Can only be called by the tasks that are being executed by this pool,
+            /// the Execute or Join call of the batch also waits for the pushed task.
+            /// The task is executed by the calling thread unless it's stolen first.
+            void Push(Task*);
+            /// @brief Starts executing a task on the pool, see Join.
+            ///
+            /// Can only be called by the threads of the pool.
+            /// @param Pending Is increased now and decreased when the task is done.
+            void Fork(Task*, std::atomic<int>& Pending);
+            /// @brief Waits until Pending reaches 0, executing the tasks of the pool meanwhile.
+            ///
+            /// Can only be called by the threads of the pool.
+            /// @param WaitTime If not null, the time that the calling thread waits
+            ///        for the other threads to finish is added to it.
+            void Join(std::atomic<int>& Pending, std::chrono::steady_clock::duration * WaitTime = nullptr);
+        private:
+            struct Worker
+            {
+                Utilities::Collections::WorkStealingDeque<Task*> Deque;
+                /// The tasks that prefer this worker, moved to Deque by its thread,
+                /// or to the deque of another thread while this one is busy.
+                Utilities::Collections::MPSCQueue<Task> Inbox;
+                /// Is set by the thread that drains Inbox, which has one consumer at a time.
+                std::atomic<bool> IsInboxTaken;
+                /// The tasks that the thread is executing, nested ones included.
+                std::atomic<int> ExecutingCount;
+                std::thread * Thread;
+                /// Whether an attached thread uses this worker, only for the users.
+                std::atomic<bool> IsUsed;
+                /// The pool of the attached thread before this one, restored on Detach.
+                ThreadPool * PreviousPool;
+                int PreviousIndex;
+            };
+
+            const int ThreadsCount;
+            const int UsersCount;
+            /// UsersCount + ThreadsCount - 1
+            const int WorkersCount;
+            const std::string ThreadsName;
+            /// The workers of the attached threads, then the ones of the threads of the pool.
+            Worker * Workers;
+
+            /// Is increased when tasks are pushed for the sleeping threads, or on termination.
+            Utilities::Futex Work;
+            /// Is increased when tasks are pushed or a Pending counter reaches 0, for the sleeping Join calls.
+            Utilities::Futex Done;
+            std::atomic<bool> ShouldTerminate;
+            std::atomic<long long> SpinNanoseconds;
+
+            /// The threads that are sleeping in WorkerProcess, waiting for Work.
+            std::atomic<int> SleepingWorkersCount;
+            /// The threads that are sleeping in Join, waiting for Done.
+            std::atomic<int> SleepingJoinsCount;
+
+            /// Gets the index of the calling thread in the pool, throws if it doesn't belong to the pool.
+            int GetWorkerIndex();
+            /// Pushes the tasks to the calling thread's deque.
+            /// @param ShouldWake Whether to wake the waiting threads to steal the tasks.
+            void PushTasks(Task ** Tasks, int Count, std::atomic<int>& Pending, bool ShouldWake);
+            void WorkerProcess(int Index);
+            /// Pops a task from the worker's inbox or deque or steals one from another worker
+            /// or from the inbox of a busy one, and executes it.
+            /// @return Whether a task was found.
+            bool TryExecuteOne(int Index, unsigned int& Seed);
+            /// Moves the tasks of an inbox to the deque of the worker Index.
+            /// @return The number of the moved tasks, 0 if another thread is draining the inbox.
+            int DrainInbox(int Inbox, int Index);
+            /// Checks whether any of the deques or inboxes has a task that the worker Index can take:
+            /// its own inbox, and the inboxes of the busy workers.
+            bool HasTasks(int Index);
+            /// Spins and then yields until the condition is met or the spin time is over.
+            /// @return Whether the condition is met.
+            template <typename ConditionType>
+            bool SpinUntil(ConditionType Condition);
+            /// Wakes the sleeping threads, after a seq_cst fence with the change that they wait for.
+            /// @param WorkersCount The number of the sleeping workers to wake for the new tasks.
+            void WakeSleeping(int WorkersCount);
+            void ExecuteTask(int Index, Task*);
+        };
+    }
+}
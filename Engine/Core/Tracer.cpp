@@ -0,0 +1,255 @@
+#include "../Engine.h"
+#include <cstdio>
+#include <fstream>
+
+namespace Engine
+{
+    namespace Core
+    {
+        static std::atomic<unsigned long long> TracersCount(0);
+
+        thread_local Tracer::ThreadBuffers Tracer::CurrentThreadBuffers;
+
+        Tracer::Slot::Slot() : Sequence(0), Start(0), Duration(0), Name(nullptr), Number(0), Type(Update) {}
+
+        Tracer::Buffer::Buffer(int Capacity, int ThreadIndex)
+            : Slots(new Slot[Capacity]), Count(0), TakenCount(0), ThreadIndex(ThreadIndex) {}
+
+        Tracer::BufferList::~BufferList()
+        {
+            Buffers.ForEach([](Buffer * buffer) { delete buffer; });
+        }
+
+        void Tracer::BufferList::Recycle(Buffer * buffer)
+        {
+            std::unique_lock<std::mutex> guard(Mutex);
+            // Named by its next thread
+            buffer->ThreadName.clear();
+            FreeBuffers.Add(buffer);
+        }
+
+        Tracer::ThreadBuffers::~ThreadBuffers()
+        {
+            Entries.ForEach([](Entry entry) {
+                if (std::shared_ptr<BufferList> owner = entry.Owner.lock())
+                    owner->Recycle(entry.Item);
+            });
+        }
+
+        Tracer::Tracer(int BufferCapacity) : BufferCapacity(BufferCapacity), Id(++TracersCount),
+                                             Epoch(std::chrono::steady_clock::now()), Buffers(new BufferList())
+        {
+            if (BufferCapacity <= 0)
+                throw std::domain_error("BufferCapacity must be greater than zero.");
+        }
+
+        Tracer::~Tracer() {}
+
+        void Tracer::Record(EventType Type, const std::string * Name, int Number,
+                            std::chrono::time_point<std::chrono::steady_clock> Start,
+                            std::chrono::time_point<std::chrono::steady_clock> End)
+        {
+            Buffer * buffer = GetBuffer();
+            // Only this thread writes to the buffer, the readers check the sequence of the slot
+            long long index = buffer->Count.load(std::memory_order_relaxed);
+            Slot& slot = buffer->Slots[index % BufferCapacity];
+            slot.Sequence.store(2 * index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.Start.store(std::chrono::duration_cast<std::chrono::nanoseconds>(Start - Epoch).count(), std::memory_order_relaxed);
+            slot.Duration.store(std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count(), std::memory_order_relaxed);
+            slot.Name.store(Name, std::memory_order_relaxed);
+            slot.Number.store(Number, std::memory_order_relaxed);
+            slot.Type.store(Type, std::memory_order_relaxed);
+            slot.Sequence.store(2 * index + 2, std::memory_order_release);
+            buffer->Count.store(index + 1, std::memory_order_release);
+        }
+
+        void Tracer::NameThread(const char * Name)
+        {
+            Buffer * buffer = GetBuffer();
+            std::unique_lock<std::mutex> guard(Buffers->Mutex);
+            if (buffer->ThreadName.empty())
+                buffer->ThreadName = Name;
+        }
+
+        static void WriteJsonString(std::ostream& Stream, const std::string& Value)
+        {
+            Stream << '"';
+            for (char c : Value)
+                if (c == '"' || c == '\\')
+                    Stream << '\\' << c;
+                else if ((unsigned char)c < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+                    Stream << escaped;
+                }
+                else
+                    Stream << c;
+            Stream << '"';
+        }
+
+        void Tracer::Write(const std::string& FilePath)
+        {
+            std::ofstream file(FilePath);
+            if (!file)
+                throw std::runtime_error("Cannot open the trace file.");
+
+            static const char * const type_names[] = { "Update", "Schedule", "Chunk", "Barrier", "Add", "Remove" };
+            bool is_first = true;
+            file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+            std::unique_lock<std::mutex> read_guard(ReadMutex);
+            // The buffers are kept until destruction, so they are used after unlocking
+            std::unique_lock<std::mutex> guard(Buffers->Mutex);
+            int buffers_count = Buffers->Buffers.GetCount();
+            std::unique_ptr<Buffer*[]> buffers(new Buffer*[buffers_count]);
+            std::unique_ptr<std::string[]> thread_names(new std::string[buffers_count]);
+            for (int i = 0; i < buffers_count; i++)
+            {
+                buffers[i] = Buffers->Buffers.GetItem(i);
+                thread_names[i] = buffers[i]->ThreadName;
+            }
+            guard.unlock();
+
+            std::unique_ptr<Event[]> events(new Event[BufferCapacity]);
+            for (int b = 0; b < buffers_count; b++)
+            {
+                Buffer * buffer = buffers[b];
+                // The recording threads are not blocked meanwhile
+                int count = TakeEvents(buffer, events.get());
+                const std::string& thread_name = thread_names[b];
+
+                file << (is_first ? "\n" : ",\n");
+                is_first = false;
+                file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->ThreadIndex << ",\"args\":{\"name\":";
+                WriteJsonString(file, thread_name.empty() ? "Thread " + std::to_string(buffer->ThreadIndex) : thread_name);
+                file << "}}";
+
+                for (int i = 0; i < count; i++)
+                {
+                    Event& event = events[i];
+                    std::string name;
+                    switch (event.Type)
+                    {
+                        case Update:
+                            name = *event.Name;
+                            break;
+                        case Chunk:
+                        case Barrier:
+                            name = std::string(type_names[event.Type]) + " " + std::to_string(event.Number);
+                            break;
+                        case Add:
+                        case Remove:
+                            name = std::string(type_names[event.Type]) + " " + *event.Name;
+                            break;
+                        default:
+                            name = type_names[event.Type];
+                            break;
+                    }
+
+                    char times[64];
+                    std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                                  event.Start / 1000.0, event.Duration / 1000.0);
+                    file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadIndex
+                         << ",\"cat\":\"" << type_names[event.Type] << "\",\"name\":";
+                    WriteJsonString(file, name);
+                    file << "," << times << "}";
+                }
+            }
+            file << "\n]}\n";
+
+            if (!file)
+                throw std::runtime_error("Cannot write the trace file.");
+        }
+
+        void Tracer::Clear()
+        {
+            std::unique_lock<std::mutex> read_guard(ReadMutex);
+            std::unique_lock<std::mutex> guard(Buffers->Mutex);
+            Buffers->Buffers.ForEach([](Buffer * buffer) {
+                buffer->TakenCount = buffer->Count.load(std::memory_order_acquire);
+            });
+        }
+
+        int Tracer::TakeEvents(Buffer * buffer, Event * EventsOut)
+        {
+            long long count = buffer->Count.load(std::memory_order_acquire);
+            long long first = std::max(buffer->TakenCount, count - BufferCapacity);
+            int taken = 0;
+            for (long long i = first; i < count; i++)
+            {
+                Slot& slot = buffer->Slots[i % BufferCapacity];
+                Event& event = EventsOut[taken];
+                long long sequence = slot.Sequence.load(std::memory_order_acquire);
+                event.Start = slot.Start.load(std::memory_order_relaxed);
+                event.Duration = slot.Duration.load(std::memory_order_relaxed);
+                event.Name = slot.Name.load(std::memory_order_relaxed);
+                event.Number = slot.Number.load(std::memory_order_relaxed);
+                event.Type = slot.Type.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                // Skipped if it's overwritten by a newer event meanwhile
+                if (sequence == 2 * i + 2 && slot.Sequence.load(std::memory_order_relaxed) == sequence)
+                    taken++;
+            }
+            buffer->TakenCount = count;
+            return taken;
+        }
+
+        Tracer::Buffer * Tracer::GetBuffer()
+        {
+            ThreadBuffers& cache = CurrentThreadBuffers;
+            if (cache.TracerId == Id)
+                return cache.Item;
+
+            Buffer * buffer = nullptr;
+            cache.Entries.ForEach([&](ThreadBuffers::Entry entry, bool& BreakLoop) {
+                if (entry.TracerId == Id)
+                {
+                    buffer = entry.Item;
+                    BreakLoop = true;
+                }
+            });
+            if (buffer == nullptr)
+            {
+                // The entries of the destroyed tracers are dropped
+                for (int i = cache.Entries.GetCount() - 1; i >= 0; i--)
+                    if (cache.Entries.GetItem(i).Owner.expired())
+                        cache.Entries.RemoveByIndex(i);
+
+                std::unique_lock<std::mutex> guard(Buffers->Mutex);
+                int free_count = Buffers->FreeBuffers.GetCount();
+                if (free_count > 0)
+                {
+                    buffer = Buffers->FreeBuffers.GetItem(free_count - 1);
+                    Buffers->FreeBuffers.RemoveByIndex(free_count - 1);
+                }
+                else
+                {
+                    std::unique_ptr<Buffer> created(new Buffer(BufferCapacity, Buffers->Buffers.GetCount() + 1));
+                    Buffers->Buffers.Add(created.get());
+                    buffer = created.release();
+                }
+                guard.unlock();
+
+                ThreadBuffers::Entry entry;
+                entry.TracerId = Id;
+                entry.Owner = Buffers;
+                entry.Item = buffer;
+                try
+                {
+                    cache.Entries.Add(entry);
+                }
+                catch (...)
+                {
+                    Buffers->Recycle(buffer);
+                    throw;
+                }
+            }
+
+            cache.TracerId = Id;
+            cache.Item = buffer;
+            return buffer;
+        }
+    }
+}
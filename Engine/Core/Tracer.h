@@ -0,0 +1,128 @@
+#pragma once
+
+#include "../Engine.dec.h"
+#include "../Utilities/Collections/List.h"
+
+namespace Engine
+{
+    namespace Core
+    {
+        class Tracer final
+        {
+        public:
+            enum EventType : std::int_fast8_t { Update, Schedule, Chunk, Barrier, Add, Remove };
+
+            /// @param BufferCapacity The number of the latest events that are kept for each thread.
+            Tracer(int BufferCapacity = 65536);
+            ~Tracer();
+
+            Tracer(const Tracer&) = delete;
+            Tracer& operator=(const Tracer&) = delete;
+
+            /// @brief Records an event of the calling thread, without locking.
+            ///
+            /// The oldest event of the thread is overwritten if its buffer is full.
+            /// The buffer of a thread is reused by a new thread once the thread exits,
+            /// so their events share a track.
+            /// @param Name The module's name, must be kept alive until the events are written.
+            ///        Can be null for the events that are not about a module.
+            /// @param Number The ExecutionChunk of Chunk and Barrier events.
+            void Record(EventType Type, const std::string * Name, int Number,
+                        std::chrono::time_point<std::chrono::steady_clock> Start,
+                        std::chrono::time_point<std::chrono::steady_clock> End);
+            /// @brief Names the calling thread in the written trace, if it's not named yet.
+            void NameThread(const char * Name);
+
+            /// @brief Writes the recorded events as Chrome Trace Event JSON and clears them.
+            ///
+            /// The file can be opened by chrome://tracing or Perfetto.
+            /// Can be called while other threads are recording.
+            void Write(const std::string& FilePath);
+            /// @brief Clears the recorded events.
+            void Clear();
+        private:
+            struct Event
+            {
+                long long Start; // Nanoseconds since the creation of the tracer
+                long long Duration;
+                const std::string * Name;
+                int Number;
+                EventType Type;
+            };
+
+            /// @brief An event that is written by one thread and read by the others, published by a seqlock.
+            struct Slot
+            {
+                /// 2 * Index + 1 while the event of Index is being written, 2 * Index + 2 once it's written.
+                std::atomic<long long> Sequence;
+                std::atomic<long long> Start;
+                std::atomic<long long> Duration;
+                std::atomic<const std::string*> Name;
+                std::atomic<int> Number;
+                std::atomic<EventType> Type;
+                Slot();
+            };
+
+            struct Buffer
+            {
+                std::unique_ptr<Slot[]> Slots;
+                /// The total number of the recorded events, only increased by the thread of the buffer.
+                std::atomic<long long> Count;
+                /// The number of the events that are written or cleared.
+                /// Only used while holding ReadMutex.
+                long long TakenCount;
+                int ThreadIndex;
+                /// Guarded by BufferList::Mutex.
+                std::string ThreadName;
+                Buffer(int Capacity, int ThreadIndex);
+            };
+
+            /// @brief The buffers, shared with the threads that record to them to be recycled when they exit.
+            struct BufferList
+            {
+                /// Guards Buffers, FreeBuffers and the names of the threads.
+                std::mutex Mutex;
+                /// All the buffers, kept until the tracer is destroyed.
+                Utilities::Collections::List<Buffer*, false> Buffers;
+                /// The buffers of the exited threads.
+                Utilities::Collections::List<Buffer*, false> FreeBuffers;
+                ~BufferList();
+                /// @brief Returns the buffer of an exiting thread.
+                void Recycle(Buffer*);
+            };
+
+            /// @brief The buffers of a thread in the tracers that it has recorded to.
+            struct ThreadBuffers
+            {
+                struct Entry
+                {
+                    unsigned long long TracerId = 0;
+                    std::weak_ptr<BufferList> Owner;
+                    Buffer * Item = nullptr;
+                };
+                /// The buffer of the last tracer that is used by the thread.
+                unsigned long long TracerId = 0;
+                Buffer * Item = nullptr;
+                Utilities::Collections::List<Entry, false> Entries;
+                /// Recycles the buffers of the tracers that are still alive.
+                ~ThreadBuffers();
+            };
+            static thread_local ThreadBuffers CurrentThreadBuffers;
+
+            const int BufferCapacity;
+            /// Distinguishes the tracers in the thread-local buffer caches.
+            const unsigned long long Id;
+            const std::chrono::time_point<std::chrono::steady_clock> Epoch;
+
+            std::shared_ptr<BufferList> Buffers;
+            /// Serializes Write and Clear.
+            std::mutex ReadMutex;
+
+            /// @brief Gets the buffer of the calling thread, takes a free one or creates one if needed.
+            Buffer * GetBuffer();
+            /// @brief Copies the events of a buffer that are not taken yet, and takes them.
+            /// @return The number of the copied events.
+            int TakeEvents(Buffer*, Event * EventsOut);
+        };
+    }
+}
@@ -1,10 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
 #include <shared_mutex>
 #include <stdexcept>
 #include <string>
@@ -13,6 +22,12 @@
 #include <type_traits>
 #include <utility>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    #include <coroutine>
+    /// Is defined when compiled as C++20 or later, which enables Coroutine.
+    #define ENGINE_COROUTINES
+#endif
+
 namespace Engine
 {
     namespace Utilities
@@ -40,6 +55,11 @@ namespace Engine
         ///         can also be controlled by user.
         ///         Else, a private std::shared_mutex will be used.
         template <typename Type, bool AllowManualLocking = false> class Shared;
+        /// @brief Atomic word that threads can wait on until it changes.
+        class Futex;
+        /// @brief Move-only function wrapper that stores small callable objects without heap allocations.
+        /// @tparam BufferSize The size of the inline storage, the larger objects are heap-allocated.
+        template <typename Signature, std::size_t BufferSize = 48> class InlineFunction;
 
         namespace Collections
         {
@@ -52,6 +72,14 @@ namespace Engine
             template <typename ItemsType, bool UseMutex = true> class Queue;
             template <typename ItemsType, typename PriorityType = int, bool LessPriorityFirst = true, bool UseMutex = true> class PriorityQueue;
             template <typename KeyType, typename ValueType, bool UseMutex = true> class Dictionary;
+            /// @brief Lock-free deque that is pushed/popped by its owner thread
+            ///        and stolen from by the other threads.
+            template <typename ItemsType> class WorkStealingDeque;
+            /// @brief Hierarchical timing wheel of intrusive items that are popped by time.
+            template <typename ItemsType> class TimerWheel;
+            /// @brief Lock-free multi-producer single-consumer queue of intrusive items
+            ///        that is drained at once.
+            template <typename ItemsType> class MPSCQueue;
         }
     }
 
@@ -67,13 +95,71 @@ namespace Engine
             /// @brief Are executed inside the loop in separate threads.
             ///        Recommended for normal Modules.
             BoundedAsync = 0,
-            /// @brief Are executed outside the loop in new individual threads.
+            /// @brief Are executed outside the loop in individual threads,
+            ///        which are reused when idle and limited in number.
             ///        Only recommended for long scheduled tasks that sleep a lot,
-            ///        and NOT Modules.
+            ///        and NOT Modules. The update of a module is skipped
+            ///        while its previous update is still running.
             FreeAsync = 1,
         };
+        /// @brief What a recurring scheduled task in a Loop does with the periods it misses.
+        enum RecurrencePolicy : std::int_fast8_t {
+            /// @brief Execute the missed periods one after another as soon as possible.
+            CatchUp = 0,
+            /// @brief Drop the missed periods and wait for the next one.
+            Skip = 1,
+        };
+        /// @brief The time values of a loop update, see Loop::GetClock.
+        struct FrameClock
+        {
+            /// The number of the loop update since the Loop is started, starting from 1.
+            long long Tick = 0;
+            double Time = 0;
+            double TimeDiff = 0;
+            float TimeAsFloat = 0;
+            float TimeDiffAsFloat = 0;
+            double Lag = 0;
+        };
         /// @brief Manages and runs Module objects.
         class Loop;
+        /// @brief Refers to a scheduled call of a Loop to cancel or reschedule it.
+        class ScheduleHandle;
+        /// @brief The shared state of a Future and its Promise.
+        class FutureState;
+        /// @brief Refers to a result that is set later, see Loop::Submit.
+        template <typename T> class Future;
+        /// @brief Sets the result of a Future.
+        template <typename T> class Promise;
+#ifdef ENGINE_COROUTINES
+        /// @brief Recycles the frames of the coroutines.
+        class CoroutineFramePool;
+        /// @brief The base of the promise types of the coroutines.
+        class CoroutinePromise;
+        /// @brief A coroutine that runs on a Loop, see Loop::Spawn.
+        template <typename T = void> class Coroutine;
+        /// @brief Suspends a coroutine until a time of a Loop, see Loop::Delay.
+        class DelayAwaiter;
+        /// @brief Suspends a coroutine until an ExecutionChunk of a Loop, see Loop::NextChunk.
+        class ChunkAwaiter;
+#endif
+        /// @brief Elastic pool of threads that executes the FreeAsync updates and schedules of a Loop.
+        class AsyncExecutor;
+        /// @brief Work-stealing pool of threads that executes the BoundedAsync updates of a Loop.
+        class ThreadPool;
+        /// @brief Runs tasks on the threads of a Loop and waits for them, see also Loop::ParallelFor.
+        class TaskGroup;
+        /// @brief Collects the statistics of a Loop, see Loop::GetStatistics.
+        class Profiler;
+        /// @brief Records the trace events of a Loop in Chrome Trace Event format, see Loop::WriteTrace.
+        class Tracer;
+        /// @brief Counts of durations in power of 2 nanosecond buckets.
+        struct DurationHistogram;
+        /// @brief The statistics of a Module in a Loop.
+        struct ModuleStatistics;
+        /// @brief The statistics of an ExecutionChunk in a Loop.
+        struct ChunkStatistics;
+        /// @brief A snapshot of the statistics of a Loop.
+        struct LoopStatistics;
         /// @brief Abstract class to implement the application's modules.
         ///
         /// Add them to a Loop to run.
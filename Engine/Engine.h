@@ -4,6 +4,8 @@
 #include "Utilities/RecursiveMutex.h"
 #include "Utilities/MutexContained.h"
 #include "Utilities/Shared.h"
+#include "Utilities/Futex.h"
+#include "Utilities/InlineFunction.h"
 
 #include "Utilities/Collections/ResizableArray.h"
 #include "Utilities/Collections/List.h"
@@ -11,6 +13,17 @@
 #include "Utilities/Collections/Queue.h"
 #include "Utilities/Collections/PriorityQueue.h"
 #include "Utilities/Collections/Dictionary.h"
+#include "Utilities/Collections/WorkStealingDeque.h"
+#include "Utilities/Collections/TimerWheel.h"
+#include "Utilities/Collections/MPSCQueue.h"
 
+#include "Core/AsyncExecutor.h"
+#include "Core/ThreadPool.h"
+#include "Core/TaskGroup.h"
+#include "Core/Profiler.h"
+#include "Core/Tracer.h"
+#include "Core/Future.h"
 #include "Core/Loop.h"
+#include "Core/ScheduleHandle.h"
 #include "Core/Module.h"
+#include "Core/Coroutine.h"
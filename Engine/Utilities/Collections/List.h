@@ -35,6 +35,7 @@ namespace Engine
                 typedef std::function<void(ENGINE_LIST_CLASS_NAME * Parent, int& Index, ItemsType& Value)> OnSetItemCallback;
                 typedef std::function<void(ENGINE_LIST_CLASS_NAME * Parent, int& Index)> OnRemoveCallback;
                 typedef std::function<void(ENGINE_LIST_CLASS_NAME * Parent)> OnClearCallback;
+                typedef std::function<void(ENGINE_LIST_CLASS_NAME * Parent, const ItemsType * Items, int& Count)> OnAssignCallback;
                 typedef std::function<bool(ItemsType Item)> Predicate;
                 typedef std::function<void(ItemsType Item)> ForEachBody;
                 typedef std::function<void(ItemsType Item, bool& BreakLoop)> ForEachBodyWithBreakBool;
@@ -51,12 +52,14 @@ namespace Engine
                 /// @param OnSetItem What to do when setting an item
                 /// @param OnRemove What to do on remove
                 /// @param OnClear What to do on clear
+                /// @param OnAssign What to do on assigning many items at once
                 /// @return The list interface
                 List(
                     OnAddCallback OnAdd,
                     OnSetItemCallback OnSetItem,
                     OnRemoveCallback OnRemove,
-                    OnClearCallback OnClear
+                    OnClearCallback OnClear,
+                    OnAssignCallback OnAssign = nullptr
                 );
                 ~List();
 
@@ -90,12 +93,14 @@ namespace Engine
                 /// @param OnSetItem What to do when setting an item
                 /// @param OnRemove What to do on remove
                 /// @param OnClear What to do on clear
+                /// @param OnAssign What to do on assigning many items at once
                 /// @return The created list interface
                 ENGINE_LIST_CLASS_NAME * CreateInterface(
                     OnAddCallback OnAdd = nullptr,
                     OnSetItemCallback OnSetItem = nullptr,
                     OnRemoveCallback OnRemove = nullptr,
-                    OnClearCallback OnClear = nullptr
+                    OnClearCallback OnClear = nullptr,
+                    OnAssignCallback OnAssign = nullptr
                 );
 
                 /// @brief Adds/appends an item to the end of the list by default.
@@ -117,6 +122,9 @@ namespace Engine
                 /// @brief Clears the list's items.
                 ///        Behavior might vary based on the interface that is used to access the list.
                 void Clear();
+                /// @brief Replaces the list's items with an array of items at once.
+                ///        Behavior might vary based on the interface that is used to access the list.
+                void Assign(const ItemsType * Items, int Count);
 
                 /// @brief Expands the allocated memory.
                 /// @param Space the space to add to the allocated memory.
@@ -194,13 +202,15 @@ namespace Engine
                 OnSetItemCallback OnSetItem;
                 OnRemoveCallback OnRemove;
                 OnClearCallback OnClear;
+                OnAssignCallback OnAssign;
                 
                 List(
                     ENGINE_LIST_CLASS_NAME * Parent,
                     OnAddCallback OnAdd,
                     OnSetItemCallback OnSetItem,
                     OnRemoveCallback OnRemove,
-                    OnClearCallback OnClear);
+                    OnClearCallback OnClear,
+                    OnAssignCallback OnAssign);
                 void DestructChildren();
             };
         }
@@ -283,6 +293,21 @@ namespace Engine
                     if (*AutoShrinkRef)
                         ItemsRef->Resize(0);
                 };
+
+                OnAssign = [this](ENGINE_LIST_CLASS_NAME * Parent, const ItemsType * Items, int& Count) {
+                    if (Count < 0)
+                        throw std::domain_error("Count is less than zero.");
+
+                    if (ItemsRef->GetLength() < Count)
+                        ItemsRef->Resize(Count);
+                    for (int i = 0; i < Count; i++)
+                        ItemsRef->SetItem(i, Items[i]);
+                    *CountRef = Count;
+
+                    // Shrinks after copying, the items may be of this list
+                    if (*AutoShrinkRef && *CountRef < ItemsRef->GetLength() / 2)
+                        ItemsRef->Resize(*CountRef);
+                };
             }
 
             template <typename ItemsType>
@@ -290,7 +315,8 @@ namespace Engine
                 OnAddCallback OnAdd,
                 OnSetItemCallback OnSetItem,
                 OnRemoveCallback OnRemove,
-                OnClearCallback OnClear) : IsRoot(false)
+                OnClearCallback OnClear,
+                OnAssignCallback OnAssign) : IsRoot(false)
             {
                 ENGINE_COLLECTION_STRUCTURE_ACCESS;
 
@@ -302,6 +328,8 @@ namespace Engine
                     OnRemove = [](ENGINE_LIST_CLASS_NAME*, int&) { throw std::logic_error("List::Remove interface not implemented"); };
                 if (OnClear == nullptr)
                     OnClear = [](ENGINE_LIST_CLASS_NAME*) { throw std::logic_error("List::Clear interface not implemented"); };
+                if (OnAssign == nullptr)
+                    OnAssign = [](ENGINE_LIST_CLASS_NAME*, const ItemsType*, int&) { throw std::logic_error("List::Assign interface not implemented"); };
 
                 Parent = new ENGINE_LIST_CLASS_NAME();
                 Children = new ResizableArray<ENGINE_LIST_CLASS_NAME*, false>(1);
@@ -317,6 +345,7 @@ namespace Engine
                 this->OnSetItem = OnSetItem;
                 this->OnRemove = OnRemove;
                 this->OnClear = OnClear;
+                this->OnAssign = OnAssign;
             }
 
             template <typename ItemsType>
@@ -395,7 +424,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
                     // No exceptions occured, the list is now complete and ready to swap.
                     std::swap(CountRef, list.CountRef);
@@ -422,7 +451,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
                     // No exceptions occured, the list is now complete and ready to swap.
                     std::swap(CountRef, list.CountRef);
@@ -448,7 +477,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
                     // No exceptions occured, the list is now complete and ready to swap.
                     std::swap(CountRef, list.CountRef);
@@ -475,7 +504,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
                     // No exceptions occured, the list is now complete and ready to swap.
                     std::swap(CountRef, list.CountRef);
@@ -568,7 +597,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     *list.CountRef = *CountRef;
                     *list.ItemsRef = *ItemsRef;
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
@@ -595,7 +624,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     *list.CountRef = *CountRef;
                     *list.ItemsRef = *ItemsRef;
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
@@ -622,7 +651,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     *list.CountRef = *CountRef;
                     *list.ItemsRef = *ItemsRef;
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
@@ -649,7 +678,7 @@ namespace Engine
                 }
                 else
                 {
-                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear);
+                    ENGINE_LIST_CLASS_NAME list(OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
                     *list.CountRef = *CountRef;
                     *list.ItemsRef = *ItemsRef;
                     Op.ForEach([&list](ItemsType Item) { list.Add(Item); });
@@ -667,7 +696,8 @@ namespace Engine
                 OnAddCallback OnAdd,
                 OnSetItemCallback OnSetItem,
                 OnRemoveCallback OnRemove,
-                OnClearCallback OnClear)
+                OnClearCallback OnClear,
+                OnAssignCallback OnAssign)
             {
                 ENGINE_COLLECTION_WRITE_ACCESS;
 
@@ -679,8 +709,10 @@ namespace Engine
                     OnRemove = [](ENGINE_LIST_CLASS_NAME*, int&) { throw std::logic_error("List::Remove interface not implemented"); };
                 if (OnClear == nullptr)
                     OnClear = [](ENGINE_LIST_CLASS_NAME*) { throw std::logic_error("List::Clear interface not implemented"); };
+                if (OnAssign == nullptr)
+                    OnAssign = [](ENGINE_LIST_CLASS_NAME*, const ItemsType*, int&) { throw std::logic_error("List::Assign interface not implemented"); };
 
-                ENGINE_LIST_CLASS_NAME * Child = new ENGINE_LIST_CLASS_NAME(this, OnAdd, OnSetItem, OnRemove, OnClear);
+                ENGINE_LIST_CLASS_NAME * Child = new ENGINE_LIST_CLASS_NAME(this, OnAdd, OnSetItem, OnRemove, OnClear, OnAssign);
 
                 Children->Resize(Children->GetLength() + 1);
                 Children->SetItem(Children->GetLength() - 1, Child);
@@ -745,6 +777,14 @@ namespace Engine
                 OnClear(Parent);
             }
 
+            template <typename ItemsType>
+            void ENGINE_LIST_CLASS_NAME::Assign(const ItemsType * Items, int Count)
+            {
+                ENGINE_COLLECTION_WRITE_ACCESS;
+
+                OnAssign(Parent, Items, Count);
+            }
+
 
 
             template <typename ItemsType>
@@ -905,7 +945,8 @@ namespace Engine
                 OnAddCallback OnAdd,
                 OnSetItemCallback OnSetItem,
                 OnRemoveCallback OnRemove,
-                OnClearCallback OnClear) : IsRoot(false)
+                OnClearCallback OnClear,
+                OnAssignCallback OnAssign) : IsRoot(false)
             {
                 ENGINE_COLLECTION_STRUCTURE_ACCESS
 
@@ -922,6 +963,7 @@ namespace Engine
                 this->OnSetItem = OnSetItem;
                 this->OnRemove = OnRemove;
                 this->OnClear = OnClear;
+                this->OnAssign = OnAssign;
             }
 
             template <typename ItemsType>
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../../Engine.dec.h"
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            class MPSCQueue final
+            {
+            public:
+                /// @brief The base class of the items, links an item to a queue.
+                ///
+                /// Derive ItemsType from MPSCQueue<ItemsType>::Node.
+                class Node
+                {
+                    friend MPSCQueue;
+                public:
+                    Node();
+                private:
+                    Node * QueueNext;
+                };
+
+                MPSCQueue();
+
+                MPSCQueue(const MPSCQueue&) = delete;
+                MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+                /// @brief Pushes an item to the back, lock-free.
+                ///
+                /// Can be called by any thread.
+                void Push(ItemsType * Item);
+                /// @brief Pushes items to the back in their order, lock-free and at once.
+                ///
+                /// Can be called by any thread.
+                void Push(ItemsType ** Items, int Count);
+                /// @brief Pops all the items at once.
+                ///
+                /// Must only be called by one consumer thread at a time.
+                /// @return The first item in the order of pushing, or nullptr if empty.
+                ///         Use GetNext to iterate over the rest.
+                ItemsType * PopAll();
+                /// @brief Gets the item after an item that is popped by PopAll.
+                ///
+                /// Read the next item before pushing the item again.
+                /// @return The next item or nullptr.
+                static ItemsType * GetNext(ItemsType * Item);
+
+                /// @brief Checks whether the queue is empty.
+                ///
+                /// The result may be outdated if other threads are pushing.
+                bool IsEmpty();
+            private:
+                /// The last pushed item, the items are linked in reverse.
+                std::atomic<Node*> Head;
+            };
+        }
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            MPSCQueue<ItemsType>::Node::Node() : QueueNext(nullptr) {}
+
+            template <typename ItemsType>
+            MPSCQueue<ItemsType>::MPSCQueue() : Head(nullptr) {}
+
+            template <typename ItemsType>
+            void MPSCQueue<ItemsType>::Push(ItemsType * Item)
+            {
+                Node * item = Item;
+                Node * head = Head.load(std::memory_order_relaxed);
+                do item->QueueNext = head;
+                while (!Head.compare_exchange_weak(head, item,
+                    std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            template <typename ItemsType>
+            void MPSCQueue<ItemsType>::Push(ItemsType ** Items, int Count)
+            {
+                if (Count <= 0)
+                    return;
+                // Linked in reverse like the single pushes
+                for (int i = Count - 1; i > 0; i--)
+                    static_cast<Node*>(Items[i])->QueueNext = Items[i - 1];
+                Node * first = Items[0];
+                Node * last = Items[Count - 1];
+                Node * head = Head.load(std::memory_order_relaxed);
+                do first->QueueNext = head;
+                while (!Head.compare_exchange_weak(head, last,
+                    std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            template <typename ItemsType>
+            ItemsType * MPSCQueue<ItemsType>::PopAll()
+            {
+                if (Head.load(std::memory_order_relaxed) == nullptr)
+                    return nullptr;
+
+                Node * item = Head.exchange(nullptr, std::memory_order_acquire);
+                // Reverse to the order of pushing
+                Node * first = nullptr;
+                while (item != nullptr)
+                {
+                    Node * next = item->QueueNext;
+                    item->QueueNext = first;
+                    first = item;
+                    item = next;
+                }
+                return static_cast<ItemsType*>(first);
+            }
+
+            template <typename ItemsType>
+            ItemsType * MPSCQueue<ItemsType>::GetNext(ItemsType * Item)
+            {
+                return static_cast<ItemsType*>(static_cast<Node*>(Item)->QueueNext);
+            }
+
+            template <typename ItemsType>
+            bool MPSCQueue<ItemsType>::IsEmpty()
+            {
+                return Head.load(std::memory_order_relaxed) == nullptr;
+            }
+        }
+    }
+}
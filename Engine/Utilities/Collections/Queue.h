@@ -403,7 +403,10 @@ namespace Engine
                 ENGINE_COLLECTION_WRITE_ACCESS;
 
                 if (First == 0 || Count == 0)
+                {
                     ItemsRef->Resize(NewCapacity);
+                    First = 0; // May be out of the new range when empty
+                }
                 else
                 {
                     ResizableArray<ItemsType, false> * PrevItems = ItemsRef;
@@ -0,0 +1,415 @@
+#pragma once
+
+#include "../../Engine.dec.h"
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            class TimerWheel final
+            {
+            public:
+                /// @brief The base class of the items, links an item to a wheel.
+                ///
+                /// Derive ItemsType from TimerWheel<ItemsType>::Node.
+                class Node
+                {
+                    friend TimerWheel;
+                public:
+                    Node();
+                    Node(const Node&) = delete;
+                    Node& operator=(const Node&) = delete;
+                    /// @brief Gets the time that the item is pushed with.
+                    double GetTime();
+                    /// @brief Checks whether the item is in a wheel.
+                    bool IsLinked();
+                private:
+                    double Time;
+                    long long Tick;
+                    Node * Previous;
+                    Node * Next;
+                    bool IsDue;
+                };
+
+                /// @param Resolution The time span of a slot.
+                ///        Smaller values cost more iterations when advancing.
+                TimerWheel(double Resolution = 0.001);
+                /// Unlinks the remaining items without deleting them.
+                ~TimerWheel();
+
+                TimerWheel(const TimerWheel&) = delete;
+                TimerWheel& operator=(const TimerWheel&) = delete;
+
+                /// @brief Inserts an item to be popped at a time, in O(1).
+                void Push(ItemsType * Item, double Time);
+                /// @brief Removes an item from the wheel, in O(1).
+                ///
+                /// Does nothing if the item is not in the wheel.
+                void Remove(ItemsType * Item);
+                /// @brief Pops an item with Item.Time <= Time, if any.
+                ///
+                /// The items are popped in the order of their slots,
+                /// and in the order they are pushed in each slot.
+                /// @return The popped item or nullptr.
+                ItemsType * Pop(double Time);
+                /// @brief Pops any item regardless of its time.
+                /// @return The popped item or nullptr if the wheel is empty.
+                ItemsType * Pop();
+
+                /// @brief Gets a time that is not later than the time of the next item to pop.
+                ///
+                /// The result may be earlier than the actual time of the item,
+                /// by up to the span of level 0.
+                /// @return The time, or infinity if the wheel is empty.
+                double GetNextTime();
+
+                /// @brief Gets the items count.
+                int GetCount();
+                /// @brief Checks whether the wheel is empty.
+                bool IsEmpty();
+            private:
+                static const int Level0Bits = 8;
+                static const int LevelBits = 6;
+                static const int Level0Size = 1 << Level0Bits;
+                static const int LevelSize = 1 << LevelBits;
+                static const int LevelsCount = 4; // Besides level 0
+
+                const double Resolution;
+                /// The slot of this tick is partially popped, the previous ones are done.
+                long long CurrentTick;
+                int Count;
+                int DueCount;
+
+                /// Sentinel nodes of circular lists.
+                Node Level0[Level0Size];
+                Node Levels[LevelsCount][LevelSize];
+                Node Due;
+                /// Set bits of Level0 slots that may not be empty.
+                std::uint64_t Level0Bitmap[Level0Size / 64];
+
+                long long ToTick(double Time);
+                void Link(Node * Head, Node * Item);
+                void Unlink(Node * Item);
+                /// Places an item in a slot based on its tick.
+                void Place(Node * Item);
+                /// Moves the items of the finished ticks to the Due list.
+                void Advance(long long TargetTick);
+                /// Re-places the items of a higher level slot, returns the slot index.
+                int Cascade(int Level, int Index);
+            };
+        }
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+// Hierarchical timing wheel similar to the classic Linux kernel timers:
+// level 0 has a slot per tick, each higher level slot spans a whole lower level,
+// and the slots are cascaded down to level 0 when their span is reached.
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            TimerWheel<ItemsType>::Node::Node() : Time(0), Tick(0), Previous(this), Next(this), IsDue(false) {}
+
+            template <typename ItemsType>
+            double TimerWheel<ItemsType>::Node::GetTime()
+            {
+                return Time;
+            }
+
+            template <typename ItemsType>
+            bool TimerWheel<ItemsType>::Node::IsLinked()
+            {
+                return Next != this;
+            }
+
+            template <typename ItemsType>
+            TimerWheel<ItemsType>::TimerWheel(double Resolution) : Resolution(Resolution), CurrentTick(0), Count(0), DueCount(0)
+            {
+                if (!(Resolution > 0))
+                    throw std::domain_error("Resolution must be greater than zero.");
+                for (int i = 0; i < Level0Size / 64; i++)
+                    Level0Bitmap[i] = 0;
+            }
+
+            template <typename ItemsType>
+            TimerWheel<ItemsType>::~TimerWheel()
+            {
+                while (Pop() != nullptr);
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Push(ItemsType * Item, double Time)
+            {
+                Node * item = Item;
+                if (item->IsLinked())
+                    throw std::logic_error("The item is already in a wheel.");
+                item->Time = Time;
+                item->Tick = ToTick(Time);
+                Place(item);
+                Count++;
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Remove(ItemsType * Item)
+            {
+                Node * item = Item;
+                if (!item->IsLinked())
+                    return;
+                if (item->IsDue)
+                    DueCount--;
+                Unlink(item);
+                Count--;
+            }
+
+            template <typename ItemsType>
+            ItemsType * TimerWheel<ItemsType>::Pop(double Time)
+            {
+                if (Count == 0)
+                    return nullptr;
+
+                if (DueCount == 0)
+                {
+                    long long target = ToTick(Time);
+                    if (target > CurrentTick)
+                        Advance(target);
+                }
+
+                Node * item = nullptr;
+                if (DueCount > 0)
+                {
+                    item = Due.Next;
+                    DueCount--;
+                }
+                else // Check the partially passed slot
+                {
+                    Node * head = &Level0[CurrentTick & (Level0Size - 1)];
+                    for (Node * node = head->Next; node != head; node = node->Next)
+                        if (node->Time <= Time)
+                        {
+                            item = node;
+                            break;
+                        }
+                    if (item == nullptr)
+                        return nullptr;
+                }
+
+                Unlink(item);
+                Count--;
+                return static_cast<ItemsType*>(item);
+            }
+
+            template <typename ItemsType>
+            ItemsType * TimerWheel<ItemsType>::Pop()
+            {
+                if (Count == 0)
+                    return nullptr;
+
+                Node * head = &Due;
+                if (DueCount > 0)
+                    DueCount--;
+                else
+                {
+                    head = nullptr;
+                    for (int i = 0; i < Level0Size && head == nullptr; i++)
+                        if (Level0[i].IsLinked())
+                            head = &Level0[i];
+                    for (int l = 0; l < LevelsCount && head == nullptr; l++)
+                        for (int i = 0; i < LevelSize && head == nullptr; i++)
+                            if (Levels[l][i].IsLinked())
+                                head = &Levels[l][i];
+                }
+
+                Node * item = head->Next;
+                Unlink(item);
+                Count--;
+                return static_cast<ItemsType*>(item);
+            }
+
+            template <typename ItemsType>
+            double TimerWheel<ItemsType>::GetNextTime()
+            {
+                if (Count == 0)
+                    return std::numeric_limits<double>::infinity();
+                if (DueCount > 0)
+                    return -std::numeric_limits<double>::infinity();
+
+                // The partially passed slot has the items of the current tick and the overdue ones
+                int index = (int)(CurrentTick & (Level0Size - 1));
+                Node * head = &Level0[index];
+                if (head->IsLinked())
+                {
+                    double time = std::numeric_limits<double>::infinity();
+                    for (Node * node = head->Next; node != head; node = node->Next)
+                        if (node->Time < time)
+                            time = node->Time;
+                    return time;
+                }
+
+                // The next non-empty slot before the next cascade
+                for (int i = index + 1; i < Level0Size; i++)
+                    if ((Level0Bitmap[i / 64] >> (i % 64)) & 1)
+                        return (double)(CurrentTick + (i - index)) * Resolution;
+
+                // The items of the higher levels and the wrapped level 0 slots are not earlier than the next cascade
+                return (double)(CurrentTick - index + Level0Size) * Resolution;
+            }
+
+            template <typename ItemsType>
+            int TimerWheel<ItemsType>::GetCount()
+            {
+                return Count;
+            }
+
+            template <typename ItemsType>
+            bool TimerWheel<ItemsType>::IsEmpty()
+            {
+                return Count == 0;
+            }
+
+            template <typename ItemsType>
+            long long TimerWheel<ItemsType>::ToTick(double Time)
+            {
+                double tick = std::floor(Time / Resolution);
+                if (!(tick > 0)) // Also handles NaN
+                    return 0;
+                if (tick > 4.0e18)
+                    return (long long)4.0e18;
+                return (long long)tick;
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Link(Node * Head, Node * Item)
+            {
+                Item->Previous = Head->Previous;
+                Item->Next = Head;
+                Head->Previous->Next = Item;
+                Head->Previous = Item;
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Unlink(Node * Item)
+            {
+                Item->Previous->Next = Item->Next;
+                Item->Next->Previous = Item->Previous;
+                Item->Previous = Item;
+                Item->Next = Item;
+                Item->IsDue = false;
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Place(Node * Item)
+            {
+                long long tick = Item->Tick;
+                long long delta = tick - CurrentTick;
+
+                if (delta < Level0Size)
+                {
+                    // Overdue items go to the current slot
+                    int index = (int)((delta < 0 ? CurrentTick : tick) & (Level0Size - 1));
+                    Link(&Level0[index], Item);
+                    Level0Bitmap[index / 64] |= (std::uint64_t)1 << (index % 64);
+                    return;
+                }
+
+                const long long max_delta = ((long long)1 << (Level0Bits + LevelsCount * LevelBits)) - 1;
+                if (delta > max_delta)
+                {
+                    // Too far, placed at the farthest slot and re-placed when cascaded
+                    tick = CurrentTick + max_delta;
+                    delta = max_delta;
+                }
+
+                int level = 0;
+                while (delta >= ((long long)1 << (Level0Bits + (level + 1) * LevelBits)))
+                    level++;
+                int index = (int)((tick >> (Level0Bits + level * LevelBits)) & (LevelSize - 1));
+                Link(&Levels[level][index], Item);
+            }
+
+            template <typename ItemsType>
+            void TimerWheel<ItemsType>::Advance(long long TargetTick)
+            {
+                while (CurrentTick < TargetTick)
+                {
+                    if (Count == DueCount)
+                    {
+                        // Nothing is left in the slots
+                        CurrentTick = TargetTick;
+                        return;
+                    }
+
+                    int index = (int)(CurrentTick & (Level0Size - 1));
+                    Node * head = &Level0[index];
+                    if (head->IsLinked())
+                    {
+                        int moved = 0;
+                        for (Node * node = head->Next; node != head; node = node->Next)
+                        {
+                            node->IsDue = true;
+                            moved++;
+                        }
+                        // Splice the whole slot to the end of Due
+                        Node * first = head->Next;
+                        Node * last = head->Previous;
+                        first->Previous = Due.Previous;
+                        Due.Previous->Next = first;
+                        last->Next = &Due;
+                        Due.Previous = last;
+                        head->Previous = head;
+                        head->Next = head;
+                        DueCount += moved;
+                    }
+                    Level0Bitmap[index / 64] &= ~((std::uint64_t)1 << (index % 64));
+
+                    // Skip the empty slots, up to the next cascade
+                    int i = index + 1;
+                    while (i < Level0Size)
+                    {
+                        std::uint64_t bits = Level0Bitmap[i / 64] >> (i % 64);
+                        if (bits != 0)
+                        {
+                            while ((bits & 1) == 0)
+                            {
+                                bits >>= 1;
+                                i++;
+                            }
+                            break;
+                        }
+                        i = (i / 64 + 1) * 64;
+                    }
+                    long long next = CurrentTick + (i - index);
+                    CurrentTick = next < TargetTick ? next : TargetTick;
+                    if (CurrentTick != next)
+                        return;
+
+                    if ((CurrentTick & (Level0Size - 1)) == 0)
+                        for (int level = 0; level < LevelsCount; level++)
+                            if (Cascade(level, (int)((CurrentTick >> (Level0Bits + level * LevelBits)) & (LevelSize - 1))) != 0)
+                                break;
+                }
+            }
+
+            template <typename ItemsType>
+            int TimerWheel<ItemsType>::Cascade(int Level, int Index)
+            {
+                Node * head = &Levels[Level][Index];
+                while (head->IsLinked())
+                {
+                    Node * item = head->Next;
+                    Unlink(item);
+                    Place(item);
+                }
+                return Index;
+            }
+        }
+    }
+}
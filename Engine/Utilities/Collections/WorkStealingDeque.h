@@ -0,0 +1,218 @@
+#pragma once
+
+#include "../../Engine.dec.h"
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            class WorkStealingDeque final
+            {
+                static_assert(
+                    std::is_trivially_copyable<ItemsType>::value,
+                    "WorkStealingDeque items must be trivially copyable."
+                );
+            public:
+                WorkStealingDeque(int InitialCapacity = 64);
+                ~WorkStealingDeque();
+
+                WorkStealingDeque(const WorkStealingDeque&) = delete;
+                WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+                /// @brief Pushes an item to the bottom.
+                ///
+                /// Must only be called by the owner thread.
+                void Push(ItemsType Item);
+                /// @brief Pops the bottom item, the last pushed one.
+                ///
+                /// Must only be called by the owner thread.
+                /// @param ItemOut The popped item, if any.
+                /// @return Whether there was an item to pop.
+                bool Pop(ItemsType& ItemOut);
+                /// @brief Steals the top item, the first pushed one.
+                ///
+                /// Can be called by any thread.
+                /// @param ItemOut The stolen item, if any.
+                /// @return Whether there was an item to steal.
+                bool Steal(ItemsType& ItemOut);
+
+                /// @brief Checks whether the deque is empty.
+                ///
+                /// The result may be outdated when used by a thread other than the owner.
+                bool IsEmpty();
+                /// @brief Gets the items count.
+                ///
+                /// The result may be outdated when used by a thread other than the owner.
+                int GetCount();
+            private:
+                struct Buffer
+                {
+                    long long Capacity;
+                    std::atomic<ItemsType> * Items;
+                    /// Kept until destruction, a thief may still be reading it.
+                    Buffer * Previous;
+
+                    Buffer(long long Capacity, Buffer * Previous);
+                    ~Buffer();
+                    ItemsType Get(long long Index);
+                    void Set(long long Index, ItemsType Item);
+                };
+
+                alignas(64) std::atomic<long long> Top;
+                alignas(64) std::atomic<long long> Bottom;
+                std::atomic<Buffer*> ItemsRef;
+
+                Buffer * Grow(Buffer * Current, long long Top, long long Bottom);
+            };
+        }
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+// Chase-Lev deque, using the memory orderings by Le, Pop, Cohen and Nardelli:
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (2013).
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        namespace Collections
+        {
+            template <typename ItemsType>
+            WorkStealingDeque<ItemsType>::WorkStealingDeque(int InitialCapacity) : Top(0), Bottom(0)
+            {
+                long long Capacity = 1;
+                while (Capacity < InitialCapacity)
+                    Capacity *= 2;
+                ItemsRef.store(new Buffer(Capacity, nullptr), std::memory_order_relaxed);
+            }
+
+            template <typename ItemsType>
+            WorkStealingDeque<ItemsType>::~WorkStealingDeque()
+            {
+                Buffer * buffer = ItemsRef.load(std::memory_order_relaxed);
+                while (buffer != nullptr)
+                {
+                    Buffer * previous = buffer->Previous;
+                    delete buffer;
+                    buffer = previous;
+                }
+            }
+
+            template <typename ItemsType>
+            void WorkStealingDeque<ItemsType>::Push(ItemsType Item)
+            {
+                long long b = Bottom.load(std::memory_order_relaxed);
+                long long t = Top.load(std::memory_order_acquire);
+                Buffer * buffer = ItemsRef.load(std::memory_order_relaxed);
+
+                if (b - t > buffer->Capacity - 1)
+                    buffer = Grow(buffer, t, b);
+
+                buffer->Set(b, Item);
+                Bottom.store(b + 1, std::memory_order_release);
+            }
+
+            template <typename ItemsType>
+            bool WorkStealingDeque<ItemsType>::Pop(ItemsType& ItemOut)
+            {
+                long long b = Bottom.load(std::memory_order_relaxed) - 1;
+                Buffer * buffer = ItemsRef.load(std::memory_order_relaxed);
+                Bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                long long t = Top.load(std::memory_order_relaxed);
+
+                if (t > b) // Empty
+                {
+                    Bottom.store(b + 1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                ItemOut = buffer->Get(b);
+                if (t == b) // The last item, race against the thieves
+                {
+                    bool won = Top.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed);
+                    Bottom.store(b + 1, std::memory_order_relaxed);
+                    return won;
+                }
+                return true;
+            }
+
+            template <typename ItemsType>
+            bool WorkStealingDeque<ItemsType>::Steal(ItemsType& ItemOut)
+            {
+                while (true)
+                {
+                    long long t = Top.load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    long long b = Bottom.load(std::memory_order_acquire);
+
+                    if (t >= b)
+                        return false;
+
+                    Buffer * buffer = ItemsRef.load(std::memory_order_acquire);
+                    ItemsType item = buffer->Get(t);
+                    if (Top.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                    {
+                        ItemOut = item;
+                        return true;
+                    }
+                    // Lost the race to another thief or the owner, try again
+                }
+            }
+
+            template <typename ItemsType>
+            bool WorkStealingDeque<ItemsType>::IsEmpty()
+            {
+                return GetCount() == 0;
+            }
+
+            template <typename ItemsType>
+            int WorkStealingDeque<ItemsType>::GetCount()
+            {
+                long long b = Bottom.load(std::memory_order_relaxed);
+                long long t = Top.load(std::memory_order_relaxed);
+                return b > t ? (int)(b - t) : 0;
+            }
+
+            template <typename ItemsType>
+            typename WorkStealingDeque<ItemsType>::Buffer *
+            WorkStealingDeque<ItemsType>::Grow(Buffer * Current, long long Top, long long Bottom)
+            {
+                Buffer * buffer = new Buffer(Current->Capacity * 2, Current);
+                for (long long i = Top; i < Bottom; i++)
+                    buffer->Set(i, Current->Get(i));
+                ItemsRef.store(buffer, std::memory_order_release);
+                return buffer;
+            }
+
+            template <typename ItemsType>
+            WorkStealingDeque<ItemsType>::Buffer::Buffer(long long Capacity, Buffer * Previous)
+                : Capacity(Capacity), Items(new std::atomic<ItemsType>[Capacity]), Previous(Previous) {}
+
+            template <typename ItemsType>
+            WorkStealingDeque<ItemsType>::Buffer::~Buffer()
+            {
+                delete[] Items;
+            }
+
+            template <typename ItemsType>
+            ItemsType WorkStealingDeque<ItemsType>::Buffer::Get(long long Index)
+            {
+                return Items[Index & (Capacity - 1)].load(std::memory_order_relaxed);
+            }
+
+            template <typename ItemsType>
+            void WorkStealingDeque<ItemsType>::Buffer::Set(long long Index, ItemsType Item)
+            {
+                Items[Index & (Capacity - 1)].store(Item, std::memory_order_relaxed);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include "../Engine.h"
+#ifdef __linux__
+    #include <climits>
+    #include <ctime>
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        Futex::Futex(std::uint32_t Value) : Value(Value), WaitersCount(0) {}
+
+        void Futex::Wait(std::uint32_t Expected)
+        {
+            WaitersCount.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+            if (Value.load(std::memory_order_seq_cst) == Expected)
+                syscall(SYS_futex, (std::uint32_t*)&Value, FUTEX_WAIT_PRIVATE, Expected, nullptr, nullptr, 0);
+#else
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                Condition.wait(guard, [&]() { return Value.load(std::memory_order_seq_cst) != Expected; });
+            }
+#endif
+            WaitersCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool Futex::WaitUntil(std::uint32_t Expected, std::chrono::time_point<std::chrono::steady_clock> Deadline)
+        {
+            if (std::chrono::steady_clock::now() >= Deadline)
+                return false;
+
+            WaitersCount.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+            if (Value.load(std::memory_order_seq_cst) == Expected)
+            {
+                // steady_clock is CLOCK_MONOTONIC on Linux, which FUTEX_WAIT_BITSET uses for absolute timeouts
+                long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Deadline.time_since_epoch()).count();
+                timespec deadline;
+                deadline.tv_sec = (time_t)(nanoseconds / 1000000000);
+                deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+                syscall(SYS_futex, (std::uint32_t*)&Value, FUTEX_WAIT_BITSET_PRIVATE, Expected, &deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+            }
+#else
+            {
+                std::unique_lock<std::mutex> guard(Mutex);
+                Condition.wait_until(guard, Deadline, [&]() { return Value.load(std::memory_order_seq_cst) != Expected; });
+            }
+#endif
+            WaitersCount.fetch_sub(1, std::memory_order_relaxed);
+            return std::chrono::steady_clock::now() < Deadline;
+        }
+
+        void Futex::WakeOne()
+        {
+            Wake(1);
+        }
+
+        void Futex::WakeAll()
+        {
+            Wake(std::numeric_limits<int>::max());
+        }
+
+        void Futex::IncreaseAndWakeAll()
+        {
+            Value.fetch_add(1, std::memory_order_seq_cst);
+            Wake(std::numeric_limits<int>::max());
+        }
+
+        void Futex::IncreaseAndWake(int Count)
+        {
+            Value.fetch_add(1, std::memory_order_seq_cst);
+            Wake(Count);
+        }
+
+        void Futex::Wake(int Count)
+        {
+            // Either the waiter is counted here, or it sees the changed Value before blocking
+            if (WaitersCount.load(std::memory_order_seq_cst) == 0)
+                return;
+#ifdef __linux__
+            syscall(SYS_futex, (std::uint32_t*)&Value, FUTEX_WAKE_PRIVATE, Count, nullptr, nullptr, 0);
+#else
+            // Synchronize with a waiter that is between checking Value and blocking
+            std::unique_lock<std::mutex> guard(Mutex);
+            guard.unlock();
+            if (Count > 1)
+                Condition.notify_all();
+            else
+                Condition.notify_one();
+#endif
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../Engine.dec.h"
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        class Futex final
+        {
+        public:
+            /// @brief The word that is waited on.
+            ///
+            /// Change it before waking the waiting threads.
+            std::atomic<std::uint32_t> Value;
+
+            Futex(std::uint32_t Value = 0);
+
+            Futex(const Futex&) = delete;
+            Futex& operator=(const Futex&) = delete;
+
+            /// @brief Blocks while Value equals Expected.
+            ///
+            /// May also return spuriously, check the condition again after returning.
+            void Wait(std::uint32_t Expected);
+            /// @brief Blocks while Value equals Expected, until the deadline.
+            ///
+            /// May also return spuriously, check the condition again after returning.
+            /// @return False if the deadline is reached.
+            bool WaitUntil(std::uint32_t Expected, std::chrono::time_point<std::chrono::steady_clock> Deadline);
+            /// @brief Wakes a thread that is waiting, if any.
+            void WakeOne();
+            /// @brief Wakes all the threads that are waiting.
+            void WakeAll();
+            /// @brief Increases Value and wakes all the threads that are waiting.
+            void IncreaseAndWakeAll();
+            /// @brief Increases Value and wakes up to Count of the threads that are waiting.
+            ///
+            /// The threads that are not woken keep waiting until the next wake.
+            void IncreaseAndWake(int Count);
+        private:
+            /// Lets the wakers skip the system call when nobody waits.
+            std::atomic<int> WaitersCount;
+#ifndef __linux__
+            std::mutex Mutex;
+            std::condition_variable Condition;
+#endif
+            void Wake(int Count);
+        };
+    }
+}
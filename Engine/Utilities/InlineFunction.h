@@ -0,0 +1,245 @@
+#pragma once
+
+#include "../Engine.dec.h"
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        template <typename ReturnType, typename... ArgumentTypes, std::size_t BufferSize>
+        class InlineFunction<ReturnType(ArgumentTypes...), BufferSize> final
+        {
+        public:
+            /// @brief Creates an empty function.
+            InlineFunction() noexcept;
+            /// @brief Creates an empty function.
+            InlineFunction(std::nullptr_t) noexcept;
+            /// @brief Stores a callable object, inside the buffer if it fits.
+            ///
+            /// Null function pointers and empty std::function objects result in an empty function.
+            template <typename FunctionType, typename = typename std::enable_if<
+                !std::is_same<typename std::decay<FunctionType>::type, InlineFunction>::value
+                && std::is_invocable_r<ReturnType, typename std::decay<FunctionType>::type&, ArgumentTypes...>::value
+            >::type>
+            InlineFunction(FunctionType&& Function);
+            InlineFunction(InlineFunction&&) noexcept;
+            ~InlineFunction();
+
+            InlineFunction(const InlineFunction&) = delete;
+            InlineFunction& operator=(const InlineFunction&) = delete;
+
+            InlineFunction& operator=(InlineFunction&&) noexcept;
+            /// @brief Destroys the stored object, if any.
+            InlineFunction& operator=(std::nullptr_t) noexcept;
+
+            /// @brief Calls the stored object.
+            ///
+            /// Throws std::bad_function_call if empty.
+            ReturnType operator()(ArgumentTypes... Arguments);
+
+            explicit operator bool() const noexcept;
+            bool operator==(std::nullptr_t) const noexcept;
+            bool operator!=(std::nullptr_t) const noexcept;
+
+            /// @brief Checks whether a callable type is stored without a heap allocation.
+            template <typename FunctionType>
+            static constexpr bool IsStoredInline()
+            {
+                return sizeof(FunctionType) <= BufferSize
+                    && alignof(FunctionType) <= alignof(std::max_align_t)
+                    && std::is_nothrow_move_constructible<FunctionType>::value;
+            }
+        private:
+            enum OperationType : std::int_fast8_t { Move, Destroy };
+
+            /// The stored object, or a pointer to it if it doesn't fit.
+            alignas(std::max_align_t) unsigned char Buffer[BufferSize < sizeof(void*) ? sizeof(void*) : BufferSize];
+            /// Both are null while empty.
+            ReturnType (*Invoker)(void * Buffer, ArgumentTypes&&... Arguments);
+            /// Moves the object to another buffer and destroys the source, or only destroys it.
+            void (*Manager)(OperationType, void * Source, void * Destination);
+
+            template <typename FunctionType>
+            static ReturnType InvokeInline(void * Buffer, ArgumentTypes&&... Arguments);
+            template <typename FunctionType>
+            static ReturnType InvokeAllocated(void * Buffer, ArgumentTypes&&... Arguments);
+            template <typename FunctionType>
+            static void ManageInline(OperationType, void * Source, void * Destination);
+            template <typename FunctionType>
+            static void ManageAllocated(OperationType, void * Source, void * Destination);
+
+            template <typename FunctionType>
+            static bool IsNull(const FunctionType&);
+            template <typename FunctionType>
+            static bool IsNull(FunctionType * Function);
+            template <typename Signature>
+            static bool IsNull(const std::function<Signature>& Function);
+        };
+    }
+}
+
+// DEFINITION ----------------------------------------------------------------
+
+#define ENGINE_INLINE_FUNCTION_TEMPLATE \
+    template <typename ReturnType, typename... ArgumentTypes, std::size_t BufferSize>
+#define ENGINE_INLINE_FUNCTION_CLASS_NAME \
+    InlineFunction<ReturnType(ArgumentTypes...), BufferSize>
+
+namespace Engine
+{
+    namespace Utilities
+    {
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::InlineFunction() noexcept : Invoker(nullptr), Manager(nullptr) {}
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::InlineFunction(std::nullptr_t) noexcept : Invoker(nullptr), Manager(nullptr) {}
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType, typename>
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::InlineFunction(FunctionType&& Function) : Invoker(nullptr), Manager(nullptr)
+        {
+            typedef typename std::decay<FunctionType>::type StoredType;
+            if (IsNull(Function))
+                return;
+            if constexpr (IsStoredInline<StoredType>())
+            {
+                new (Buffer) StoredType(std::forward<FunctionType>(Function));
+                Invoker = &InvokeInline<StoredType>;
+                Manager = &ManageInline<StoredType>;
+            }
+            else
+            {
+                *reinterpret_cast<StoredType**>(Buffer) = new StoredType(std::forward<FunctionType>(Function));
+                Invoker = &InvokeAllocated<StoredType>;
+                Manager = &ManageAllocated<StoredType>;
+            }
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::InlineFunction(InlineFunction&& Op) noexcept : Invoker(Op.Invoker), Manager(Op.Manager)
+        {
+            if (Manager != nullptr)
+                Manager(Move, Op.Buffer, Buffer);
+            Op.Invoker = nullptr;
+            Op.Manager = nullptr;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::~InlineFunction()
+        {
+            if (Manager != nullptr)
+                Manager(Destroy, Buffer, nullptr);
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME& ENGINE_INLINE_FUNCTION_CLASS_NAME::operator=(InlineFunction&& Op) noexcept
+        {
+            if (this == &Op)
+                return *this;
+            *this = nullptr;
+            if (Op.Manager != nullptr)
+                Op.Manager(Move, Op.Buffer, Buffer);
+            Invoker = Op.Invoker;
+            Manager = Op.Manager;
+            Op.Invoker = nullptr;
+            Op.Manager = nullptr;
+            return *this;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME& ENGINE_INLINE_FUNCTION_CLASS_NAME::operator=(std::nullptr_t) noexcept
+        {
+            if (Manager != nullptr)
+                Manager(Destroy, Buffer, nullptr);
+            Invoker = nullptr;
+            Manager = nullptr;
+            return *this;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ReturnType ENGINE_INLINE_FUNCTION_CLASS_NAME::operator()(ArgumentTypes... Arguments)
+        {
+            if (Invoker == nullptr)
+                throw std::bad_function_call();
+            return Invoker(Buffer, std::forward<ArgumentTypes>(Arguments)...);
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        ENGINE_INLINE_FUNCTION_CLASS_NAME::operator bool() const noexcept
+        {
+            return Invoker != nullptr;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        bool ENGINE_INLINE_FUNCTION_CLASS_NAME::operator==(std::nullptr_t) const noexcept
+        {
+            return Invoker == nullptr;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        bool ENGINE_INLINE_FUNCTION_CLASS_NAME::operator!=(std::nullptr_t) const noexcept
+        {
+            return Invoker != nullptr;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        ReturnType ENGINE_INLINE_FUNCTION_CLASS_NAME::InvokeInline(void * Buffer, ArgumentTypes&&... Arguments)
+        {
+            return std::invoke(*static_cast<FunctionType*>(Buffer), std::forward<ArgumentTypes>(Arguments)...);
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        ReturnType ENGINE_INLINE_FUNCTION_CLASS_NAME::InvokeAllocated(void * Buffer, ArgumentTypes&&... Arguments)
+        {
+            return std::invoke(**static_cast<FunctionType**>(Buffer), std::forward<ArgumentTypes>(Arguments)...);
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        void ENGINE_INLINE_FUNCTION_CLASS_NAME::ManageInline(OperationType Operation, void * Source, void * Destination)
+        {
+            FunctionType * source = static_cast<FunctionType*>(Source);
+            if (Operation == Move)
+                new (Destination) FunctionType(std::move(*source));
+            source->~FunctionType();
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        void ENGINE_INLINE_FUNCTION_CLASS_NAME::ManageAllocated(OperationType Operation, void * Source, void * Destination)
+        {
+            // Only the pointer is moved
+            if (Operation == Move)
+                *static_cast<FunctionType**>(Destination) = *static_cast<FunctionType**>(Source);
+            else
+                delete *static_cast<FunctionType**>(Source);
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        bool ENGINE_INLINE_FUNCTION_CLASS_NAME::IsNull(const FunctionType&)
+        {
+            return false;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename FunctionType>
+        bool ENGINE_INLINE_FUNCTION_CLASS_NAME::IsNull(FunctionType * Function)
+        {
+            return Function == nullptr;
+        }
+
+        ENGINE_INLINE_FUNCTION_TEMPLATE
+        template <typename Signature>
+        bool ENGINE_INLINE_FUNCTION_CLASS_NAME::IsNull(const std::function<Signature>& Function)
+        {
+            return !Function;
+        }
+    }
+}
+
+#undef ENGINE_INLINE_FUNCTION_TEMPLATE
+#undef ENGINE_INLINE_FUNCTION_CLASS_NAME
@@ -0,0 +1,186 @@
+#include "../../Engine/Engine.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+#define print(content) (std::cout << content << '\n')
+#define check(condition) (print(((condition) ? "Passed: " : "FAILED: ") << #condition))
+
+// Counts the heap allocations of the calling thread and of all the threads
+thread_local long long thread_allocations = 0;
+std::atomic<long long> total_allocations(0);
+
+void * operator new(std::size_t Size)
+{
+    thread_allocations++;
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * pointer = std::malloc(Size == 0 ? 1 : Size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * Pointer) noexcept
+{
+    std::free(Pointer);
+}
+
+void operator delete(void * Pointer, std::size_t) noexcept
+{
+    std::free(Pointer);
+}
+
+class IdleModule : public Engine::Core::Module
+{
+public:
+    IdleModule() : Module(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override {}
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Idle";
+    }
+};
+
+/// A capture of 40 bytes, which fits the inline buffer of the tasks.
+struct Payload
+{
+    std::atomic<int> * Executed;
+    long long Data[4];
+};
+
+const int Count = 10000;
+std::atomic<int> executed(0);
+
+/// Prints the allocations per call of the submitting thread and of all the threads until the calls are executed.
+void Report(const char * Name, long long Submitted, long long Total, std::chrono::steady_clock::duration Duration)
+{
+    double nanoseconds = std::chrono::duration<double, std::nano>(Duration).count() / Count;
+    print(Name << ": "
+        << (double)Submitted / Count << " allocations per call when submitting, "
+        << (double)Total / Count << " in total until executed, "
+        << nanoseconds << " ns per call");
+}
+
+template <typename SubmitType>
+long long Measure(const char * Name, SubmitType Submit)
+{
+    executed = 0;
+    long long thread_count = thread_allocations;
+    long long total_count = total_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    Submit();
+    auto duration = std::chrono::steady_clock::now() - start;
+    long long submitted = thread_allocations - thread_count;
+    while (executed.load() < Count)
+        std::this_thread::yield();
+    Report(Name, submitted, total_allocations.load() - total_count, duration);
+    return submitted;
+}
+
+int main()
+{
+    IdleModule idle, other;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.Modules.Add(&other);
+    loop.SetTickRate(1000);
+    std::thread runner([&loop]() { loop.Run(); });
+    while (!loop.IsRunning())
+        std::this_thread::yield();
+
+    Payload payload = { &executed, { 1, 2, 3, 4 } };
+    Engine::Core::ScheduleHandle * handles = new Engine::Core::ScheduleHandle[Count];
+    Engine::Core::Loop::ScheduleItem * items = new Engine::Core::Loop::ScheduleItem[Count];
+    Engine::Core::Future<int> * futures = new Engine::Core::Future<int>[Count];
+    long long schedule = 0, schedule_handle = 0, schedule_batch = 0, submit = 0, task_group = 0, module_edits = 0;
+
+    // The first round warms up the pool threads and recycles the jobs and the buffers for the second one
+    for (int round = 1; round <= 2; round++)
+    {
+        print("");
+        print("Round " << round << (round == 1 ? " (warm-up)" : ""));
+
+        schedule = Measure("Schedule", [&]() {
+            for (int i = 0; i < Count; i++)
+                loop.Schedule([payload]() { (*payload.Executed)++; });
+        });
+
+        schedule_handle = Measure("Schedule, keeping the handles", [&]() {
+            for (int i = 0; i < Count; i++)
+                handles[i] = loop.Schedule([payload]() { (*payload.Executed)++; });
+        });
+
+        for (int i = 0; i < Count; i++)
+            items[i].Task = [payload]() { (*payload.Executed)++; };
+        schedule_batch = Measure("ScheduleBatch", [&]() {
+            loop.ScheduleBatch(items, Count, handles);
+        });
+
+        submit = Measure("Submit", [&]() {
+            for (int i = 0; i < Count; i++)
+                futures[i] = loop.Submit([payload]() { return ++*payload.Executed; });
+        });
+
+        // Measured on a thread of the loop, where the tasks run on the pool
+        Engine::Core::Future<long long> measured = loop.Submit([payload]() {
+            Engine::Core::TaskGroup group;
+            long long count = thread_allocations;
+            for (int i = 0; i < Count; i++)
+                group.Run([payload]() { (*payload.Executed)++; });
+            count = thread_allocations - count;
+            group.Wait();
+            return count;
+        });
+        while (!measured.IsReady())
+            std::this_thread::yield();
+        task_group = measured.Get();
+        print("TaskGroup::Run: " << (double)task_group / Count << " allocations per call");
+
+        // Each edit waits for the loop to apply it, the applied batches of edits are reused
+        auto wait_ticks = [&loop](long long Count) {
+            long long tick = loop.GetClock().Tick;
+            while (loop.GetClock().Tick < tick + Count)
+                std::this_thread::yield();
+        };
+        module_edits = thread_allocations;
+        for (int i = 0; i < 100; i++)
+        {
+            loop.Modules.Remove(&other);
+            wait_ticks(2);
+            loop.Modules.Add(&other);
+            wait_ticks(2);
+        }
+        module_edits = thread_allocations - module_edits;
+        print("Modules.Remove and Modules.Add: " << (double)module_edits / 200 << " allocations per call");
+
+        // Releases the jobs of the handles
+        for (int i = 0; i < Count; i++)
+            handles[i] = Engine::Core::ScheduleHandle();
+    }
+    delete[] items;
+    delete[] handles;
+    delete[] futures;
+
+    print("");
+    // The jobs and the tasks are recycled
+    check(schedule == 0);
+    check(schedule_handle == 0);
+    check(schedule_batch == 0);
+    check(task_group == 0);
+    check(module_edits == 0);
+    // Only the shared state of the future
+    check(submit == Count);
+
+    loop.Stop();
+    runner.join();
+
+    return 0;
+}
@@ -1,9 +1,20 @@
 #include "../../Engine/Engine.h"
 #include <iostream>
 #include <string>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
 
 #define print(context) (std::cout << context << '\n')
 #define input(var) (std::cin >> var)
+#define check(condition) (print(((condition) ? "Passed: " : "FAILED: ") << #condition))
 
 class QuitException {};
 class UnknownException {};
@@ -14,6 +25,22 @@ class KnownException : public std::runtime_error
 
 bool should_quit = false;
 void Prompt(Engine::Core::Loop&);
+void TestScheduleHandles();
+void TestPreferredThreads();
+void TestFreeAsync();
+void TestStatistics();
+void TestTracer();
+void TestModuleChanges();
+void TestDependencyGraph();
+void TestIdleWake();
+void TestPacing();
+void TestDispatchTable();
+void TestFutures();
+void TestSharedPool();
+void TestSpinTime();
+void TestChunkTransitions();
+void TestModuleControl();
+void TestClock();
 
 class PromptModule : public Engine::Core::Module
 {
@@ -151,6 +178,23 @@ void Prompt(Engine::Core::Loop& loop)
     print("");
     print("f => Loop.Modules.ForEach([](Item) { print(Item.GetName()); })");
     print("");
+    print("hnd => Run the ScheduleHandle checks on a separate Loop");
+    print("pin => Run the preferred thread checks on a separate ThreadPool");
+    print("fas => Run the FreeAsync checks on a separate Loop");
+    print("sta => Run the statistics checks on a separate Loop");
+    print("trc => Run the Tracer checks");
+    print("mod => Run the module start and stop checks on a separate Loop");
+    print("grf => Run the dependency graph checks on a separate Loop");
+    print("idl => Run the idle wakeup checks on a separate Loop");
+    print("pac => Run the pacing checks on a separate Loop");
+    print("dsp => Run the dispatch table checks on a separate Loop");
+    print("fut => Run the future checks on a separate Loop");
+    print("shp => Run the shared ThreadPool checks on separate Loops");
+    print("spn => Run the spin time checks on a separate ThreadPool");
+    print("wak => Run the chunk transition checks on a separate Loop");
+    print("ctl => Run the module state checks on a separate Loop");
+    print("clk => Run the clock checks on a separate Loop");
+    print("");
     print("s => Loop.Run()");
     print("e => Loop.Stop()");
     print("");
@@ -261,6 +305,70 @@ void Prompt(Engine::Core::Loop& loop)
         {
             loop.Modules.ForEach([](Engine::Core::Module * Item) { print(Item->GetName()); });
         }
+        else if (option == "hnd")
+        {
+            TestScheduleHandles();
+        }
+        else if (option == "pin")
+        {
+            TestPreferredThreads();
+        }
+        else if (option == "fas")
+        {
+            TestFreeAsync();
+        }
+        else if (option == "sta")
+        {
+            TestStatistics();
+        }
+        else if (option == "trc")
+        {
+            TestTracer();
+        }
+        else if (option == "mod")
+        {
+            TestModuleChanges();
+        }
+        else if (option == "grf")
+        {
+            TestDependencyGraph();
+        }
+        else if (option == "idl")
+        {
+            TestIdleWake();
+        }
+        else if (option == "pac")
+        {
+            TestPacing();
+        }
+        else if (option == "dsp")
+        {
+            TestDispatchTable();
+        }
+        else if (option == "fut")
+        {
+            TestFutures();
+        }
+        else if (option == "shp")
+        {
+            TestSharedPool();
+        }
+        else if (option == "spn")
+        {
+            TestSpinTime();
+        }
+        else if (option == "wak")
+        {
+            TestChunkTransitions();
+        }
+        else if (option == "ctl")
+        {
+            TestModuleControl();
+        }
+        else if (option == "clk")
+        {
+            TestClock();
+        }
         else if (option == "s")
         {
             loop.Run();
@@ -278,6 +386,1621 @@ void Prompt(Engine::Core::Loop& loop)
     catch (std::exception& e) { print("Exception: " << e.what()); }
 }
 
+class IdleModule : public Engine::Core::Module
+{
+public:
+    IdleModule() : Module(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override {}
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Idle";
+    }
+};
+
+/// Sets a flag when the last copy of a capture is destroyed.
+class ReleaseFlag
+{
+public:
+    std::atomic<bool> * Released;
+
+    ReleaseFlag(std::atomic<bool> * Released) : Released(Released) {}
+    ~ReleaseFlag() { *Released = true; }
+};
+
+void TestScheduleHandles()
+{
+    IdleModule idle;
+    Engine::Core::Loop loop;
+    // The loop doesn't run without modules
+    loop.Modules.Add(&idle);
+    loop.SetTickRate(1000);
+    auto start = std::chrono::steady_clock::now();
+    // Not earlier than the time of the loop, which starts after this thread
+    auto now = [start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto sleep = [](double Seconds) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+    };
+    std::thread runner([&loop]() { loop.Run(); });
+    while (!loop.IsRunning())
+        std::this_thread::yield();
+
+    try
+    {
+        print("");
+        print("Cancel before the due time releases the capture at once");
+        {
+            std::atomic<bool> executed(false), released(false);
+            auto capture = std::make_shared<ReleaseFlag>(&released);
+            Engine::Core::ScheduleHandle handle = loop.Schedule(now() + 0.3, [capture, &executed]() { executed = true; });
+            capture.reset();
+            check(handle.IsPending());
+            check(!released);
+            check(handle.Cancel());
+            check(released);
+            check(!handle.IsPending());
+            check(!handle.Cancel());
+            check(!handle.Reschedule(now()));
+            sleep(0.5);
+            check(!executed);
+        }
+
+        print("");
+        print("Reschedule later");
+        {
+            std::atomic<double> executed_at(-1);
+            Engine::Core::ScheduleHandle handle = loop.Schedule(now() + 0.2, [&]() { executed_at = now(); });
+            double time = now() + 0.6;
+            check(handle.Reschedule(time));
+            sleep(0.4);
+            check(executed_at == -1);
+            check(handle.IsPending());
+            sleep(0.6);
+            check(executed_at >= time);
+            check(!handle.IsPending());
+            check(!handle.Reschedule(now()));
+        }
+
+        print("");
+        print("Reschedule earlier");
+        {
+            std::atomic<double> executed_at(-1);
+            Engine::Core::ScheduleHandle handle = loop.Schedule(now() + 10, [&]() { executed_at = now(); });
+            Engine::Core::ScheduleHandle copy = handle;
+            check(copy.Reschedule(now() + 0.1));
+            sleep(0.5);
+            check(executed_at >= 0);
+            check(!handle.IsPending() && !copy.IsPending());
+            check(!handle.Cancel());
+        }
+
+        print("");
+        print("Cancel a recurring schedule while it runs");
+        {
+            std::atomic<int> started(0), finished(0);
+            std::atomic<bool> released(false);
+            auto capture = std::make_shared<ReleaseFlag>(&released);
+            Engine::Core::ScheduleHandle handle = loop.ScheduleEvery(0.05, [capture, &started, &finished]() {
+                started++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                finished++;
+            });
+            capture.reset();
+            while (started == 0)
+                std::this_thread::yield();
+            check(handle.IsPending());
+            check(handle.Cancel());
+            check(!handle.IsPending());
+            check(!handle.Cancel());
+            check(finished == 0 && !released); // Released by the call once it's done
+            sleep(0.5);
+            check(finished == 1 && started == 1);
+            check(released);
+        }
+
+        print("");
+        print("Handles outlive Stop()");
+        {
+            std::atomic<bool> executed(false), released(false);
+            auto capture = std::make_shared<ReleaseFlag>(&released);
+            Engine::Core::ScheduleHandle handle = loop.Schedule(now() + 10, [capture, &executed]() { executed = true; });
+            Engine::Core::ScheduleHandle recurring = loop.ScheduleEvery(10, [capture]() {});
+            capture.reset();
+            check(handle.IsPending() && recurring.IsPending());
+            loop.Stop();
+            runner.join();
+            check(released);
+            check(!handle.IsPending() && !recurring.IsPending());
+            check(!handle.Cancel() && !recurring.Cancel());
+            check(!handle.Reschedule(0));
+
+            // Not running, refers to no schedule
+            Engine::Core::ScheduleHandle dropped = loop.Schedule([&executed]() { executed = true; });
+            check(!dropped.IsPending() && !dropped.Cancel());
+            check(!executed);
+
+            // Still usable by the next run
+            runner = std::thread([&loop]() { loop.Run(); });
+            while (!loop.IsRunning())
+                std::this_thread::yield();
+            check(!handle.IsPending() && !handle.Reschedule(0));
+            handle = loop.Schedule([&executed]() { executed = true; });
+            sleep(0.2);
+            check(executed);
+            check(!handle.IsPending());
+        }
+
+        print("");
+        print("A recurring schedule that runs while the loop stops is not carried to the next run");
+        {
+            std::atomic<int> started(0);
+            Engine::Core::ScheduleHandle recurring = loop.ScheduleEvery(0.05, [&started]() {
+                started++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            }, nullptr, Engine::Core::RecurrencePolicy::Skip, Engine::Core::ExecutionType::FreeAsync);
+            while (started == 0)
+                std::this_thread::yield();
+            loop.Stop();
+            runner.join();
+            runner = std::thread([&loop]() { loop.Run(); });
+            while (!loop.IsRunning())
+                std::this_thread::yield();
+            sleep(0.6);
+            check(started == 1);
+            check(!recurring.IsPending());
+            check(!recurring.Cancel());
+        }
+    }
+    catch (std::exception& e) { print("Exception: " << e.what()); }
+
+    loop.Stop();
+    if (runner.joinable())
+        runner.join();
+}
+
+/// Executes a function on the ThreadPool.
+class FunctionTask : public Engine::Core::ThreadPool::Task
+{
+public:
+    std::function<void()> Function;
+
+    FunctionTask(std::function<void()> Function) : Function(std::move(Function)) {}
+    virtual void Execute() override { Function(); }
+};
+
+void TestPreferredThreads()
+{
+    const int count = 8;
+    Engine::Core::ThreadPool pool(3, "Pinned", 1);
+    pool.SetSpinTime(std::chrono::microseconds(50));
+    pool.Attach();
+
+    std::atomic<bool> blocker_started(false), released(false);
+    std::atomic<int> executed(0);
+    FunctionTask blocker([&]() {
+        blocker_started = true;
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+        while (!released && std::chrono::steady_clock::now() < timeout)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    blocker.SetPreferredThread(1);
+    std::atomic<int> blocker_pending(0);
+    pool.Fork(&blocker, blocker_pending);
+    while (!blocker_started)
+        std::this_thread::yield();
+
+    print("");
+    print("The tasks that wait for a blocked thread are taken by the others");
+    {
+        std::unique_ptr<FunctionTask> tasks[count];
+        std::atomic<int> pending(0);
+        std::clock_t cpu_start = std::clock();
+        for (int i = 0; i < count; i++)
+        {
+            tasks[i].reset(new FunctionTask([&executed]() { executed++; }));
+            tasks[i]->SetPreferredThread(1);
+            pool.Fork(tasks[i].get(), pending);
+        }
+        pool.Join(pending);
+        double cpu_time = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        check(executed == count);
+        check(!released && blocker_pending == 1);
+        // Without spinning until the blocked thread is done
+        check(cpu_time < 0.1);
+    }
+
+    released = true;
+    pool.Join(blocker_pending);
+    pool.Detach();
+}
+
+/// A FreeAsync module with slow updates, which counts the updates that overlap.
+class SlowAsyncModule : public Engine::Core::Module
+{
+public:
+    std::atomic<int> Running, MaxRunning, Updates;
+
+    SlowAsyncModule() : Module(0), Running(0), MaxRunning(0), Updates(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        int running = ++Running;
+        if (running > MaxRunning)
+            MaxRunning = running;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Updates++;
+        Running--;
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "SlowAsync";
+    }
+
+    virtual Engine::Core::ExecutionType GetExecutionType() override
+    {
+        return Engine::Core::ExecutionType::FreeAsync;
+    }
+};
+
+void TestFreeAsync()
+{
+    print("");
+    print("A FreeAsync update is skipped while the previous one is running");
+    {
+        SlowAsyncModule module;
+        Engine::Core::Loop loop;
+        loop.Modules.Add(&module);
+        loop.SetTickRate(1000);
+        std::thread runner([&loop]() { loop.Run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(550));
+        loop.Stop();
+        runner.join();
+        while (module.Running > 0)
+            std::this_thread::yield();
+        check(module.MaxRunning == 1);
+        check(module.Updates >= 3 && module.Updates <= 6);
+    }
+
+    print("");
+    print("The executor rejects the tasks beyond MaxQueuedCount");
+    {
+        std::atomic<bool> released(false);
+        std::atomic<int> executed(0);
+        Engine::Core::AsyncExecutor executor(1, 10, 2);
+        check(executor.GetMaxQueuedCount() == 2);
+        check(executor.Execute([&released]() {
+            while (!released)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }));
+        check(executor.Execute([&executed]() { executed++; }));
+        check(executor.Execute([&executed]() { executed++; }));
+        check(!executor.Execute([&executed]() { executed++; }));
+        released = true;
+        while (executor.GetIdleThreadsCount() == 0)
+            std::this_thread::yield();
+        check(executed == 2);
+        check(executor.Execute([&executed]() { executed++; }));
+    }
+}
+
+void TestStatistics()
+{
+    IdleModule idle, other;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.Modules.Add(&other);
+    loop.SetTickRate(1000);
+    loop.SetStatisticsEnabled(true);
+    auto run = [&loop](std::function<void()> WhileRunning) {
+        std::thread runner([&loop]() { loop.Run(); });
+        while (loop.GetClock().Tick < 10)
+            std::this_thread::yield();
+        WhileRunning();
+        loop.Stop();
+        runner.join();
+    };
+
+    print("");
+    print("A module keeps its record between the runs and when it's added again");
+    {
+        run([]() {});
+        run([&]() {
+            loop.Modules.Remove(&idle);
+            long long tick = loop.GetClock().Tick;
+            while (loop.GetClock().Tick < tick + 5)
+                std::this_thread::yield();
+            loop.Modules.Add(&idle);
+            tick = loop.GetClock().Tick;
+            while (loop.GetClock().Tick < tick + 5)
+                std::this_thread::yield();
+        });
+        Engine::Core::LoopStatistics statistics = loop.GetStatistics();
+        int idle_records = 0;
+        long long idle_updates = 0;
+        statistics.Modules.ForEach([&](Engine::Core::ModuleStatistics Item) {
+            if (Item.Target == &idle)
+            {
+                idle_records++;
+                idle_updates += Item.Updates.Count;
+            }
+        });
+        check(statistics.Modules.GetCount() == 2);
+        check(idle_records == 1);
+        check(idle_updates >= 20);
+    }
+
+    print("");
+    print("Reset keeps the records and clears them");
+    {
+        loop.ResetStatistics();
+        Engine::Core::LoopStatistics statistics = loop.GetStatistics();
+        check(statistics.Modules.GetCount() == 2);
+        check(statistics.Modules.GetItem(0).Updates.Count == 0);
+        run([]() {});
+        statistics = loop.GetStatistics();
+        check(statistics.Modules.GetCount() == 2);
+        check(statistics.Modules.GetItem(0).Updates.Count >= 10);
+    }
+}
+
+/// Counts the occurrences of a text in a file.
+int CountInFile(const std::string& FilePath, const std::string& Text)
+{
+    std::ifstream file(FilePath);
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+    int count = 0;
+    for (std::size_t i = data.find(Text); i != std::string::npos; i = data.find(Text, i + Text.size()))
+        count++;
+    return count;
+}
+
+void TestTracer()
+{
+    const std::string path = "CoreTest.trace.json";
+    const std::string name = "Traced";
+    auto now = std::chrono::steady_clock::now();
+
+    print("");
+    print("The buffers of the exited threads are reused");
+    {
+        Engine::Core::Tracer tracer(64);
+        tracer.Record(Engine::Core::Tracer::Update, &name, 0, now, now);
+        for (int i = 0; i < 50; i++)
+            std::thread([&]() { tracer.Record(Engine::Core::Tracer::Update, &name, 0, now, now); }).join();
+        tracer.Write(path);
+        check(CountInFile(path, "\"thread_name\"") == 2);
+        check(CountInFile(path, "\"name\":\"Traced\"") == 51);
+    }
+
+    print("");
+    print("Writing while a thread is recording");
+    {
+        Engine::Core::Tracer tracer(64);
+        std::atomic<bool> done(false);
+        std::atomic<long long> recorded(0);
+        std::thread recorder([&]() {
+            while (!done)
+            {
+                tracer.Record(Engine::Core::Tracer::Update, &name, 0, now, now);
+                recorded++;
+            }
+        });
+        int written = 0;
+        for (int i = 0; i < 20; i++)
+        {
+            tracer.Write(path);
+            written += CountInFile(path, "\"name\":\"Traced\"");
+        }
+        done = true;
+        recorder.join();
+        tracer.Write(path);
+        written += CountInFile(path, "\"name\":\"Traced\"");
+        // Each event is written once at most, the overwritten ones are dropped
+        check(written > 0 && written <= recorded);
+    }
+    std::remove(path.c_str());
+}
+
+/// Records the loop update of its start and stop, and whether it's updated while not started.
+class ChangeCountingModule : public Engine::Core::Module
+{
+public:
+    std::atomic<long long> StartTick;
+    std::atomic<long long> StopTick;
+    std::atomic<bool> IsStarted;
+    std::atomic<bool> IsUpdatedWhileStopped;
+
+    ChangeCountingModule(int ExecutionChunk = 0) : Module(ExecutionChunk), StartTick(-1), StopTick(-1), IsStarted(false), IsUpdatedWhileStopped(false) {}
+
+    virtual void OnStart() override
+    {
+        StartTick = GetLoop()->GetClock().Tick;
+        IsStarted = true;
+    }
+
+    virtual void OnEnable() override {}
+
+    virtual void OnUpdate() override
+    {
+        if (!IsStarted)
+            IsUpdatedWhileStopped = true;
+    }
+
+    virtual void OnDisable() override {}
+
+    virtual void OnStop() override
+    {
+        IsStarted = false;
+        StopTick = GetLoop()->GetClock().Tick;
+    }
+
+    virtual std::string GetName() override
+    {
+        return "Counting";
+    }
+};
+
+void TestModuleChanges()
+{
+    const int Count = 12;
+    IdleModule idle;
+    ChangeCountingModule modules[Count];
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.SetTickRate(1000);
+    std::thread runner([&loop]() { loop.Run(); });
+    while (loop.GetClock().Tick < 10)
+        std::this_thread::yield();
+    // The most modules that share the tick of their start or stop
+    auto most_per_tick = [&](std::atomic<long long> ChangeCountingModule::* Tick) {
+        int most = 0;
+        for (int i = 0; i < Count; i++)
+        {
+            int same = 0;
+            for (int j = 0; j < Count; j++)
+                if (modules[j].*Tick == modules[i].*Tick)
+                    same++;
+            most = std::max(most, same);
+        }
+        return most;
+    };
+    auto wait_for = [](std::function<bool()> Condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!Condition() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+    };
+
+    print("");
+    print("The added modules are started a few per loop update");
+    {
+        for (int i = 0; i < Count; i++)
+            loop.Modules.Add(&modules[i]);
+        wait_for([&]() {
+            for (int i = 0; i < Count; i++)
+                if (!modules[i].IsStarted)
+                    return false;
+            return true;
+        });
+        bool all_started = true;
+        for (int i = 0; i < Count; i++)
+            all_started = all_started && modules[i].IsStarted;
+        check(all_started);
+        check(most_per_tick(&ChangeCountingModule::StartTick) <= 4);
+        check(modules[Count - 1].StartTick > modules[0].StartTick);
+    }
+
+    print("");
+    print("The removed modules are stopped a few per loop update");
+    {
+        for (int i = 0; i < Count; i++)
+            loop.Modules.Remove(&modules[i]);
+        wait_for([&]() {
+            for (int i = 0; i < Count; i++)
+                if (modules[i].IsStarted)
+                    return false;
+            return true;
+        });
+        bool all_stopped = true;
+        for (int i = 0; i < Count; i++)
+            all_stopped = all_stopped && !modules[i].IsStarted && !modules[i].IsRunning();
+        check(all_stopped);
+        check(most_per_tick(&ChangeCountingModule::StopTick) <= 4);
+        bool updated_while_stopped = false;
+        for (int i = 0; i < Count; i++)
+            updated_while_stopped = updated_while_stopped || modules[i].IsUpdatedWhileStopped;
+        check(!updated_while_stopped);
+    }
+
+    print("");
+    print("The modules that are not stopped yet are stopped with the loop");
+    {
+        Engine::Core::Module * items[Count];
+        for (int i = 0; i < Count; i++)
+            items[i] = &modules[i];
+        loop.AddModules(items, Count);
+        wait_for([&]() { return modules[Count - 1].IsStarted.load(); });
+        for (int i = 0; i < Count; i++)
+            loop.Modules.Remove(&modules[i]);
+        loop.Stop();
+        runner.join();
+        bool all_stopped = true;
+        for (int i = 0; i < Count; i++)
+            all_stopped = all_stopped && !modules[i].IsStarted && !modules[i].IsRunning();
+        check(all_stopped);
+    }
+
+    print("");
+    print("AddModules merges the modules by ExecutionChunk and checks them before changing the list");
+    {
+        Engine::Core::Loop other;
+        ChangeCountingModule early(-1), middle(0), late(1);
+        other.Modules.Add(&middle);
+        Engine::Core::Module * items[] = { &late, &early };
+        other.AddModules(items, 2);
+        check(other.Modules.GetCount() == 3);
+        check(other.Modules.GetItem(0) == &early && other.Modules.GetItem(1) == &middle && other.Modules.GetItem(2) == &late);
+
+        ChangeCountingModule added;
+        Engine::Core::Module * duplicates[] = { &added, &middle };
+        bool is_thrown = false;
+        try { other.AddModules(duplicates, 2); }
+        catch (std::invalid_argument&) { is_thrown = true; }
+        check(is_thrown);
+        check(other.Modules.GetCount() == 3 && !other.Modules.Contains(&added));
+
+        Engine::Core::Module * unsorted[] = { &late, &early };
+        is_thrown = false;
+        try { other.Modules.Assign(unsorted, 2); }
+        catch (std::invalid_argument&) { is_thrown = true; }
+        check(is_thrown && other.Modules.GetCount() == 3);
+        other.Modules.Remove(&middle);
+        other.Modules.Add(&added);
+        check(other.Modules.GetItem(1) == &added && other.Modules.GetItem(2) == &late);
+    }
+}
+
+/// The starts and ends of the updates of the graph checks, in their order.
+struct GraphEvent
+{
+    long long Tick;
+    Engine::Core::Module * Target;
+    bool IsEnd;
+};
+std::mutex graph_events_mutex;
+std::vector<GraphEvent> graph_events;
+
+class OrderedModule : public Engine::Core::Module
+{
+public:
+    int SleepTime;
+
+    OrderedModule(int ExecutionChunk, int SleepTime) : Module(ExecutionChunk), SleepTime(SleepTime) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        long long tick = GetClock().Tick;
+        {
+            std::lock_guard<std::mutex> guard(graph_events_mutex);
+            graph_events.push_back(GraphEvent{ tick, this, false });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(SleepTime));
+        std::lock_guard<std::mutex> guard(graph_events_mutex);
+        graph_events.push_back(GraphEvent{ tick, this, true });
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Ordered";
+    }
+};
+
+void TestDependencyGraph()
+{
+    OrderedModule slow(0, 20), first(1, 10), dependent(1, 1), reader(1, 5), writer(1, 1), last(2, 1);
+    dependent.AddDependency(&first);
+    reader.AddReadResource("Data");
+    writer.AddWriteResource("Data");
+    // Enough threads to update the modules of a chunk in parallel
+    Engine::Core::ThreadPool pool(4, "Graph", 1);
+    Engine::Core::Loop loop;
+    loop.SetThreadPool(&pool);
+    loop.Modules.Add(&slow);
+    loop.Modules.Add(&first);
+    loop.Modules.Add(&dependent);
+    loop.Modules.Add(&reader);
+    loop.Modules.Add(&writer);
+    loop.Modules.Add(&last);
+    loop.SetTickRate(1000);
+    graph_events.clear();
+    std::thread runner([&loop]() { loop.Run(); });
+    while (loop.GetClock().Tick < 10)
+        std::this_thread::yield();
+    loop.Stop();
+    runner.join();
+
+    // Whether each update of Before ends before the update of After in the same loop update starts
+    auto is_before = [](Engine::Core::Module * Before, Engine::Core::Module * After) {
+        int checked = 0;
+        for (std::size_t i = 0; i < graph_events.size(); i++)
+        {
+            if (graph_events[i].Target != After || graph_events[i].IsEnd)
+                continue;
+            bool is_ended = false;
+            for (std::size_t j = 0; j < i; j++)
+                if (graph_events[j].Target == Before && graph_events[j].IsEnd && graph_events[j].Tick == graph_events[i].Tick)
+                    is_ended = true;
+            if (!is_ended)
+                return false;
+            checked++;
+        }
+        return checked >= 5;
+    };
+
+    print("");
+    print("The modules with declarations wait for the lower chunks");
+    {
+        check(is_before(&slow, &first));
+        check(is_before(&slow, &reader));
+        check(is_before(&slow, &writer));
+    }
+
+    print("");
+    print("The declarations order the modules of a chunk");
+    {
+        check(is_before(&first, &dependent));
+        check(is_before(&reader, &writer));
+    }
+
+    print("");
+    print("The next chunk waits for all the modules");
+    {
+        check(is_before(&dependent, &last));
+        check(is_before(&reader, &last));
+        check(is_before(&writer, &last));
+    }
+}
+
+/// Waits up to a second for a condition, and gets the seconds since Start or a negative number on timeout.
+double MeasureWait(std::function<bool()> Condition,
+                   std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now())
+{
+    auto start = Start;
+    while (!Condition())
+    {
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(1))
+            return -1;
+        std::this_thread::yield();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TestIdleWake()
+{
+    // Not paced and all the modules are disabled, so the loop idles until an event
+    IdleModule idle;
+    idle.Disable();
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    std::thread runner([&loop]() { loop.Run(); });
+    while (!loop.IsRunning())
+        std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    print("");
+    print("An idle loop sleeps");
+    {
+        long long tick = loop.GetClock().Tick;
+        std::clock_t cpu_start = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        double cpu_time = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        print("CPU time: " << cpu_time << " s");
+        check(cpu_time < 0.05);
+        check(loop.GetClock().Tick - tick <= 1);
+    }
+
+    print("");
+    print("A schedule wakes the idle loop");
+    {
+        std::atomic<bool> is_called(false);
+        auto start = std::chrono::steady_clock::now();
+        loop.Schedule([&is_called]() { is_called = true; });
+        double latency = MeasureWait([&]() { return is_called.load(); }, start);
+        print("Latency: " << latency << " s");
+        check(latency >= 0 && latency < 0.02);
+    }
+
+    print("");
+    print("The idle loop wakes at the time of a later schedule");
+    {
+        std::atomic<bool> is_called(false);
+        std::atomic<double> delay(-1);
+        // Scheduled by a job, where the clock of the loop is current
+        loop.Schedule([&]() {
+            auto start = std::chrono::steady_clock::now();
+            loop.Schedule(loop.GetClock().Time + 0.1, [&, start]() {
+                delay = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                is_called = true;
+            });
+        });
+        MeasureWait([&]() { return is_called.load(); });
+        print("Delay: " << delay << " s");
+        check(delay >= 0.095 && delay < 0.12);
+    }
+
+    print("");
+    print("Adding or enabling a module wakes the idle loop");
+    {
+        ChangeCountingModule added;
+        auto start = std::chrono::steady_clock::now();
+        loop.Modules.Add(&added);
+        double latency = MeasureWait([&]() { return added.IsStarted.load(); }, start);
+        print("Latency: " << latency << " s");
+        check(latency >= 0 && latency < 0.02);
+        loop.Modules.Remove(&added);
+        MeasureWait([&]() { return !added.IsStarted; });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        long long tick = loop.GetClock().Tick;
+        start = std::chrono::steady_clock::now();
+        idle.Enable();
+        latency = MeasureWait([&]() { return loop.GetClock().Tick > tick + 1; }, start);
+        print("Latency: " << latency << " s");
+        check(latency >= 0 && latency < 0.02);
+        idle.Disable();
+    }
+
+    print("");
+    print("Stop wakes the idle loop");
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto start = std::chrono::steady_clock::now();
+        loop.Stop();
+        runner.join();
+        double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        print("Latency: " << latency << " s");
+        check(latency < 0.02);
+    }
+}
+
+/// Records the clock of each update, and stalls one update on request.
+class PacedModule : public Engine::Core::Module
+{
+public:
+    std::mutex Mutex;
+    std::vector<Engine::Core::FrameClock> Clocks;
+    std::atomic<int> StallTime;
+
+    PacedModule() : Module(0), StallTime(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        {
+            std::lock_guard<std::mutex> guard(Mutex);
+            Clocks.push_back(GetClock());
+        }
+        int stall_time = StallTime.exchange(0);
+        if (stall_time > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(stall_time));
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Paced";
+    }
+
+    virtual Engine::Core::ExecutionType GetExecutionType() override
+    {
+        return Engine::Core::ExecutionType::SingleThreaded;
+    }
+};
+
+void TestPacing()
+{
+    PacedModule paced;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&paced);
+    // Runs for a time and gets the clocks of the updates and the CPU time per second
+    double run_time = 0;
+    auto run = [&](double Seconds, std::function<void()> WhileRunning) {
+        paced.Clocks.clear();
+        std::clock_t cpu_start = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        std::thread runner([&loop]() { loop.Run(); });
+        WhileRunning();
+        std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+        loop.Stop();
+        runner.join();
+        run_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC / run_time;
+    };
+
+    print("");
+    print("A tick rate paces the updates and sleeps between them");
+    {
+        loop.SetTickRate(200);
+        check(loop.GetTickRate() == 200 && !loop.IsFixedTimestep());
+        double cpu_usage = run(1, []() {});
+        std::size_t count = paced.Clocks.size();
+        print("Ticks: " << count << ", CPU usage: " << cpu_usage);
+        check(count >= 180 && count <= 210);
+        check(cpu_usage < 0.25);
+        // The time differences after the first ticks
+        double max_error = 0, total_error = 0;
+        for (std::size_t i = 10; i < count; i++)
+        {
+            double error = std::abs(paced.Clocks[i].TimeDiff - 0.005);
+            max_error = std::max(max_error, error);
+            total_error += error;
+        }
+        print("TimeDiff error: " << total_error / (count - 10) << " s on average, " << max_error << " s at most");
+        check(total_error / (count - 10) < 0.0005);
+    }
+
+    print("");
+    print("A fixed timestep advances the time exactly and catches up the missed ticks");
+    {
+        loop.SetTickRate(100, true);
+        check(loop.IsFixedTimestep());
+        std::atomic<double> lag(0);
+        run(1, [&]() {
+            while (loop.GetClock().Tick < 20)
+                std::this_thread::yield();
+            paced.StallTime = 100;
+            while (paced.StallTime != 0)
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            lag = loop.GetLag();
+        });
+        std::size_t count = paced.Clocks.size();
+        bool is_exact = true;
+        double max_lag = 0;
+        for (std::size_t i = 1; i < count; i++)
+        {
+            is_exact = is_exact && std::abs(paced.Clocks[i].TimeDiff - 0.01) < 1e-9
+                && std::abs(paced.Clocks[i].Time - (paced.Clocks[i].Tick - 1) * 0.01) < 1e-9;
+            max_lag = std::max(max_lag, paced.Clocks[i].Lag);
+        }
+        print("Ticks: " << count << " in " << run_time << " s, most lag: " << max_lag << " s, lag after catching up: " << lag << " s");
+        check(is_exact);
+        // The stalled ticks are caught up
+        check(std::abs((double)count - run_time * 100) <= 5);
+        check(max_lag >= 0.09);
+        check(lag < 0.01);
+    }
+
+    print("");
+    print("No pacing by default");
+    {
+        loop.SetTickRate(0);
+        run(0.1, []() {});
+        check(paced.Clocks.size() > 0 && paced.Clocks.back().Lag == 0);
+        check(loop.GetLag() == 0);
+    }
+}
+
+/// The largest chunk key of the finished updates, see DispatchModule.
+std::atomic<long long> finished_key(0);
+std::atomic<int> out_of_order_updates(0);
+
+/// Counts its updates, and the updates that are started after a later chunk or tick is done.
+class DispatchModule : public Engine::Core::Module
+{
+public:
+    std::atomic<long long> Updates;
+
+    DispatchModule(int ExecutionChunk) : Module(ExecutionChunk), Updates(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        long long key = GetClock().Tick * 256 + GetExecutionChunk() + 128;
+        if (finished_key.load() > key)
+            out_of_order_updates++;
+        Updates++;
+        long long finished = finished_key.load();
+        while (finished < key && !finished_key.compare_exchange_weak(finished, key));
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Dispatch";
+    }
+};
+
+void TestDispatchTable()
+{
+    const int Count = 10000;
+    // Added in reverse chunk order, the list keeps them sorted
+    std::vector<std::unique_ptr<DispatchModule>> modules;
+    for (int i = 0; i < Count; i++)
+        modules.emplace_back(new DispatchModule(3 - i % 4));
+    Engine::Core::Loop loop;
+    for (int i = 0; i < Count; i++)
+        loop.Modules.Add(modules[i].get());
+    finished_key = 0;
+    out_of_order_updates = 0;
+    std::thread runner([&loop]() { loop.Run(); });
+    auto wait_ticks = [&loop](long long Count) {
+        long long tick = loop.GetClock().Tick;
+        while (loop.GetClock().Tick < tick + Count)
+            std::this_thread::yield();
+    };
+
+    print("");
+    print("Each module is updated once per loop update, by the order of the chunks");
+    {
+        wait_ticks(50);
+        auto start = std::chrono::steady_clock::now();
+        long long start_tick = loop.GetClock().Tick;
+        wait_ticks(50);
+        double tick_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            / (loop.GetClock().Tick - start_tick);
+        print("Time per loop update: " << tick_time * 1000000 << " us for " << Count << " modules");
+        long long ticks = loop.GetClock().Tick;
+        bool is_once_per_tick = true;
+        for (int i = 0; i < Count; i++)
+            is_once_per_tick = is_once_per_tick && std::abs(modules[i]->Updates - ticks) <= 1;
+        check(is_once_per_tick);
+        check(out_of_order_updates == 0);
+    }
+
+    print("");
+    print("The disabled modules are not updated until enabled");
+    {
+        for (int i = 0; i < Count; i += 2)
+            modules[i]->Disable();
+        wait_ticks(2);
+        long long disabled_updates = modules[0]->Updates, enabled_updates = modules[1]->Updates;
+        wait_ticks(20);
+        check(modules[0]->Updates == disabled_updates);
+        check(modules[1]->Updates >= enabled_updates + 20);
+        for (int i = 0; i < Count; i += 2)
+            modules[i]->Enable();
+        wait_ticks(20);
+        check(modules[0]->Updates >= disabled_updates + 18);
+        check(out_of_order_updates == 0);
+    }
+
+    loop.Stop();
+    runner.join();
+}
+
+/// Gets whether a future is ready with an exception.
+template <typename T>
+bool IsFailed(Engine::Core::Future<T>& Future)
+{
+    if (!Future.IsReady())
+        return false;
+    try { Future.Get(); }
+    catch (std::exception&) { return true; }
+    return false;
+}
+
+void TestFutures()
+{
+    IdleModule idle;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.SetTickRate(1000);
+    std::thread runner([&loop]() { loop.Run(); });
+    while (loop.GetClock().Tick < 10)
+        std::this_thread::yield();
+    auto wait = [](auto& Future) { return MeasureWait([&]() { return Future.IsReady(); }) >= 0; };
+
+    print("");
+    print("Submit and the continuations run on the loop");
+    {
+        std::thread::id caller = std::this_thread::get_id();
+        std::atomic<bool> is_on_caller(false);
+        Engine::Core::Future<int> value = loop.Submit([]() { return 20; });
+        Engine::Core::Future<std::string> result = value.Then([&](int Value) {
+            if (std::this_thread::get_id() == caller)
+                is_on_caller = true;
+            return Value + 1;
+        }).Then([](int Value) {
+            return std::to_string(Value);
+        });
+        check(wait(result));
+        check(value.Get() == 20);
+        check(result.Get() == "21");
+        check(!is_on_caller);
+
+        // A continuation that returns a future results in that future
+        Engine::Core::Future<int> chained = value.Then([&loop](int Value) {
+            return loop.Submit([Value]() { return Value * 2; });
+        });
+        check(wait(chained));
+        check(chained.Get() == 40);
+
+        Engine::Core::Future<void> done = loop.Submit([]() {});
+        std::atomic<bool> is_continued(false);
+        Engine::Core::Future<void> continued = done.Then([&]() { is_continued = true; });
+        check(wait(continued) && is_continued);
+    }
+
+    print("");
+    print("The exceptions skip the continuations");
+    {
+        std::atomic<bool> is_called(false);
+        Engine::Core::Future<int> thrown = loop.Submit([]() -> int { throw std::runtime_error("Submitted"); });
+        Engine::Core::Future<int> continued = thrown.Then([&](int Value) { is_called = true; return Value; });
+        check(wait(continued));
+        check(IsFailed(thrown) && IsFailed(continued));
+        check(!is_called);
+    }
+
+    print("");
+    print("WhenAll and WhenAny");
+    {
+        Engine::Core::Future<int> futures[8];
+        for (int i = 0; i < 8; i++)
+            futures[i] = loop.Submit([i]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(i));
+                return i;
+            });
+        Engine::Core::Future<void> all = Engine::Core::WhenAll(futures, 8);
+        check(wait(all));
+        bool are_ready = true;
+        for (int i = 0; i < 8; i++)
+            are_ready = are_ready && futures[i].IsReady() && futures[i].Get() == i;
+        check(are_ready);
+
+        futures[3] = loop.Submit([]() -> int { throw std::runtime_error("Failed"); });
+        all = Engine::Core::WhenAll(futures, 8);
+        check(wait(all) && IsFailed(all));
+
+        Engine::Core::Promise<int> never(&loop);
+        Engine::Core::Future<int> any_of[3] = { never.GetFuture(), loop.Submit([]() { return 1; }), never.GetFuture() };
+        Engine::Core::Future<int> any = Engine::Core::WhenAny(any_of, 3);
+        check(wait(any));
+        check(any.Get() == 1);
+    }
+
+    print("");
+    print("The results that can't be set are exceptions");
+    {
+        Engine::Core::Future<int> dropped;
+        {
+            Engine::Core::Promise<int> promise(&loop);
+            dropped = promise.GetFuture();
+        }
+        check(IsFailed(dropped));
+
+        Engine::Core::Promise<int> late(&loop);
+        Engine::Core::Future<int> continued = late.GetFuture().Then([](int Value) { return Value; });
+        loop.Stop();
+        runner.join();
+        late.SetValue(1);
+        check(IsFailed(continued));
+
+        Engine::Core::Future<int> submitted = loop.Submit([]() { return 1; });
+        check(IsFailed(submitted));
+    }
+}
+
+/// Gets the threads other than the loop threads that run a batch of sleeping tasks on the loop.
+std::vector<std::thread::id> GetWorkerThreads(Engine::Core::Loop& Loop, std::vector<std::thread::id> LoopThreads)
+{
+    Engine::Core::Future<std::vector<std::thread::id>> threads = Loop.Submit([LoopThreads]() {
+        std::mutex mutex;
+        std::vector<std::thread::id> ids;
+        Engine::Core::TaskGroup group;
+        for (int i = 0; i < 8; i++)
+            group.Run([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                std::lock_guard<std::mutex> guard(mutex);
+                std::thread::id id = std::this_thread::get_id();
+                if (std::find(LoopThreads.begin(), LoopThreads.end(), id) == LoopThreads.end()
+                        && std::find(ids.begin(), ids.end(), id) == ids.end())
+                    ids.push_back(id);
+            });
+        group.Wait();
+        return ids;
+    });
+    MeasureWait([&]() { return threads.IsReady(); });
+    return threads.IsReady() ? threads.Get() : std::vector<std::thread::id>();
+}
+
+void TestSharedPool()
+{
+    Engine::Core::ThreadPool pool(3, "Shared", 2);
+    IdleModule idle_a, idle_b, idle_c;
+    auto start = [](Engine::Core::Loop& Loop, std::thread& Runner) {
+        Loop.SetTickRate(1000);
+        Runner = std::thread([&Loop]() { Loop.Run(); });
+        while (Loop.GetClock().Tick < 5)
+            std::this_thread::yield();
+    };
+    auto current_pool = [](Engine::Core::Loop& Loop) {
+        Engine::Core::Future<Engine::Core::ThreadPool*> current = Loop.Submit([]() {
+            return Engine::Core::ThreadPool::GetCurrent();
+        });
+        MeasureWait([&]() { return current.IsReady(); });
+        return current.IsReady() ? current.Get() : nullptr;
+    };
+    std::vector<std::thread::id> first_threads;
+
+    print("");
+    print("Two loops share a pool, which is full for a third one");
+    {
+        Engine::Core::Loop a, b, c;
+        a.Modules.Add(&idle_a);
+        b.Modules.Add(&idle_b);
+        c.Modules.Add(&idle_c);
+        a.SetThreadPool(&pool);
+        b.SetThreadPool(&pool);
+        c.SetThreadPool(&pool);
+        std::thread runner_a, runner_b;
+        start(a, runner_a);
+        start(b, runner_b);
+        check(current_pool(a) == &pool && current_pool(b) == &pool);
+        first_threads = GetWorkerThreads(a, { runner_a.get_id(), runner_b.get_id() });
+        print("Worker threads: " << first_threads.size());
+        check(first_threads.size() <= 2);
+
+        bool is_full = false;
+        try { c.Run(); }
+        catch (std::runtime_error&) { is_full = true; }
+        check(is_full && !c.IsRunning());
+
+        a.Stop();
+        b.Stop();
+        runner_a.join();
+        runner_b.join();
+    }
+
+    print("");
+    print("The pool outlives the loops and keeps its threads");
+    {
+        Engine::Core::Loop d;
+        d.Modules.Add(&idle_a);
+        d.SetThreadPool(&pool);
+        std::thread runner;
+        start(d, runner);
+        check(current_pool(d) == &pool);
+        bool is_same = true;
+        for (std::thread::id id : GetWorkerThreads(d, { runner.get_id() }))
+            is_same = is_same && std::find(first_threads.begin(), first_threads.end(), id) != first_threads.end();
+        check(is_same);
+        d.Stop();
+        runner.join();
+    }
+
+    print("");
+    print("The own pool of a loop is kept between its runs");
+    {
+        Engine::Core::Loop e;
+        e.Modules.Add(&idle_a);
+        check(e.GetThreadPool() == nullptr);
+        std::thread runner;
+        start(e, runner);
+        Engine::Core::ThreadPool * first = current_pool(e);
+        e.Stop();
+        runner.join();
+        start(e, runner);
+        Engine::Core::ThreadPool * second = current_pool(e);
+        e.Stop();
+        runner.join();
+        check(first != nullptr && first != &pool && first == second);
+    }
+}
+
+void TestSpinTime()
+{
+    Engine::Core::ThreadPool pool(2, "Spinning", 2);
+    pool.Attach();
+    // Runs two sleeping tasks, which are executed in parallel if the other thread takes one
+    auto execute = [&pool]() {
+        FunctionTask first([]() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+        FunctionTask second([]() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+        Engine::Core::ThreadPool::Task * tasks[] = { &first, &second };
+        auto start = std::chrono::steady_clock::now();
+        pool.Execute(tasks, 2);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    // The CPU time of the process while the calling thread sleeps after a batch
+    auto idle_cpu_time = [&]() {
+        execute();
+        std::clock_t cpu_start = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        return (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    };
+
+    print("");
+    print("The threads of a pool spin, then yield, and then sleep");
+    {
+        pool.SetSpinTime(std::chrono::nanoseconds(0));
+        check(pool.GetSpinTime() == std::chrono::nanoseconds(0));
+        double cpu_time = idle_cpu_time();
+        print("CPU time without spinning: " << cpu_time << " s");
+        check(cpu_time < 0.01);
+
+        pool.SetSpinTime(std::chrono::milliseconds(30));
+        cpu_time = idle_cpu_time();
+        print("CPU time with 30 ms of spinning: " << cpu_time << " s");
+        check(cpu_time >= 0.02 && cpu_time < 0.1);
+
+        // The sleeping thread is woken for the next batch
+        pool.SetSpinTime(std::chrono::nanoseconds(0));
+        execute();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        double duration = execute();
+        print("Batch time: " << duration << " s");
+        check(duration < 0.035);
+    }
+    pool.Detach();
+
+    print("");
+    print("A loop sets the spin time of its pool, or calibrates its own pool");
+    {
+        IdleModule idle;
+        Engine::Core::Loop loop;
+        loop.Modules.Add(&idle);
+        loop.SetTickRate(1000);
+        check(loop.GetSpinTime() < 0);
+        loop.SetThreadPool(&pool);
+        pool.SetSpinTime(std::chrono::microseconds(7));
+        std::thread runner([&loop]() { loop.Run(); });
+        auto wait_ticks = [&loop](long long Count) {
+            long long tick = loop.GetClock().Tick;
+            while (loop.GetClock().Tick < tick + Count)
+                std::this_thread::yield();
+        };
+        wait_ticks(10);
+        // A shared pool is not calibrated
+        check(pool.GetSpinTime() == std::chrono::microseconds(7));
+        loop.SetSpinTime(0.0002);
+        wait_ticks(2);
+        check(loop.GetSpinTime() == 0.0002);
+        check(pool.GetSpinTime() == std::chrono::microseconds(200));
+        loop.Stop();
+        runner.join();
+    }
+}
+
+/// Checks that all the modules of the previous chunk were updated before it in the same loop update.
+class BarrierModule : public Engine::Core::Module
+{
+public:
+    std::atomic<long long> LastTick;
+    std::vector<BarrierModule*> * Previous;
+
+    BarrierModule(int ExecutionChunk, std::vector<BarrierModule*> * Previous)
+        : Module(ExecutionChunk), LastTick(0), Previous(Previous) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        long long tick = GetClock().Tick;
+        if (Previous != nullptr)
+            for (BarrierModule * module : *Previous)
+                if (module->LastTick.load() != tick)
+                    out_of_order_updates++;
+        LastTick = tick;
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Barrier";
+    }
+};
+
+void TestChunkTransitions()
+{
+    print("");
+    print("A bounded wake wakes only that many of the waiting threads");
+    {
+        Engine::Utilities::Futex futex(0);
+        std::atomic<int> woken(0);
+        std::vector<std::thread> waiters;
+        for (int i = 0; i < 3; i++)
+            waiters.emplace_back([&futex, &woken]() {
+                while (futex.Value.load() == 0)
+                    futex.Wait(0);
+                woken++;
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        check(woken == 0);
+        futex.IncreaseAndWake(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        check(woken == 1);
+        futex.IncreaseAndWake(2);
+        for (std::thread& waiter : waiters)
+            waiter.join();
+        check(woken == 3);
+    }
+
+    const int Chunks = 16, PerChunk = 8;
+    std::vector<std::vector<BarrierModule*>> chunks(Chunks);
+    std::vector<std::unique_ptr<BarrierModule>> modules;
+    for (int chunk = 0; chunk < Chunks; chunk++)
+        for (int i = 0; i < PerChunk; i++)
+        {
+            modules.emplace_back(new BarrierModule(chunk, chunk == 0 ? nullptr : &chunks[chunk - 1]));
+            chunks[chunk].push_back(modules.back().get());
+        }
+    Engine::Core::ThreadPool pool(4, "Barrier", 1);
+    Engine::Core::Loop loop;
+    loop.SetThreadPool(&pool);
+    for (auto& module : modules)
+        loop.Modules.Add(module.get());
+    out_of_order_updates = 0;
+    std::thread runner([&loop]() { loop.Run(); });
+    auto wait_ticks = [&loop](long long Count) {
+        long long tick = loop.GetClock().Tick;
+        while (loop.GetClock().Tick < tick + Count)
+            std::this_thread::yield();
+    };
+
+    print("");
+    print("Each chunk starts after all the modules of the previous one");
+    {
+        wait_ticks(50);
+        auto start = std::chrono::steady_clock::now();
+        long long start_tick = loop.GetClock().Tick;
+        wait_ticks(500);
+        double tick_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            / (loop.GetClock().Tick - start_tick);
+        print("Time per chunk transition: " << tick_time / Chunks * 1000000 << " us");
+        check(out_of_order_updates == 0);
+        long long tick = loop.GetClock().Tick;
+        bool is_updated = true;
+        for (auto& module : modules)
+            is_updated = is_updated && module->LastTick >= tick - 1;
+        check(is_updated);
+    }
+
+    loop.Stop();
+    runner.join();
+}
+
+/// Counts its enable and disable calls.
+class ToggledModule : public Engine::Core::Module
+{
+public:
+    std::atomic<int> Enables, Disables;
+    std::atomic<long long> Updates;
+
+    ToggledModule() : Module(0), Enables(0), Disables(0), Updates(0) {}
+
+    /// Reads the time from outside of the module.
+    double ReadTime() { return GetTime(); }
+    long long ReadTick() { return GetTick(); }
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override
+    {
+        Enables++;
+    }
+    virtual void OnUpdate() override
+    {
+        Updates++;
+    }
+    virtual void OnDisable() override
+    {
+        Disables++;
+    }
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Toggled";
+    }
+};
+
+void TestModuleControl()
+{
+    print("");
+    print("A module fits in a cache line and works without a loop");
+    {
+        print("Size of a module: " << sizeof(IdleModule) << " bytes");
+        check(sizeof(IdleModule) <= 64);
+        ToggledModule module;
+        check(module.IsEnabled() && !module.IsRunning());
+        check(module.ReadTime() == 0 && module.ReadTick() == 0);
+        module.Disable();
+        check(!module.IsEnabled());
+        module.Enable();
+        check(module.IsEnabled() && module.Enables == 0 && module.Disables == 0);
+    }
+
+    // Keeps the loop updating while the module is disabled
+    IdleModule idle;
+    ToggledModule module;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.Modules.Add(&module);
+    loop.SetTickRate(1000);
+    std::thread runner([&loop]() { loop.Run(); });
+    auto wait_ticks = [&loop](long long Count) {
+        long long tick = loop.GetClock().Tick;
+        while (loop.GetClock().Tick < tick + Count)
+            std::this_thread::yield();
+    };
+    wait_ticks(5);
+
+    print("");
+    print("The state is read from other threads while the loop updates");
+    {
+        std::atomic<bool> is_consistent(true);
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; i++)
+            readers.emplace_back([&module, &is_consistent]() {
+                double time = 0;
+                long long tick = 0;
+                for (int j = 0; j < 20000; j++)
+                {
+                    double next_time = module.ReadTime();
+                    long long next_tick = module.ReadTick();
+                    if (next_time < time || next_tick < tick || !module.IsRunning() || !module.IsEnabled())
+                        is_consistent = false;
+                    time = next_time;
+                    tick = next_tick;
+                }
+            });
+        for (std::thread& reader : readers)
+            reader.join();
+        check(is_consistent);
+    }
+
+    print("");
+    print("Concurrent enables and disables keep the calls balanced");
+    {
+        std::vector<std::thread> togglers;
+        for (int i = 0; i < 4; i++)
+            togglers.emplace_back([&module, i]() {
+                for (int j = 0; j < 5000; j++)
+                {
+                    if ((i + j) % 2 == 0)
+                        module.Enable();
+                    else
+                        module.Disable();
+                }
+            });
+        for (std::thread& toggler : togglers)
+            toggler.join();
+        print("Enables: " << module.Enables << ", disables: " << module.Disables);
+        check(module.Enables - module.Disables == (module.IsEnabled() ? 1 : 0));
+
+        module.Disable();
+        wait_ticks(2);
+        long long updates = module.Updates;
+        wait_ticks(10);
+        check(module.Updates == updates && !module.IsRunning());
+        module.Enable();
+        wait_ticks(10);
+        check(module.Updates >= updates + 9 && module.IsRunning());
+        check(module.Enables - module.Disables == 1);
+    }
+
+    loop.Stop();
+    runner.join();
+    check(!module.IsRunning() && module.Enables == module.Disables);
+}
+
+/// Reads the clock of a loop on other threads and counts the frames that are not consistent.
+struct ClockReaders
+{
+    std::atomic<long long> TornFrames, AdjacentFrames;
+
+    ClockReaders() : TornFrames(0), AdjacentFrames(0) {}
+
+    /// The loop is expected to have a fixed Timestep if it's > 0, and no lag if it isn't paced.
+    void Run(Engine::Core::Loop& Loop, double Timestep, bool IsPaced, double Seconds)
+    {
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; i++)
+            readers.emplace_back([this, &Loop, Timestep, IsPaced, Seconds]() {
+                auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(Seconds);
+                Engine::Core::FrameClock previous = Loop.GetClock();
+                double offset = previous.Time - previous.Tick * Timestep;
+                while (std::chrono::steady_clock::now() < end)
+                {
+                    Engine::Core::FrameClock clock = Loop.GetClock();
+                    bool is_torn = clock.TimeAsFloat != (float)clock.Time
+                        || clock.TimeDiffAsFloat != (float)clock.TimeDiff
+                        || clock.Tick < previous.Tick;
+                    if (clock.Tick == previous.Tick)
+                        is_torn = is_torn || clock.Time != previous.Time || clock.TimeDiff != previous.TimeDiff
+                            || clock.Lag != previous.Lag;
+                    else if (clock.Tick == previous.Tick + 1)
+                    {
+                        is_torn = is_torn || std::abs(clock.Time - clock.TimeDiff - previous.Time) > 1e-9;
+                        AdjacentFrames++;
+                    }
+                    if (Timestep > 0)
+                        is_torn = is_torn || std::abs(clock.TimeDiff - Timestep) > 1e-9
+                            || std::abs(clock.Time - clock.Tick * Timestep - offset) > 1e-6;
+                    is_torn = is_torn || (IsPaced ? clock.Lag < 0 : clock.Lag != 0);
+                    if (is_torn)
+                        TornFrames++;
+                    previous = clock;
+                    // Lets the loop update between the reads also with a single core
+                    std::this_thread::yield();
+                }
+            });
+        for (std::thread& reader : readers)
+            reader.join();
+    }
+};
+
+void TestClock()
+{
+    IdleModule idle;
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&idle);
+    loop.SetTickRate(1000, true);
+    std::thread runner([&loop]() { loop.Run(); });
+    auto wait_ticks = [&loop](long long Count) {
+        long long tick = loop.GetClock().Tick;
+        while (loop.GetClock().Tick < tick + Count)
+            std::this_thread::yield();
+    };
+    wait_ticks(5);
+
+    print("");
+    print("The values of a loop update are read together with a fixed timestep");
+    {
+        ClockReaders readers;
+        readers.Run(loop, 0.001, true, 0.3);
+        print("Adjacent frames read: " << readers.AdjacentFrames);
+        check(readers.AdjacentFrames > 0);
+        check(readers.TornFrames == 0);
+    }
+
+    print("");
+    print("The values of a loop update are read together with the actual time");
+    {
+        loop.SetTickRate(1000);
+        wait_ticks(5);
+        ClockReaders readers;
+        readers.Run(loop, 0, true, 0.3);
+        print("Adjacent frames read: " << readers.AdjacentFrames);
+        check(readers.AdjacentFrames > 0);
+        check(readers.TornFrames == 0);
+
+        // Updates back to back, the readers may not see adjacent ones
+        loop.SetTickRate(0);
+        wait_ticks(5);
+        readers.TornFrames = 0;
+        readers.Run(loop, 0, false, 0.3);
+        check(readers.TornFrames == 0);
+    }
+
+    loop.Stop();
+    runner.join();
+    Engine::Core::FrameClock clock = loop.GetClock();
+    check(clock.Tick == 0 && clock.Time == 0 && clock.TimeDiff == 0);
+}
+
 int main()
 {
     Engine::Core::Loop loop;
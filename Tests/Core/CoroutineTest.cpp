@@ -0,0 +1,185 @@
+#include "../../Engine/Engine.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+#define print(content) (std::cout << content << '\n')
+#define check(condition) (print(((condition) ? "Passed: " : "FAILED: ") << #condition))
+
+#ifdef ENGINE_COROUTINES
+
+/// Records the loop update of its last update.
+class ChunkModule : public Engine::Core::Module
+{
+public:
+    std::atomic<long long> LastTick;
+
+    ChunkModule(int ExecutionChunk) : Module(ExecutionChunk), LastTick(0) {}
+
+    virtual void OnStart() override {}
+    virtual void OnEnable() override {}
+    virtual void OnUpdate() override
+    {
+        LastTick = GetClock().Tick;
+    }
+    virtual void OnDisable() override {}
+    virtual void OnStop() override {}
+
+    virtual std::string GetName() override
+    {
+        return "Chunk";
+    }
+};
+
+/// Sets a flag when the frame that it's in is destroyed.
+struct DestructionFlag
+{
+    std::atomic<bool> * IsDestroyed;
+    ~DestructionFlag() { *IsDestroyed = true; }
+};
+
+Engine::Core::Coroutine<int> Double(Engine::Core::Loop * Loop, int Value)
+{
+    co_await Loop->NextTick();
+    co_return Value * 2;
+}
+
+Engine::Core::Coroutine<void> AwaitChild(Engine::Core::Loop * Loop, std::atomic<int> * Result)
+{
+    int first = co_await Double(Loop, 10);
+    int second = co_await Double(Loop, first);
+    *Result = second;
+}
+
+Engine::Core::Coroutine<void> AwaitDelay(Engine::Core::Loop * Loop, std::atomic<double> * Elapsed)
+{
+    double start = Loop->GetClock().Time;
+    co_await Loop->Delay(0.05);
+    *Elapsed = Loop->GetClock().Time - start;
+}
+
+Engine::Core::Coroutine<void> AwaitTicks(Engine::Core::Loop * Loop, std::atomic<long long> * Ticks)
+{
+    long long start = Loop->GetClock().Tick;
+    for (int i = 0; i < 3; i++)
+        co_await Loop->NextTick();
+    *Ticks = Loop->GetClock().Tick - start;
+}
+
+Engine::Core::Coroutine<void> AwaitChunk(Engine::Core::Loop * Loop, ChunkModule * Before, std::atomic<int> * IsAfter)
+{
+    co_await Loop->NextChunk(1);
+    *IsAfter = Before->LastTick == Loop->GetClock().Tick ? 1 : 0;
+}
+
+Engine::Core::Coroutine<void> Throw(Engine::Core::Loop * Loop)
+{
+    co_await Loop->NextTick();
+    throw std::runtime_error("Thrown by the coroutine");
+}
+
+Engine::Core::Coroutine<void> Wait(Engine::Core::Loop * Loop, std::atomic<bool> * IsDestroyed, std::atomic<bool> * IsResumed)
+{
+    DestructionFlag flag = { IsDestroyed };
+    co_await Loop->Delay(3600);
+    *IsResumed = true;
+}
+
+Engine::Core::Coroutine<void> Start(std::atomic<bool> * IsStarted)
+{
+    *IsStarted = true;
+    co_return;
+}
+
+/// Waits up to 5 seconds for a condition.
+bool WaitFor(std::function<bool()> Condition)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!Condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+int main()
+{
+    ChunkModule early(0), late(1);
+    Engine::Core::Loop loop;
+    loop.Modules.Add(&early);
+    loop.Modules.Add(&late);
+    loop.SetTickRate(1000);
+    std::thread runner([&loop]() { loop.Run(); });
+    while (loop.GetClock().Tick < 10)
+        std::this_thread::yield();
+
+    print("Awaiting the results of other coroutines");
+    {
+        std::atomic<int> result(0);
+        loop.Spawn(AwaitChild(&loop, &result));
+        check(WaitFor([&]() { return result.load() != 0; }));
+        check(result == 40);
+    }
+
+    print("");
+    print("Delay, NextTick and NextChunk");
+    {
+        std::atomic<double> elapsed(-1);
+        loop.Spawn(AwaitDelay(&loop, &elapsed));
+        check(WaitFor([&]() { return elapsed.load() >= 0; }));
+        check(elapsed >= 0.05);
+
+        std::atomic<long long> ticks(0);
+        loop.Spawn(AwaitTicks(&loop, &ticks));
+        check(WaitFor([&]() { return ticks.load() != 0; }));
+        check(ticks >= 3);
+
+        std::atomic<int> is_after(-1);
+        loop.Spawn(AwaitChunk(&loop, &early, &is_after));
+        check(WaitFor([&]() { return is_after.load() >= 0; }));
+        check(is_after == 1);
+    }
+
+    print("");
+    print("The exceptions go to the handler");
+    {
+        std::atomic<bool> is_handled(false);
+        loop.Spawn(Throw(&loop), [&is_handled](std::exception& e) {
+            is_handled = std::string(e.what()) == "Thrown by the coroutine";
+        });
+        check(WaitFor([&]() { return is_handled.load(); }));
+    }
+
+    print("");
+    print("The suspended coroutines are destroyed when the loop stops");
+    {
+        std::atomic<bool> is_destroyed(false), is_resumed(false);
+        loop.Spawn(Wait(&loop, &is_destroyed, &is_resumed));
+        check(!is_destroyed);
+        loop.Stop();
+        runner.join();
+        check(is_destroyed && !is_resumed);
+
+        // Not started while the loop is not running
+        std::atomic<bool> is_started(false);
+        loop.Spawn(Start(&is_started));
+        check(!is_started);
+    }
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    print("FAILED: The coroutines need C++20, build with the C++20 configuration.");
+    return 1;
+}
+
+#endif
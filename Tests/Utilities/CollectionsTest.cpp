@@ -1,6 +1,21 @@
 #include "../../Engine/Engine.h"
 #include <iostream>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+struct TimerItem : Engine::Utilities::Collections::TimerWheel<TimerItem>::Node
+{
+    int Id;
+    TimerItem(int Id = 0) : Id(Id) {}
+};
+
+struct QueueItem : Engine::Utilities::Collections::MPSCQueue<QueueItem>::Node
+{
+    int Producer;
+    int Index;
+};
 
 // To check the compilation errors
 template class Engine::Utilities::Collections::ResizableArray<int, true>;
@@ -15,9 +30,13 @@ template class Engine::Utilities::Collections::PriorityQueue<int, int, true, tru
 template class Engine::Utilities::Collections::PriorityQueue<int, int, true, false>;
 template class Engine::Utilities::Collections::Dictionary<int, int, true>;
 template class Engine::Utilities::Collections::Dictionary<int, int, false>;
+template class Engine::Utilities::Collections::WorkStealingDeque<int>;
+template class Engine::Utilities::Collections::TimerWheel<TimerItem>;
+template class Engine::Utilities::Collections::MPSCQueue<QueueItem>;
 
 #define print(context) (std::cout << context << '\n')
 #define input(var) (std::cin >> var)
+#define check(condition) (print(((condition) ? "Passed: " : "FAILED: ") << #condition))
 #define ITEMS_TYPE std::string
 #define KEY_TYPE std::string
 #define VALUE_TYPE std::string
@@ -34,6 +53,10 @@ void TestMultipleQueues();
 void TestMultiplePriorityQueues();
 void TestMultipleDictionaries();
 
+void TestWorkStealingDeque();
+void TestTimerWheel();
+void TestMPSCQueue();
+
 int main()
 {
     while (true)
@@ -51,6 +74,10 @@ int main()
         print("P => Test Multiple PriorityQueues");
         print("D => Test Multiple Dictionaries");
         print("");
+        print("w => Run WorkStealingDeque checks");
+        print("t => Run TimerWheel checks");
+        print("m => Run MPSCQueue checks");
+        print("");
 
         char option;
         input(option);
@@ -87,6 +114,15 @@ int main()
         case 'D':
             TestMultipleDictionaries();
             break;
+        case 'w':
+            TestWorkStealingDeque();
+            break;
+        case 't':
+            TestTimerWheel();
+            break;
+        case 'm':
+            TestMPSCQueue();
+            break;
         default:
             break;
         }
@@ -115,6 +151,7 @@ void TestList()
         print("F             => ForEach([](Item) { print(Item); }");
         print("");
         print("A Item Times      => for Times: Add(Item)");
+        print("x Item Times      => Assign(Times copies of Item)");
         print("d                 => delete list; list = new List()");
         print("n InitialCapacity => delete list; list = new List(InitialCapacity)");
         print("");
@@ -184,6 +221,15 @@ void TestList()
                 input(arg_int);
                 for (int i = 0; i < arg_int; i++) list->Add(arg_item);
                 break;
+            case 'x':
+                input(arg_item);
+                input(arg_int);
+                {
+                    std::unique_ptr<ITEMS_TYPE[]> items(new ITEMS_TYPE[arg_int > 0 ? arg_int : 0]);
+                    for (int i = 0; i < arg_int; i++) items[i] = arg_item;
+                    list->Assign(items.get(), arg_int);
+                }
+                break;
             case 'd':
                 delete list;
                 list = new Engine::Utilities::Collections::List<ITEMS_TYPE>();
@@ -873,3 +919,284 @@ void TestMultipleDictionaries()
     }
     catch (std::exception& e) { print("Exception: " << e.what()); }
 }
+
+void TestWorkStealingDeque()
+{
+    try
+    {
+        print("");
+        print("Pops in LIFO and steals in FIFO order, across growing");
+        {
+            Engine::Utilities::Collections::WorkStealingDeque<int> deque(4);
+            const int count = 100;
+            for (int i = 0; i < count; i++)
+                deque.Push(i);
+            check(deque.GetCount() == count);
+
+            bool ordered = true;
+            int item;
+            for (int i = 0; i < count / 2; i++)
+                ordered = ordered && deque.Steal(item) && item == i;
+            check(ordered);
+            for (int i = count - 1; i >= count / 2; i--)
+                ordered = ordered && deque.Pop(item) && item == i;
+            check(ordered);
+            check(deque.IsEmpty());
+            check(!deque.Pop(item));
+            check(!deque.Steal(item));
+
+            deque.Push(1);
+            deque.Push(2);
+            check(deque.Steal(item) && item == 1);
+            check(deque.Pop(item) && item == 2);
+            check(deque.IsEmpty());
+        }
+
+        print("");
+        print("Takes every item exactly once while pushing, popping and stealing concurrently");
+        {
+            Engine::Utilities::Collections::WorkStealingDeque<int> deque(4);
+            const int count = 200000;
+            const int thieves_count = 3;
+            std::atomic<int> * taken = new std::atomic<int>[count];
+            for (int i = 0; i < count; i++)
+                taken[i] = 0;
+            std::atomic<bool> done(false);
+            std::atomic<int> stolen(0);
+
+            std::thread thieves[thieves_count];
+            for (int t = 0; t < thieves_count; t++)
+                thieves[t] = std::thread([&]() {
+                    int item;
+                    while (!done.load() || !deque.IsEmpty())
+                        if (deque.Steal(item))
+                        {
+                            taken[item]++;
+                            stolen++;
+                        }
+                        else std::this_thread::yield();
+                });
+
+            int item;
+            for (int i = 0; i < count; i++)
+            {
+                deque.Push(i);
+                if (i % 3 == 0 && deque.Pop(item))
+                    taken[item]++;
+            }
+            while (deque.Pop(item))
+                taken[item]++;
+            done = true;
+            for (int t = 0; t < thieves_count; t++)
+                thieves[t].join();
+
+            bool once = true;
+            for (int i = 0; i < count; i++)
+                once = once && taken[i] == 1;
+            check(once);
+            check(deque.IsEmpty());
+            print("Stolen: " << stolen << " of " << count);
+            delete[] taken;
+        }
+    }
+    catch (std::exception& e) { print("Exception: " << e.what()); }
+}
+
+void TestTimerWheel()
+{
+    typedef Engine::Utilities::Collections::TimerWheel<TimerItem> Wheel;
+    try
+    {
+        print("");
+        print("Never pops early in the current slot");
+        {
+            Wheel wheel(0.001);
+            TimerItem item(1);
+            wheel.Push(&item, 0.0105);
+            check(wheel.Pop(0.0101) == nullptr); // Same slot, but not due yet
+            check(wheel.GetNextTime() <= 0.0105);
+            check(wheel.Pop(0.0105) == &item);
+            check(!item.IsLinked() && wheel.IsEmpty());
+        }
+
+        print("");
+        print("Keeps the order of pushing in a slot, pops the overdue items at once");
+        {
+            Wheel wheel(0.001);
+            TimerItem items[3] = { TimerItem(0), TimerItem(1), TimerItem(2) };
+            wheel.Push(&items[0], 0.5);
+            wheel.Push(&items[1], 0.5);
+            check(wheel.Pop(1.0) == &items[0]);
+            wheel.Push(&items[2], 0.2); // Earlier than the current tick
+            check(wheel.Pop(1.0) == &items[1]);
+            check(wheel.Pop(1.0) == &items[2]);
+            check(wheel.Pop(1.0) == nullptr);
+        }
+
+        print("");
+        print("Cascades from the higher levels");
+        {
+            Wheel wheel(0.001);
+            // Level 0, 1, 2, 3 and 4 respectively
+            double times[5] = { 0.1, 0.3, 20.0, 2000.0, 100000.0 };
+            TimerItem items[5] = { TimerItem(0), TimerItem(1), TimerItem(2), TimerItem(3), TimerItem(4) };
+            for (int i = 4; i >= 0; i--)
+                wheel.Push(&items[i], times[i]);
+            check(wheel.GetCount() == 5);
+            for (int i = 0; i < 5; i++)
+            {
+                check(wheel.GetNextTime() <= times[i]);
+                check(wheel.Pop(times[i] - 0.0001) == nullptr);
+                TimerItem * popped = wheel.Pop(times[i]);
+                check(popped == &items[i]);
+                check(popped != nullptr && popped->GetTime() == times[i]);
+            }
+            check(wheel.IsEmpty());
+        }
+
+        print("");
+        print("Re-places the items beyond the wheel span (about 49.7 days at 1ms)");
+        {
+            Wheel wheel(0.001);
+            TimerItem far(1), near(2);
+            double far_time = 100.0 * 24 * 3600; // 100 days
+            double span_end = 4294967.296; // 2^32 ticks
+            wheel.Push(&far, far_time);
+            wheel.Push(&near, span_end + 1.0);
+            check(wheel.Pop(span_end - 1.0) == nullptr);
+            check(wheel.Pop(span_end + 0.5) == nullptr);
+            check(wheel.Pop(span_end + 1.0) == &near);
+            check(wheel.Pop(far_time - 0.0001) == nullptr);
+            check(far.IsLinked());
+            check(wheel.Pop(far_time) == &far);
+            check(wheel.IsEmpty());
+        }
+
+        print("");
+        print("Removes the linked items");
+        {
+            Wheel wheel(0.001);
+            TimerItem items[5] = { TimerItem(0), TimerItem(1), TimerItem(2), TimerItem(3), TimerItem(4) };
+            wheel.Push(&items[0], 0.005);
+            wheel.Push(&items[1], 0.005);
+            wheel.Push(&items[2], 0.005);
+            wheel.Push(&items[3], 0.005);
+            wheel.Push(&items[4], 50.0); // In a higher level
+            wheel.Remove(&items[1]); // In a level 0 slot
+            check(!items[1].IsLinked());
+            wheel.Remove(&items[1]); // Not linked, does nothing
+            wheel.Remove(&items[4]);
+            check(!items[4].IsLinked());
+            check(wheel.GetCount() == 3);
+            check(wheel.Pop(0.01) == &items[0]); // The rest are moved to the due list
+            wheel.Remove(&items[2]); // In the due list
+            check(wheel.GetCount() == 1);
+            check(wheel.Pop(0.01) == &items[3]);
+            check(wheel.Pop(0.01) == nullptr);
+            check(wheel.Pop(100.0) == nullptr);
+            check(wheel.IsEmpty());
+
+            bool thrown = false;
+            wheel.Push(&items[0], 1.0);
+            try { wheel.Push(&items[0], 2.0); }
+            catch (std::logic_error&) { thrown = true; }
+            check(thrown);
+            check(wheel.Pop() == &items[0]);
+        }
+    }
+    catch (std::exception& e) { print("Exception: " << e.what()); }
+}
+
+void TestMPSCQueue()
+{
+    typedef Engine::Utilities::Collections::MPSCQueue<QueueItem> Queue;
+    try
+    {
+        print("");
+        print("Pops in the order of pushing, with single and batch pushes");
+        {
+            Queue queue;
+            QueueItem items[10];
+            for (int i = 0; i < 10; i++)
+                items[i].Index = i;
+            QueueItem * batch[8] = { &items[1], &items[2], &items[3], &items[4], &items[5], &items[6], &items[7], &items[8] };
+
+            check(queue.IsEmpty());
+            check(queue.PopAll() == nullptr);
+            queue.Push(&items[0]);
+            queue.Push(batch, 8);
+            queue.Push(batch, 0); // Does nothing
+            queue.Push(&items[9]);
+            check(!queue.IsEmpty());
+
+            int count = 0;
+            bool ordered = true;
+            for (QueueItem * item = queue.PopAll(); item != nullptr; item = Queue::GetNext(item))
+                ordered = ordered && item->Index == count++;
+            check(ordered);
+            check(count == 10);
+            check(queue.IsEmpty());
+
+            queue.Push(batch, 1);
+            QueueItem * item = queue.PopAll();
+            check(item == &items[1] && Queue::GetNext(item) == nullptr);
+        }
+
+        print("");
+        print("Keeps the order of each producer while pushing concurrently");
+        {
+            Queue queue;
+            const int producers_count = 4;
+            const int count = 100000; // For each producer
+            const int batch_size = 8;
+            QueueItem * items = new QueueItem[producers_count * count];
+
+            std::thread producers[producers_count];
+            for (int p = 0; p < producers_count; p++)
+                producers[p] = std::thread([&, p]() {
+                    QueueItem * own = items + p * count;
+                    for (int i = 0; i < count; i++)
+                    {
+                        own[i].Producer = p;
+                        own[i].Index = i;
+                    }
+                    // Single pushes in the first half, batches in the second one
+                    int i = 0;
+                    for (; i < count / 2; i++)
+                        queue.Push(&own[i]);
+                    QueueItem * batch[batch_size];
+                    while (i < count)
+                    {
+                        int n = 0;
+                        for (; n < batch_size && i < count; n++, i++)
+                            batch[n] = &own[i];
+                        queue.Push(batch, n);
+                    }
+                });
+
+            int next[producers_count] = {};
+            int received = 0;
+            bool ordered = true;
+            while (received < producers_count * count)
+            {
+                QueueItem * item = queue.PopAll();
+                if (item == nullptr)
+                    std::this_thread::yield();
+                for (; item != nullptr; item = Queue::GetNext(item))
+                {
+                    ordered = ordered && item->Index == next[item->Producer];
+                    next[item->Producer]++;
+                    received++;
+                }
+            }
+            for (int p = 0; p < producers_count; p++)
+                producers[p].join();
+
+            check(ordered);
+            check(received == producers_count * count);
+            check(queue.IsEmpty());
+            delete[] items;
+        }
+    }
+    catch (std::exception& e) { print("Exception: " << e.what()); }
+}
@@ -0,0 +1,152 @@
+#include "../../Engine/Engine.h"
+#include <iostream>
+#include <string>
+#include <new>
+#include <cstdlib>
+
+#define print(content) (std::cout << content << '\n')
+#define check(condition) (print(((condition) ? "Passed: " : "FAILED: ") << #condition))
+
+typedef Engine::Utilities::InlineFunction<int(int)> Function;
+
+// Counts the heap allocations to tell inline storage from the heap one
+int allocations = 0;
+
+void * operator new(std::size_t Size)
+{
+    allocations++;
+    if (void * pointer = std::malloc(Size == 0 ? 1 : Size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * Pointer) noexcept
+{
+    std::free(Pointer);
+}
+
+void operator delete(void * Pointer, std::size_t) noexcept
+{
+    std::free(Pointer);
+}
+
+/// Counts the live instances, to check that each stored object is destroyed once.
+struct Counted
+{
+    static int Live;
+    int Value;
+    Counted(int Value) : Value(Value) { Live++; }
+    Counted(const Counted& Op) : Value(Op.Value) { Live++; }
+    Counted(Counted&& Op) noexcept : Value(Op.Value) { Live++; }
+    ~Counted() { Live--; }
+};
+int Counted::Live = 0;
+
+/// Is stored on the heap because its move may throw.
+struct ThrowingMove
+{
+    Counted Data;
+    ThrowingMove(int Value) : Data(Value) {}
+    ThrowingMove(const ThrowingMove& Op) : Data(Op.Data) {}
+    ThrowingMove(ThrowingMove&& Op) noexcept(false) : Data(std::move(Op.Data)) {}
+    int operator()(int Argument) { return Data.Value + Argument; }
+};
+
+int AddOne(int Argument) { return Argument + 1; }
+
+bool Throws(Function& Function)
+{
+    try { Function(0); }
+    catch (std::bad_function_call&) { return true; }
+    return false;
+}
+
+int main()
+{
+    print("Empty functions");
+    {
+        int (*null_pointer)(int) = nullptr;
+        std::function<int(int)> null_function;
+        Function empty;
+        Function from_nullptr(nullptr);
+        Function from_pointer(null_pointer);
+        Function from_function(null_function);
+        check(empty == nullptr && !empty);
+        check(from_nullptr == nullptr);
+        check(from_pointer == nullptr);
+        check(from_function == nullptr);
+        check(Throws(empty) && Throws(from_pointer) && Throws(from_function));
+    }
+
+    print("Inline storage");
+    {
+        int count = allocations;
+        Function pointer(&AddOne);
+        Counted captured(10);
+        Function small([captured](int Argument) { return captured.Value + Argument; });
+        check(allocations == count);
+        check(pointer != nullptr && pointer(1) == 2);
+        check(small(1) == 11);
+        check(Counted::Live == 2);
+
+        std::function<int(int)> function = [](int Argument) { return Argument * 2; };
+        count = allocations;
+        Function wrapped(function);
+        check(allocations == count); // std::function fits and is nothrow movable
+        check(wrapped(4) == 8);
+    }
+    check(Counted::Live == 0);
+
+    print("Heap storage");
+    {
+        struct { char Data[64]; } large = {};
+        large.Data[0] = 5;
+        check(!Function::IsStoredInline<decltype(large)>());
+        check(!Function::IsStoredInline<ThrowingMove>());
+
+        int count = allocations;
+        Function big([large](int Argument) { return large.Data[0] + Argument; });
+        check(allocations == count + 1);
+        check(big(1) == 6);
+
+        count = allocations;
+        Function throwing{ThrowingMove(7)};
+        check(allocations == count + 1);
+        check(throwing(1) == 8);
+        check(Counted::Live == 1);
+    }
+    check(Counted::Live == 0);
+
+    print("Moving");
+    {
+        Function small([counted = Counted(1)](int Argument) { return counted.Value + Argument; });
+        Function big{ThrowingMove(2)};
+        check(Counted::Live == 2);
+
+        int count = allocations;
+        Function moved_small(std::move(small));
+        Function moved_big(std::move(big));
+        check(allocations == count); // Only the pointer is moved for the heap storage
+        check(small == nullptr && big == nullptr);
+        check(Throws(small) && Throws(big));
+        check(moved_small(1) == 2 && moved_big(1) == 3);
+        check(Counted::Live == 2);
+
+        moved_small = std::move(moved_big); // Destroys the previous target
+        check(Counted::Live == 1);
+        check(moved_big == nullptr && moved_small(1) == 3);
+
+        moved_small = std::move(moved_small);
+        check(moved_small(1) == 3);
+
+        moved_small = nullptr;
+        check(Counted::Live == 0);
+        check(moved_small == nullptr);
+
+        small = [](int Argument) { return -Argument; };
+        check(small(1) == -1);
+    }
+    check(Counted::Live == 0);
+
+    return 0;
+}